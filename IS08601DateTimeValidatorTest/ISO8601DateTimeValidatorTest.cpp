@@ -1,4 +1,19 @@
 #include "pch.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <tuple>
+#include <unordered_set>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "../ISO8601DateTimeBenchmark/ISO8601CorpusGenerator.h"
 #include "../ISO8601DateTimeValidator/ISO8601DateTimeProcessor.h"
 
 // Test case to validate valid ISO 8601 date-time formats
@@ -40,7 +55,15 @@ TEST(ISO8601ValidationTest, InvalidMonth) {
 TEST(ISO8601ValidationTest, InvalidDay) {
     // Invalid day: Should be within range 01-31 based on month
     EXPECT_FALSE(ISO8601DateTimeProcessor::isDateTimeValid("2024-04-32T12:34:56Z"));
-    EXPECT_FALSE(ISO8601DateTimeProcessor::isDateTimeValid("2024-02-30T12:34:56Z")); // February, not a leap year
+    EXPECT_FALSE(ISO8601DateTimeProcessor::isDateTimeValid("2024-02-30T12:34:56Z")); // February has at most 29 days
+    EXPECT_FALSE(ISO8601DateTimeProcessor::isDateTimeValid("2023-02-29T12:34:56Z")); // Not a leap year
+    EXPECT_FALSE(ISO8601DateTimeProcessor::isDateTimeValid("1900-02-29T12:34:56Z")); // Century, not a leap year
+}
+
+TEST(ISO8601ValidationTest, LeapDay) {
+    EXPECT_TRUE(ISO8601DateTimeProcessor::isDateTimeValid("2024-02-29T12:34:56Z"));
+    EXPECT_TRUE(ISO8601DateTimeProcessor::isDateTimeValid("2000-02-29T12:34:56+01:00"));
+    EXPECT_TRUE(ISO8601DateTimeProcessor::isDateTimeValid("0000-02-29T00:00:00Z"));
 }
 
 TEST(ISO8601ValidationTest, InvalidHour) {
@@ -96,6 +119,17 @@ TEST(ISO8601ValidationTest, InvalidLength) {
 }
 
 
+TEST(ISO8601ValidationTest, ValidateWithLength) {
+    // Records packed back to back without terminators, as they appear in a read buffer.
+    const char buffer[] = "2024-04-21T12:34:56Z2021-10-21T12:34:56+00:00""2024-04-21T12:34:56+99:99";
+    EXPECT_TRUE(is_valid_iso8601_datetime_n(buffer, 20));
+    EXPECT_TRUE(is_valid_iso8601_datetime_n(buffer + 20, 25));
+    EXPECT_FALSE(is_valid_iso8601_datetime_n(buffer + 45, 25));
+    EXPECT_FALSE(is_valid_iso8601_datetime_n(buffer, 19));
+    EXPECT_FALSE(is_valid_iso8601_datetime_n(buffer, 21));
+    EXPECT_FALSE(is_valid_iso8601_datetime_n(buffer, 0));
+}
+
 void readAndValidateDateTimeSet(const std::string& input_file, unsigned int expected_records, unsigned int& actual_records, unsigned int& invalid_records) {
     std::ifstream input_stream(input_file);
     ASSERT_TRUE(input_stream.is_open()) << "Failed to open " << input_file;
@@ -134,6 +168,1781 @@ TEST(ISO8601ValidationTest, ReadInValidDateTimeSetContaining2901Records) {
     readAndValidateDateTimeSet("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt", 10000, actual_records, invalid_records);
     EXPECT_EQ(expected_invalid_records, invalid_records) << "Failed to parse all invalid " << expected_invalid_records << " date time strings from file.";
 }
+std::vector<std::string> readDateTimeRecords(const std::string& input_file) {
+    std::ifstream input_stream(input_file);
+    EXPECT_TRUE(input_stream.is_open()) << "Failed to open " << input_file;
+
+    std::vector<std::string> records;
+    std::string line;
+    while (std::getline(input_stream, line)) {
+        records.push_back(line);
+    }
+    return records;
+}
+
+// Runs the batch validator at every SIMD level and compares each result with the scalar validator.
+void compareBatchWithScalar(const std::vector<std::string>& records) {
+    std::vector<const char*> pointers;
+    std::vector<size_t> lengths;
+    for (const auto& record : records) {
+        pointers.push_back(record.data());
+        lengths.push_back(record.size());
+    }
+
+    for (int level = ISO8601_SIMD_SCALAR; level <= ISO8601_SIMD_AVX2; level++) {
+        iso8601_simd_level used = iso8601_simd_select_level(static_cast<iso8601_simd_level>(level));
+        std::unique_ptr<bool[]> results(new bool[records.size()]);
+        size_t valid = is_valid_iso8601_datetime_batch(pointers.data(), lengths.data(), records.size(), results.get());
+
+        size_t expected_valid = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            bool expected = is_valid_iso8601_datetime_n(records[i].data(), records[i].size());
+            expected_valid += expected;
+            EXPECT_EQ(expected, results[i]) << records[i] << " at SIMD level " << used;
+        }
+        EXPECT_EQ(expected_valid, valid) << "at SIMD level " << used;
+    }
+    iso8601_simd_select_level(ISO8601_SIMD_AVX2);
+}
+
+TEST(ISO8601ValidationTest, EveryDateOfYears0000To9999) {
+    // Every combination of year, month 00-13 and day 00-32 against std::chrono.
+    std::vector<std::string> leap_days;
+    char dt_str[] = "0000-00-00T12:34:56Z";
+    for (int year = 0; year <= 9999; year++) {
+        for (unsigned month = 0; month <= 13; month++) {
+            for (unsigned day = 0; day <= 32; day++) {
+                std::snprintf(dt_str, sizeof(dt_str), "%04d-%02u-%02uT12:34:56Z", year, month, day);
+                bool expected = std::chrono::year_month_day(std::chrono::year(year), std::chrono::month(month), std::chrono::day(day)).ok();
+                ASSERT_EQ(expected, is_valid_iso8601_datetime_n(dt_str, 20)) << dt_str;
+            }
+        }
+        std::snprintf(dt_str, sizeof(dt_str), "%04d-02-29T12:34:56Z", year);
+        leap_days.push_back(dt_str);
+    }
+    // The SIMD kernels defer the 29th of February to the scalar validator.
+    compareBatchWithScalar(leap_days);
+}
+
+TEST(ISO8601BatchValidationTest, MatchesScalarOnValidDateTimeSet) {
+    compareBatchWithScalar(readDateTimeRecords("test_inputs/generated_iso8601_datetime_10000.txt"));
+}
+
+TEST(ISO8601BatchValidationTest, MatchesScalarOnMixedDateTimeSet) {
+    compareBatchWithScalar(readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt"));
+}
+
+// Every position of each valid record replaced with characters from each class.
+std::vector<std::string> singleCharacterMutations(const std::vector<std::string>& valid_records, const std::string& replacements) {
+    std::vector<std::string> records;
+    for (const std::string& valid : valid_records) {
+        for (size_t position = 0; position < valid.size(); position++) {
+            for (char replacement : replacements) {
+                std::string record = valid;
+                record[position] = replacement;
+                records.push_back(record);
+            }
+        }
+    }
+    return records;
+}
+
+TEST(ISO8601BatchValidationTest, MatchesScalarOnSingleCharacterMutations) {
+    compareBatchWithScalar(singleCharacterMutations(
+        { "2024-04-21T12:34:56Z", "2021-10-21T12:34:56+00:00", "1999-02-28T23:59:59-23:59", "2000-02-29T00:00:00Z" },
+        "0129:-T+Z/ "));
+}
+
+TEST(ISO8601BatchValidationTest, RecordAtEndOfPage) {
+    // A record that ends right at a page boundary must not be read past its end.
+    const std::string record = "2021-10-21T12:34:56+00:00";
+    std::vector<char> buffer(3 * 4096);
+    uintptr_t page = (reinterpret_cast<uintptr_t>(buffer.data()) + 4095) & ~static_cast<uintptr_t>(4095);
+    char* end_of_page = reinterpret_cast<char*>(page) + 4096;
+    std::copy(record.begin(), record.end(), end_of_page - record.size());
+
+    const char* pointer = end_of_page - record.size();
+    size_t length = record.size();
+    bool result = false;
+    EXPECT_EQ(1u, is_valid_iso8601_datetime_batch(&pointer, &length, 1, &result));
+    EXPECT_TRUE(result);
+}
+TEST(ISO8601ChunkValidationTest, SplitsRecordsInPlace) {
+    const std::string buffer = "2024-04-21T12:34:56Z\n\n2024-13-21T12:34:56Z\r\n2021-10-21T12:34:56+00:00\r\n2024-04-2";
+    iso8601_record_span spans[8];
+    uint64_t valid_bitmap[ISO8601_BITMAP_WORDS(8)];
+    size_t consumed = 0;
+
+    size_t count = iso8601_validate_chunk(buffer.data(), buffer.size(), false, spans, valid_bitmap, 8, &consumed);
+    ASSERT_EQ(4u, count);
+    EXPECT_EQ(buffer.size() - 9, consumed) << "The incomplete last record must be left for the next call.";
+
+    EXPECT_EQ(0u, spans[0].offset);
+    EXPECT_EQ(20u, spans[0].length);
+    EXPECT_EQ(0u, spans[1].length);
+    EXPECT_EQ(20u, spans[2].length);
+    EXPECT_EQ(25u, spans[3].length) << "The \\r of a \\r\\n line ending is not part of the record.";
+    EXPECT_EQ("2021-10-21T12:34:56+00:00", buffer.substr(spans[3].offset, spans[3].length));
+
+    EXPECT_TRUE(ISO8601_BITMAP_TEST(valid_bitmap, 0));
+    EXPECT_FALSE(ISO8601_BITMAP_TEST(valid_bitmap, 1));
+    EXPECT_FALSE(ISO8601_BITMAP_TEST(valid_bitmap, 2));
+    EXPECT_TRUE(ISO8601_BITMAP_TEST(valid_bitmap, 3));
+
+    // At the end of the input the last record does not need a newline.
+    count = iso8601_validate_chunk(buffer.data() + consumed, buffer.size() - consumed, true, spans, valid_bitmap, 8, &consumed);
+    ASSERT_EQ(1u, count);
+    EXPECT_EQ(9u, consumed);
+    EXPECT_FALSE(ISO8601_BITMAP_TEST(valid_bitmap, 0));
+}
+
+TEST(ISO8601ChunkValidationTest, StopsAtMaxRecords) {
+    std::string buffer;
+    for (int i = 0; i < 100; i++) {
+        buffer += "2024-04-21T12:34:56Z\n";
+    }
+    iso8601_record_span spans[64];
+    uint64_t valid_bitmap[ISO8601_BITMAP_WORDS(64)];
+    size_t consumed = 0;
+
+    EXPECT_EQ(64u, iso8601_validate_chunk(buffer.data(), buffer.size(), true, spans, valid_bitmap, 64, &consumed));
+    EXPECT_EQ(64u * 21, consumed);
+    EXPECT_EQ(~uint64_t(0), valid_bitmap[0]);
+}
+
+TEST(ISO8601ColumnValidationTest, MatchesRowByRowValidation) {
+    // Ten copies of the fixture make two row ranges, and every 7th row is null.
+    std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    records.push_back("2024-04-21T12:00:00.123456789+02:00");
+    records.push_back("+999999-12-31T23:59:59Z");
+    std::string data;
+    std::vector<int32_t> offsets{ 0 };
+    std::vector<int64_t> large_offsets{ 0 };
+    for (int copy = 0; copy < 10; copy++) {
+        for (const auto& record : records) {
+            data += record;
+            offsets.push_back(static_cast<int32_t>(data.size()));
+            large_offsets.push_back(static_cast<int64_t>(data.size()));
+        }
+    }
+    const size_t rows = offsets.size() - 1;
+    std::vector<uint8_t> nulls((rows + 7) / 8, 0);
+    for (size_t row = 0; row < rows; row++) {
+        nulls[row >> 3] |= static_cast<uint8_t>((row % 7 != 3) << (row & 7));
+    }
+    iso8601_string_column column{ data.data(), offsets.data(), nullptr, nulls.data(), rows };
+
+    auto isSet = [](const std::vector<uint8_t>& bitmap, size_t row) { return ((bitmap[row >> 3] >> (row & 7)) & 1) != 0; };
+    std::vector<uint8_t> validity((rows + 7) / 8, 0xFF);
+    const size_t valid = ISO8601DateTimeProcessor::validateStringColumn(column, ISO8601_ACCEPT_EXTENDED, validity.data(), nullptr, 4);
+    std::vector<int64_t> extended_microseconds(rows, -1);
+    std::vector<uint8_t> extended_validity((rows + 7) / 8);
+    EXPECT_EQ(valid, ISO8601DateTimeProcessor::validateStringColumn(column, ISO8601_ACCEPT_EXTENDED,
+        extended_validity.data(), extended_microseconds.data()));
+    EXPECT_EQ(validity, extended_validity);
+    size_t expected_valid = 0;
+    for (size_t row = 0; row < rows; row++) {
+        const std::string& record = records[row % records.size()];
+        const bool expected = row % 7 != 3 && is_valid_iso8601_datetime_n(record.data(), record.size());
+        EXPECT_EQ(expected, isSet(validity, row)) << row << " " << record;
+        int64_t seconds = 0;
+        if (expected) {
+            iso8601_datetime_to_unix_seconds(record.data(), record.size(), &seconds);
+        }
+        EXPECT_EQ(seconds * 1000000, extended_microseconds[row]) << row << " " << record;
+        expected_valid += expected;
+    }
+    EXPECT_EQ(expected_valid, valid);
+    EXPECT_EQ(0, validity.back() >> (rows & 7));
+
+    // The epoch column in every format, from 64 bit offsets, on one thread and on several.
+    column.offsets = nullptr;
+    column.large_offsets = large_offsets.data();
+    std::vector<uint8_t> all_validity((rows + 7) / 8);
+    std::vector<int64_t> microseconds(rows, -1);
+    const size_t all_valid = ISO8601DateTimeProcessor::validateStringColumn(column, ISO8601_ACCEPT_ALL_DATETIMES,
+        all_validity.data(), microseconds.data());
+    for (size_t row = 0; row < rows; row++) {
+        const std::string& record = records[row % records.size()];
+        iso8601_datetime parsed;
+        const bool parses = ISO8601DateTimeProcessor::parseDateTime(record, ISO8601_ACCEPT_ALL_DATETIMES, parsed);
+        const bool expected = row % 7 != 3 && parses && record[0] != '+';
+        ASSERT_EQ(expected, isSet(all_validity, row)) << row << " " << record;
+        EXPECT_EQ(expected ? iso8601_parsed_to_unix_seconds(&parsed) * 1000000 + parsed.fraction / 1000 : 0, microseconds[row]) << record;
+    }
+    EXPECT_EQ(1713693600123456, microseconds[records.size() - 2]);
+    std::vector<uint8_t> parallel_validity((rows + 7) / 8);
+    std::vector<int64_t> parallel_microseconds(rows);
+    EXPECT_EQ(all_valid, ISO8601DateTimeProcessor::validateStringColumn(column, ISO8601_ACCEPT_ALL_DATETIMES,
+        parallel_validity.data(), parallel_microseconds.data(), 3));
+    EXPECT_EQ(all_validity, parallel_validity);
+    EXPECT_EQ(microseconds, parallel_microseconds);
+}
+
+// Reads the output of processDateTime back into a set.
+std::unordered_set<std::string> readOutputSet(const std::string& output_file) {
+    std::vector<std::string> records = readDateTimeRecords(output_file);
+    std::unordered_set<std::string> output(records.begin(), records.end());
+    EXPECT_EQ(records.size(), output.size()) << "Duplicate values written to " << output_file;
+    return output;
+}
+
+// Unique valid records of the input, computed one line at a time.
+std::unordered_set<std::string> expectedUniqueDateTimes(const std::string& input_file) {
+    std::unordered_set<std::string> expected;
+    for (const auto& record : readDateTimeRecords(input_file)) {
+        if (ISO8601DateTimeProcessor::isDateTimeValid(record)) {
+            expected.insert(record);
+        }
+    }
+    return expected;
+}
+
+std::string temporaryOutputFile(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(ISO8601ProcessorTest, WritesUniqueValidDateTimes) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_unique.txt");
+
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file));
+    EXPECT_EQ(expectedUniqueDateTimes(input_file), readOutputSet(output_file));
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, HandlesRecordsAcrossReadBlocks) {
+    // Several copies of the fixture are larger than one read block, so records straddle block boundaries.
+    const std::string input_file = temporaryOutputFile("iso8601_processor_large_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_large_unique.txt");
+    std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    {
+        std::ofstream input_stream(input_file, std::ios::binary);
+        for (int copy = 0; copy < 6; copy++) {
+            for (const auto& record : records) {
+                input_stream << record << (copy % 2 ? "\r\n" : "\n");
+            }
+        }
+    }
+
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file));
+    EXPECT_EQ(expectedUniqueDateTimes("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt"), readOutputSet(output_file));
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, InputModesProduceSameValues) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_input_mode.txt");
+    const auto expected = expectedUniqueDateTimes(input_file);
+
+    for (auto input_mode : { ISO8601DateTimeProcessor::InputMode::MemoryMapped, ISO8601DateTimeProcessor::InputMode::Streamed,
+             ISO8601DateTimeProcessor::InputMode::AsyncRead }) {
+        ISO8601DateTimeProcessor::ProcessingOptions options;
+        options.input_mode = input_mode;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(expected, readOutputSet(output_file));
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, MemoryMappedInputRequiresFile) {
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.input_mode = ISO8601DateTimeProcessor::InputMode::MemoryMapped;
+    EXPECT_FALSE(ISO8601DateTimeProcessor::processDateTime("test_inputs/missing_input.txt",
+        temporaryOutputFile("iso8601_processor_missing.txt"), options));
+}
+
+TEST(ISO8601AsyncFileReaderTest, ReadsFileInOrderOnEveryBackend) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    std::ifstream file_stream(input_file, std::ios::binary);
+    const std::string expected((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+    ASSERT_GT(expected.size(), 64u * 1024);
+
+    // Small blocks keep every slot of the ring busy; the last block is a short one.
+    for (bool use_io_uring : { true, false }) {
+        ISO8601AsyncFileReader reader(4096 + 17, 3);
+        ASSERT_TRUE(reader.open(input_file, use_io_uring));
+        if (!use_io_uring) {
+            EXPECT_EQ(ISO8601AsyncFileReader::Backend::Pread, reader.backend());
+        }
+        std::istream input_stream(&reader);
+        std::string actual(expected.size() + 10, '\0');
+        input_stream.read(actual.data(), static_cast<std::streamsize>(actual.size()));
+        EXPECT_TRUE(input_stream.eof());
+        EXPECT_FALSE(input_stream.bad());
+        actual.resize(static_cast<size_t>(input_stream.gcount()));
+        EXPECT_EQ(expected, actual) << "backend " << static_cast<int>(reader.backend());
+
+        // Closing with reads in flight waits for them.
+        ASSERT_TRUE(reader.open(input_file, use_io_uring));
+        EXPECT_EQ(expected[0], input_stream.rdbuf()->sgetc());
+        reader.close();
+        EXPECT_EQ(ISO8601AsyncFileReader::Backend::None, reader.backend());
+    }
+
+    ISO8601AsyncFileReader reader;
+    EXPECT_FALSE(reader.open("test_inputs/missing_input.txt"));
+    EXPECT_FALSE(reader.open("test_inputs"));
+}
+
+TEST(ISO8601ProcessorTest, ParallelProcessingIsDeterministic) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_parallel.txt");
+
+    // Unique valid values in the order of their first occurrence.
+    std::vector<std::string> expected;
+    std::unordered_set<std::string> seen;
+    for (const auto& record : readDateTimeRecords(input_file)) {
+        if (ISO8601DateTimeProcessor::isDateTimeValid(record) && seen.insert(record).second) {
+            expected.push_back(record);
+        }
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.parallel_chunk_size = 16 * 1024;
+    for (unsigned threads : { 2u, 3u, 8u }) {
+        options.threads = threads;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(expected, readDateTimeRecords(output_file)) << "with " << threads << " threads";
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, StreamedPipelineMatchesSingleThread) {
+    // Several read blocks of generated records in every notation, some of them repeated.
+    const std::string input_file = temporaryOutputFile("iso8601_processor_pipeline_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_pipeline.txt");
+    {
+        ISO8601BufferedWriter writer;
+        ASSERT_TRUE(writer.open(input_file));
+        ISO8601CorpusGenerator::CorpusOptions corpus;
+        ISO8601CorpusGenerator generator(corpus);
+        const ISO8601CorpusGenerator::RecordShape shapes[] = { ISO8601CorpusGenerator::RecordShape::Calendar,
+            ISO8601CorpusGenerator::RecordShape::Basic, ISO8601CorpusGenerator::RecordShape::Week };
+        for (int row = 0; row < 150000; row++) {
+            writer.write(row % 5 == 0 ? generator.shapeRecord(shapes[row % 3]) : generator.nextRecord());
+            writer.write("\n");
+        }
+        ASSERT_TRUE(writer.close());
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.input_mode = ISO8601DateTimeProcessor::InputMode::Streamed;
+    for (unsigned accepted_formats : { ISO8601_ACCEPT_EXTENDED, ISO8601_ACCEPT_ALL_DATETIMES }) {
+        for (auto output_order : { ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence, ISO8601DateTimeProcessor::OutputOrder::Sorted }) {
+            options.accepted_formats = accepted_formats;
+            options.output_order = output_order;
+            options.threads = 1;
+            ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+            const std::vector<std::string> expected = readDateTimeRecords(output_file);
+            EXPECT_GT(expected.size(), 90000u);
+
+            for (unsigned threads : { 2u, 3u }) {
+                options.threads = threads;
+                ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+                EXPECT_EQ(expected, readDateTimeRecords(output_file)) << "with " << threads << " threads";
+            }
+        }
+    }
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, WritesToStdout) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_stdout.txt");
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+
+    std::ostringstream captured;
+    std::streambuf* cout_buffer = std::cout.rdbuf(captured.rdbuf());
+    bool ok = ISO8601DateTimeProcessor::processDateTime(input_file, ISO8601DateTimeProcessor::STDOUT_FILE_NAME, options);
+    std::cout.rdbuf(cout_buffer);
+    ASSERT_TRUE(ok);
+
+    std::ifstream expected_stream(output_file, std::ios::binary);
+    std::ostringstream expected;
+    expected << expected_stream.rdbuf();
+    EXPECT_EQ(expected.str(), captured.str());
+    expected_stream.close();
+    std::filesystem::remove(output_file);
+}
+
+#ifndef _WIN32
+TEST(ISO8601ProcessorTest, StdinValuesArePassedOnAsTheyArrive) {
+    const std::string output_file = temporaryOutputFile("iso8601_processor_stdin.txt");
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    for (unsigned threads : { 1u, 3u }) {
+        std::filesystem::remove(output_file);
+        int pipe_fds[2];
+        ASSERT_EQ(0, pipe(pipe_fds));
+        const int saved_stdin = dup(STDIN_FILENO);
+        dup2(pipe_fds[0], STDIN_FILENO);
+        close(pipe_fds[0]);
+
+        // The first value has to reach the output while the pipe is still open.
+        bool written_while_open = false;
+        std::thread producer([&]() {
+            const std::string first = "2024-04-21T12:00:00Z\nnot a date-time\n2024-04-21T12:00:00Z\n2024-04-21T13:";
+            EXPECT_EQ(ssize_t(first.size()), write(pipe_fds[1], first.data(), first.size()));
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!written_while_open && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                std::ifstream output_stream(output_file);
+                std::string line;
+                written_while_open = std::getline(output_stream, line) && line == "2024-04-21T12:00:00Z";
+            }
+            const std::string rest = "00:00Z\n";
+            EXPECT_EQ(ssize_t(rest.size()), write(pipe_fds[1], rest.data(), rest.size()));
+            close(pipe_fds[1]);
+        });
+
+        options.threads = threads;
+        const bool ok = ISO8601DateTimeProcessor::processDateTime(ISO8601DateTimeProcessor::STDIN_FILE_NAME, output_file, options);
+        producer.join();
+        dup2(saved_stdin, STDIN_FILENO);
+        close(saved_stdin);
+        std::cin.clear();
+        ASSERT_TRUE(ok);
+        EXPECT_TRUE(written_while_open) << "with " << threads << " threads";
+        EXPECT_EQ((std::vector<std::string>{ "2024-04-21T12:00:00Z", "2024-04-21T13:00:00Z" }), readDateTimeRecords(output_file));
+    }
+    std::filesystem::remove(output_file);
+}
+#endif
+
+std::string formatKey(uint64_t key) {
+    char buffer[MAX_DATETIME_LENGTH];
+    size_t length = iso8601_format_datetime_key(key, buffer);
+    return std::string(buffer, length);
+}
+
+uint64_t keyOf(const std::string& dt_str) {
+    return iso8601_datetime_key(dt_str.data(), dt_str.size());
+}
+
+TEST(ISO8601DateTimeKeyTest, RoundTripsFixtureValues) {
+    for (const auto& record : readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt")) {
+        if (ISO8601DateTimeProcessor::isDateTimeValid(record)) {
+            EXPECT_EQ(record, formatKey(keyOf(record)));
+        }
+    }
+}
+
+TEST(ISO8601DateTimeKeyTest, RoundTripsExtremes) {
+    for (std::string dt_str : { "0000-01-01T00:00:00Z", "0000-01-01T00:00:00+23:59", "0000-01-01T00:00:00-23:59",
+                                "9999-12-31T23:59:59Z", "9999-12-31T23:59:59-23:59", "9999-12-31T23:59:59+23:59",
+                                "1970-01-01T00:00:00Z", "1969-12-31T23:59:59Z", "2000-03-01T00:00:00+01:00" }) {
+        uint64_t key = keyOf(dt_str);
+        EXPECT_NE(0u, key);
+        EXPECT_LT(key, uint64_t(1) << 52);
+        EXPECT_EQ(dt_str, formatKey(key));
+    }
+}
+
+TEST(ISO8601DateTimeKeyTest, KeysOrderByInstant) {
+    // Same instant with different notations: distinct keys, adjacent in order.
+    uint64_t utc = keyOf("2024-04-21T12:00:00Z");
+    uint64_t plus_two = keyOf("2024-04-21T14:00:00+02:00");
+    uint64_t plus_zero = keyOf("2024-04-21T12:00:00+00:00");
+    uint64_t minus_zero = keyOf("2024-04-21T12:00:00-00:00");
+    EXPECT_EQ(4u, std::unordered_set<uint64_t>({ utc, plus_two, plus_zero, minus_zero }).size());
+    EXPECT_EQ(utc >> 13, plus_two >> 13);
+
+    EXPECT_LT(keyOf("2024-04-21T11:59:59Z"), utc);
+    EXPECT_LT(keyOf("2024-04-21T13:59:59+02:00"), utc);
+    EXPECT_GT(keyOf("2024-04-21T07:00:01-05:00"), utc);
+    EXPECT_LT(keyOf("1999-12-31T23:59:59Z"), keyOf("2000-01-01T00:00:00Z"));
+}
+
+TEST(ISO8601KeySetTest, MatchesUnorderedSet) {
+    ISO8601KeySet key_set;
+    std::unordered_set<uint64_t> reference;
+    uint64_t state = 88172645463325252ull;
+    for (int i = 0; i < 200000; i++) {
+        // xorshift, folded into a small range so that many keys repeat.
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t key = (state % 50000) + 1;
+        EXPECT_EQ(reference.insert(key).second, key_set.insert(key));
+    }
+    EXPECT_EQ(reference.size(), key_set.size());
+    EXPECT_EQ(reference, std::unordered_set<uint64_t>(key_set.begin(), key_set.end()));
+    EXPECT_TRUE(key_set.contains(*reference.begin()));
+    EXPECT_FALSE(key_set.contains(50001));
+}
+
+TEST(ISO8601KeySetTest, ClearGivesBackATableGrownByABurst) {
+    ISO8601KeySet key_set;
+    const size_t empty_usage = key_set.memoryUsage();
+    for (uint64_t key = 1; key <= 100000; key++) {
+        key_set.insert(key);
+    }
+    const size_t burst_usage = key_set.memoryUsage();
+
+    // Emptied after the burst, the table keeps room for it.
+    key_set.clear();
+    EXPECT_EQ(burst_usage, key_set.memoryUsage());
+    EXPECT_FALSE(key_set.contains(1));
+
+    // Emptied after holding far fewer keys, the table shrinks to their size.
+    for (uint64_t key = 1; key <= 100; key++) {
+        key_set.insert(key);
+    }
+    key_set.clear();
+    EXPECT_EQ(empty_usage, key_set.memoryUsage());
+    EXPECT_TRUE(key_set.insert(100));
+    EXPECT_FALSE(key_set.insert(100));
+
+    ISO8601TextSet text_set;
+    const size_t empty_text_usage = text_set.memoryUsage();
+    for (int i = 0; i < 10000; i++) {
+        text_set.insert(std::to_string(i));
+    }
+    text_set.clear();
+    text_set.insert("1713700800.5");
+    const size_t text_burst_usage = text_set.memoryUsage();
+    text_set.clear();
+    EXPECT_LT(text_set.memoryUsage(), text_burst_usage);
+    EXPECT_EQ(empty_text_usage + ISO8601TextArena::SLAB_SIZE, text_set.memoryUsage());
+    EXPECT_TRUE(text_set.insert("1713700800.5").second);
+}
+
+TEST(ISO8601TextArenaTest, TextSetMatchesUnorderedSet) {
+    ISO8601TextSet text_set;
+    std::unordered_set<std::string> reference;
+    std::vector<std::pair<std::string_view, std::string>> stored;
+    uint64_t state = 88172645463325252ull;
+    for (int i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const std::string text = "2024-04-21T07:00:00." + std::to_string(state % 30000);
+        const auto [view, inserted] = text_set.insert(text);
+        EXPECT_EQ(reference.insert(text).second, inserted);
+        EXPECT_EQ(text, view);
+        if (i % 1000 == 0) {
+            stored.emplace_back(view, text);
+        }
+    }
+    // Longer than a slab, so it gets a slab of its own.
+    const std::string long_text(ISO8601TextArena::SLAB_SIZE + 1, '7');
+    EXPECT_TRUE(text_set.insert(long_text).second);
+    EXPECT_FALSE(text_set.insert(long_text).second);
+    EXPECT_EQ(reference.size() + 1, text_set.size());
+
+    // Growing the table and adding slabs leaves the stored text where it was.
+    for (const auto& [view, text] : stored) {
+        EXPECT_EQ(text, view);
+    }
+
+    text_set.clear();
+    EXPECT_EQ(0u, text_set.size());
+    EXPECT_TRUE(text_set.insert(stored.front().second).second);
+}
+
+TEST(ISO8601ApproximateSetTest, BloomFilterKeepsItsFalsePositiveRate) {
+    for (double rate : { 0.01, 0.001 }) {
+        ISO8601BlockedBloomFilter filter(100000, rate);
+        for (uint64_t key = 1; key <= 100000; key++) {
+            filter.insert(key << 13);
+        }
+        size_t false_positives = 0;
+        for (uint64_t key = 1; key <= 100000; key++) {
+            ASSERT_TRUE(filter.contains(key << 13));
+            EXPECT_FALSE(filter.insert(key << 13));
+            false_positives += filter.contains((key + 100000) << 13);
+        }
+        EXPECT_LT(false_positives / 100000.0, rate * 1.5) << "at rate " << rate;
+        EXPECT_LT(filter.memoryUsage(), size_t(100000 * 24 / 8)) << "at rate " << rate;
+    }
+}
+
+TEST(ISO8601ApproximateSetTest, HyperLogLogEstimatesDistinctValues) {
+    ISO8601HyperLogLog distinct;
+    EXPECT_EQ(0u, distinct.estimate());
+    uint64_t seen = 0;
+    for (uint64_t count : { 1000u, 100000u, 1000000u }) {
+        for (; seen < count; seen++) {
+            distinct.add(seen);
+            distinct.add(seen / 2); // Repeats do not count.
+        }
+        EXPECT_NEAR(double(count), double(distinct.estimate()), count * 0.03) << count;
+    }
+}
+
+TEST(ISO8601WindowedKeySetTest, ForgetsValuesBehindTheWindow) {
+    ISO8601WindowedKeySet window(600, ISO8601_KEY_INSTANT_SHIFT);
+    EXPECT_EQ(40, window.bucketSeconds());
+    const uint64_t start = keyOf("2024-04-21T12:00:00Z");
+    EXPECT_TRUE(window.insert(start));
+    EXPECT_FALSE(window.insert(keyOf("2024-04-21T14:00:00+02:00")));
+    EXPECT_TRUE(window.insert(keyOf("2024-04-21T12:10:00Z")));
+    EXPECT_FALSE(window.insert(start));
+    EXPECT_TRUE(window.insertText(ISO8601_KEY_UNIX_SECONDS(start), "1713700800.5"));
+    EXPECT_FALSE(window.insertText(ISO8601_KEY_UNIX_SECONDS(start), "1713700800.5"));
+
+    // Out of order values within the window are still deduplicated.
+    EXPECT_TRUE(window.insert(keyOf("2024-04-21T12:01:00Z")));
+    EXPECT_FALSE(window.insert(keyOf("2024-04-21T12:01:00Z")));
+    EXPECT_EQ(0u, window.lateValues());
+
+    // Once the high-water mark is more than a window and a bucket ahead, the start is forgotten.
+    EXPECT_TRUE(window.insert(keyOf("2024-04-21T12:10:41Z")));
+    EXPECT_TRUE(window.insert(start));
+    EXPECT_TRUE(window.insert(start));
+    EXPECT_EQ(2u, window.lateValues());
+    EXPECT_FALSE(window.insert(keyOf("2024-04-21T12:10:00Z")));
+
+    // Jumping far ahead empties every bucket.
+    EXPECT_TRUE(window.insert(keyOf("2024-04-22T00:00:00Z")));
+    EXPECT_TRUE(window.insert(keyOf("2024-04-21T23:55:00Z")));
+    EXPECT_TRUE(window.insert(keyOf("2024-04-21T12:10:00Z")));
+    EXPECT_EQ(3u, window.lateValues());
+}
+
+TEST(ISO8601UtcConversionTest, DaysFromCivil) {
+    EXPECT_EQ(0, iso8601_days_from_civil(1970, 1, 1));
+    EXPECT_EQ(-1, iso8601_days_from_civil(1969, 12, 31));
+    EXPECT_EQ(11016, iso8601_days_from_civil(2000, 2, 29));
+    EXPECT_EQ(19834, iso8601_days_from_civil(2024, 4, 21));
+    EXPECT_EQ(-719528, iso8601_days_from_civil(0, 1, 1));
+    EXPECT_EQ(2932896, iso8601_days_from_civil(9999, 12, 31));
+}
+
+TEST(ISO8601UtcConversionTest, ConvertsToUnixSeconds) {
+    int64_t seconds = 0;
+    ASSERT_TRUE(iso8601_datetime_to_unix_seconds("2024-04-21T14:00:00+02:00", 25, &seconds));
+    EXPECT_EQ(1713700800, seconds);
+    ASSERT_TRUE(iso8601_datetime_to_unix_seconds("2024-04-21T07:00:00-05:00", 25, &seconds));
+    EXPECT_EQ(1713700800, seconds);
+    ASSERT_TRUE(iso8601_datetime_to_unix_seconds("1970-01-01T00:00:00Z", 20, &seconds));
+    EXPECT_EQ(0, seconds);
+    EXPECT_FALSE(iso8601_datetime_to_unix_seconds("2024-04-21T25:00:00Z", 20, &seconds));
+}
+
+std::string formatUtc(const std::string& dt_str) {
+    int64_t seconds = 0;
+    EXPECT_TRUE(iso8601_datetime_to_unix_seconds(dt_str.data(), dt_str.size(), &seconds)) << dt_str;
+    char buffer[MAX_UTC_DATETIME_LENGTH];
+    return std::string(buffer, iso8601_format_utc(seconds, buffer));
+}
+
+TEST(ISO8601UtcConversionTest, FormatsCanonicalUtc) {
+    EXPECT_EQ("2024-04-21T12:00:00Z", formatUtc("2024-04-21T14:00:00+02:00"));
+    EXPECT_EQ("2024-04-22T04:59:00Z", formatUtc("2024-04-21T23:00:00-05:59"));
+    EXPECT_EQ("2024-04-21T12:00:00Z", formatUtc("2024-04-21T12:00:00Z"));
+    // Offsets can move an instant out of the four digit years.
+    EXPECT_EQ("+10000-01-01T23:58:59Z", formatUtc("9999-12-31T23:59:59-23:59"));
+    EXPECT_EQ("-0001-12-31T00:01:00Z", formatUtc("0000-01-01T00:00:00+23:59"));
+}
+
+TEST(ISO8601ProcessorTest, InstantDedupKeepsFirstNotation) {
+    const std::string input_file = temporaryOutputFile("iso8601_processor_instant_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_instant_output.txt");
+    {
+        std::ofstream input_stream(input_file);
+        input_stream << "2024-04-21T14:00:00+02:00\n"
+                     << "2024-04-21T12:00:00Z\n"
+                     << "2024-04-21T07:00:00-05:00\n"
+                     << "2024-04-21T12:00:01Z\n"
+                     << "2024-04-21T12:00:00+00:00\n";
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.dedup_mode = ISO8601DateTimeProcessor::DedupMode::Instant;
+    for (unsigned threads : { 1u, 4u }) {
+        options.threads = threads;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(std::unordered_set<std::string>({ "2024-04-21T14:00:00+02:00", "2024-04-21T12:00:01Z" }), readOutputSet(output_file));
+    }
+
+    options.output_format = ISO8601DateTimeProcessor::OutputFormat::CanonicalUtc;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(std::unordered_set<std::string>({ "2024-04-21T12:00:00Z", "2024-04-21T12:00:01Z" }), readOutputSet(output_file));
+
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, SortedOutputIsChronological) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_sorted.txt");
+
+    auto unique = expectedUniqueDateTimes(input_file);
+    std::vector<uint64_t> keys;
+    for (const auto& record : unique) {
+        keys.push_back(keyOf(record));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<std::string> expected;
+    for (uint64_t key : keys) {
+        expected.push_back(formatKey(key));
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::Sorted;
+    options.parallel_chunk_size = 16 * 1024;
+    for (unsigned threads : { 1u, 4u }) {
+        options.threads = threads;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(expected, readDateTimeRecords(output_file)) << "with " << threads << " threads";
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, FirstOccurrenceOutputFollowsInput) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_first_occurrence.txt");
+
+    std::vector<std::string> expected;
+    std::unordered_set<std::string> seen;
+    for (const auto& record : readDateTimeRecords(input_file)) {
+        if (ISO8601DateTimeProcessor::isDateTimeValid(record) && seen.insert(record).second) {
+            expected.push_back(record);
+        }
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    for (auto input_mode : { ISO8601DateTimeProcessor::InputMode::MemoryMapped, ISO8601DateTimeProcessor::InputMode::Streamed }) {
+        options.input_mode = input_mode;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(expected, readDateTimeRecords(output_file));
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, ApproximateDedupMatchesExactDedup) {
+    const std::string input_file = "test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_approximate.txt");
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    ISO8601DateTimeProcessor::ProcessingSummary summary;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    const std::vector<std::string> exact = readDateTimeRecords(output_file);
+    EXPECT_EQ(exact.size(), summary.unique_values);
+    EXPECT_EQ(0u, summary.estimated_distinct);
+
+    // Far below its capacity the filter should not lose a single value.
+    options.approximate_dedup = true;
+    options.approximate_capacity = 1 << 20;
+    options.false_positive_rate = 1e-6;
+    for (unsigned threads : { 1u, 2u }) {
+        options.threads = threads;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+        EXPECT_EQ(exact, readDateTimeRecords(output_file));
+        EXPECT_EQ(exact.size(), summary.unique_values);
+        EXPECT_NEAR(double(exact.size()), double(summary.estimated_distinct), exact.size() * 0.03);
+    }
+
+    // Far beyond it values are lost, but never repeated.
+    options.approximate_capacity = 100;
+    options.false_positive_rate = 0.01;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::Sorted;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    const std::unordered_set<std::string> approximate = readOutputSet(output_file);
+    EXPECT_LT(approximate.size(), exact.size());
+    EXPECT_EQ(approximate.size(), summary.unique_values);
+    for (const auto& value : approximate) {
+        EXPECT_NE(exact.end(), std::find(exact.begin(), exact.end(), value)) << value;
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, WindowedDedupOnNearlySortedStream) {
+    // One value every 10 seconds with retries up to two minutes later, shuffled by up to a minute.
+    const std::string input_file = temporaryOutputFile("iso8601_processor_window_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_window.txt");
+    std::vector<std::pair<int64_t, int64_t>> events; // Arrival time, value.
+    uint64_t state = 8601;
+    auto next = [&]() { state ^= state << 13; state ^= state >> 7; state ^= state << 17; return state; };
+    const int64_t start = 1713700800;
+    for (int64_t i = 0; i < 20000; i++) {
+        const int64_t value = start + i * 10;
+        events.emplace_back(value + int64_t(next() % 60), value);
+        if (next() % 4 == 0) {
+            events.emplace_back(value + int64_t(next() % 120), value);
+        }
+    }
+    // A retry long after its original, which the window no longer holds.
+    events.emplace_back(start + 300000, start);
+    std::sort(events.begin(), events.end());
+    {
+        std::ofstream input_stream(input_file, std::ios::binary);
+        char utc[MAX_UTC_DATETIME_LENGTH];
+        for (const auto& event : events) {
+            input_stream << std::string(utc, iso8601_format_utc(event.second, utc)) << "\n";
+        }
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    std::vector<std::string> expected = readDateTimeRecords(output_file);
+    EXPECT_EQ(20000u, expected.size());
+    expected.push_back("2024-04-21T12:00:00Z");
+
+    ISO8601DateTimeProcessor::ProcessingSummary summary;
+    options.dedup_window_seconds = 600;
+    for (unsigned threads : { 1u, 2u }) {
+        options.threads = threads;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+        EXPECT_EQ(expected, readDateTimeRecords(output_file));
+        EXPECT_EQ(1u, summary.late_values);
+        EXPECT_EQ(expected.size(), summary.unique_values);
+    }
+
+    options.approximate_dedup = true;
+    EXPECT_FALSE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ProcessorTest, IncrementalRunsOnlyProcessNewInput) {
+    const std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    const std::string input_file = temporaryOutputFile("iso8601_processor_incremental_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_incremental.txt");
+    const std::string expected_file = temporaryOutputFile("iso8601_processor_incremental_expected.txt");
+    const std::string index_file = temporaryOutputFile("iso8601_processor_incremental.idx");
+    std::filesystem::remove(output_file);
+    std::filesystem::remove(index_file);
+    auto append = [&](size_t begin, size_t end, const std::string& tail) {
+        std::ofstream input_stream(input_file, std::ios::binary | std::ios::app);
+        for (size_t i = begin; i < end; i++) {
+            input_stream << records[i] << "\n";
+        }
+        input_stream << tail;
+    };
+
+    // The second day repeats values of the first one, and ends with a line still being written.
+    std::filesystem::remove(input_file);
+    append(0, 5000, "");
+    const uint64_t first_size = std::filesystem::file_size(input_file);
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.index_file = index_file;
+    ISO8601DateTimeProcessor::ProcessingSummary summary;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(0u, summary.skipped_bytes);
+    append(5000, records.size(), "");
+    append(0, 1000, "2024-04-21T12:");
+    options.threads = 2;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(first_size, summary.skipped_bytes);
+
+    ISO8601DateTimeProcessor::ProcessingOptions whole;
+    whole.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, expected_file, whole));
+    const std::vector<std::string> expected = readDateTimeRecords(expected_file);
+    EXPECT_EQ(expected, readDateTimeRecords(output_file));
+
+    // Nothing new: nothing is written. The partial line is read once it is complete.
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(0u, summary.unique_values);
+    append(0, 0, "00:00Z\n");
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(1u, summary.unique_values);
+    EXPECT_EQ(expected.size() + 1, readOutputSet(output_file).size());
+
+    // A run that wrote its values but did not get to save the index is repeated without
+    // writing them twice.
+    const std::string saved_index_file = index_file + ".saved";
+    std::filesystem::copy_file(index_file, saved_index_file, std::filesystem::copy_options::overwrite_existing);
+    append(0, 0, "2024-04-23T12:00:00Z\n");
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    std::filesystem::copy_file(saved_index_file, index_file, std::filesystem::copy_options::overwrite_existing);
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(1u, summary.unique_values);
+    EXPECT_EQ(expected.size() + 2, readOutputSet(output_file).size());
+
+    // A rewritten input is read again, but only values the index does not hold are written.
+    std::filesystem::remove(input_file);
+    append(0, 10, "2024-04-22T12:00:00Z\n");
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::Sorted;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options, summary));
+    EXPECT_EQ(0u, summary.skipped_bytes);
+    EXPECT_EQ(1u, summary.unique_values);
+    EXPECT_EQ("2024-04-22T12:00:00Z", readDateTimeRecords(output_file).back());
+
+    options.dedup_mode = ISO8601DateTimeProcessor::DedupMode::Instant;
+    EXPECT_FALSE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    for (const auto& file : { input_file, output_file, expected_file, index_file, saved_index_file }) {
+        std::filesystem::remove(file);
+    }
+}
+
+TEST(ISO8601ProcessorTest, MultipleInputsShareOneDedupSet) {
+    using Processor = ISO8601DateTimeProcessor;
+    const std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    const std::filesystem::path directory = temporaryOutputFile("iso8601_processor_inputs");
+    const std::string concatenated_file = temporaryOutputFile("iso8601_processor_inputs_concatenated.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_inputs.txt");
+    const std::string expected_file = temporaryOutputFile("iso8601_processor_inputs_expected.txt");
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+
+    // The second file repeats the end of the first one, and the third is empty.
+    const std::vector<std::pair<size_t, size_t>> ranges = { { 0, 8000 }, { 6000, 10000 }, { 0, 0 } };
+    std::vector<std::string> expected_files;
+    std::ofstream concatenated(concatenated_file, std::ios::binary);
+    for (size_t f = 0; f < ranges.size(); f++) {
+        expected_files.push_back((directory / ("2024-04-2" + std::to_string(f) + ".txt")).string());
+        std::ofstream input_stream(expected_files.back(), std::ios::binary);
+        for (size_t i = ranges[f].first; i < ranges[f].second; i++) {
+            input_stream << records[i] << "\n";
+            concatenated << records[i] << "\n";
+        }
+    }
+    concatenated.close();
+    std::ofstream((directory / "notes.log").string()) << "2024-04-21T12:00:00Z\n";
+
+    std::vector<std::string> input_files;
+    ASSERT_TRUE(Processor::findInputFiles((directory / "2024-04-2?.txt").string(), input_files));
+    EXPECT_EQ(expected_files, input_files);
+    ASSERT_TRUE(Processor::findInputFiles(directory.string(), input_files));
+    EXPECT_EQ(4u, input_files.size());
+    EXPECT_FALSE(Processor::findInputFiles((directory / "*.csv").string(), input_files));
+    EXPECT_TRUE(Processor::isInputPattern(directory.string()));
+    EXPECT_TRUE(Processor::isInputPattern((directory / "*.txt").string()));
+    EXPECT_FALSE(Processor::isInputPattern(concatenated_file));
+
+    // Small chunks split the first file between the threads.
+    Processor::ProcessingOptions options;
+    options.threads = 4;
+    options.parallel_chunk_size = 16 * 1024;
+    options.output_order = Processor::OutputOrder::FirstOccurrence;
+    Processor::ProcessingSummary summary;
+    std::vector<Processor::InputSummary> input_summaries;
+    ASSERT_TRUE(Processor::processDateTimeFiles(expected_files, output_file, options, summary, input_summaries));
+    ASSERT_TRUE(Processor::processDateTime(concatenated_file, expected_file, options));
+    const std::vector<std::string> expected = readDateTimeRecords(expected_file);
+    EXPECT_EQ(expected, readDateTimeRecords(output_file));
+    EXPECT_EQ(expected.size(), summary.unique_values);
+
+    ASSERT_EQ(ranges.size(), input_summaries.size());
+    uint64_t unique_values = 0;
+    for (size_t f = 0; f < ranges.size(); f++) {
+        const Processor::InputSummary& input = input_summaries[f];
+        EXPECT_EQ(expected_files[f], input.input_file);
+        EXPECT_EQ(std::filesystem::file_size(expected_files[f]), input.bytes);
+        EXPECT_EQ(ranges[f].second - ranges[f].first, input.records);
+        EXPECT_LE(input.unique_values, input.valid_values);
+        unique_values += input.unique_values;
+    }
+    std::unordered_set<std::string> first_file;
+    for (size_t i = ranges[0].first; i < ranges[0].second; i++) {
+        if (Processor::isDateTimeValid(records[i])) {
+            first_file.insert(records[i]);
+        }
+    }
+    EXPECT_EQ(first_file.size(), input_summaries[0].unique_values);
+    EXPECT_EQ(0u, input_summaries[2].valid_values);
+    EXPECT_EQ(summary.unique_values, unique_values);
+
+    options.approximate_dedup = true;
+    EXPECT_FALSE(Processor::processDateTimeFiles(expected_files, output_file, options, summary, input_summaries));
+    std::filesystem::remove_all(directory);
+    for (const auto& file : { concatenated_file, output_file, expected_file }) {
+        std::filesystem::remove(file);
+    }
+}
+
+TEST(ISO8601ProcessorTest, MetricsCountRejectionReasonsAndStages) {
+    using Metrics = ISO8601Metrics;
+    const std::string input_file = temporaryOutputFile("iso8601_processor_metrics_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_metrics.txt");
+    {
+        std::ofstream input_stream(input_file, std::ios::binary);
+        input_stream << "2024-04-21T12:00:00Z\n2024-04-21T12:34:56\n2024-04-21T12:00:00Z\n2024/04-21T12:34:56Z\n"
+            "20x4-04-21T12:34:56Z\n2024-13-21T12:34:56Z\n2024-04-31T12:34:56Z\n2023-02-29T12:34:56Z\n"
+            "2024-02-29T12:00:00Z\n2024-04-21T24:34:56Z\n2024-04-21T12:34:56+24:00\n2024-04-21T12:34:56+01:60\n"
+            "2024-04-21T14:00:00+02:00\n2023-366T12:00:00Z\n2024-04-21T12:00:00Z\n";
+    }
+    const uint64_t input_size = std::filesystem::file_size(input_file);
+
+    Metrics metrics;
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.metrics = &metrics;
+    for (auto input_mode : { ISO8601DateTimeProcessor::InputMode::MemoryMapped, ISO8601DateTimeProcessor::InputMode::Streamed }) {
+        for (unsigned threads : { 1u, 2u }) {
+            options.input_mode = input_mode;
+            options.threads = threads;
+            ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+            const Metrics::Counters total = metrics.total();
+            std::vector<uint64_t> expected_rejected(Metrics::REASONS);
+            for (auto reason : { Metrics::Reason::Length, Metrics::Reason::Separator, Metrics::Reason::Digit, Metrics::Reason::Month,
+                     Metrics::Reason::Day, Metrics::Reason::LeapDay, Metrics::Reason::Hour, Metrics::Reason::Format }) {
+                expected_rejected[size_t(reason)] = 1;
+            }
+            expected_rejected[size_t(Metrics::Reason::Offset)] = 2;
+            EXPECT_EQ(expected_rejected, std::vector<uint64_t>(total.rejected.begin(), total.rejected.end()));
+            EXPECT_EQ(2u, total.duplicates);
+            EXPECT_EQ(input_size, total.bytes[size_t(Metrics::Stage::Read)]);
+            EXPECT_EQ(input_size, total.bytes[size_t(Metrics::Stage::Validate)]);
+            EXPECT_EQ(15u, total.records[size_t(Metrics::Stage::Validate)]);
+            EXPECT_EQ(5u, total.records[size_t(Metrics::Stage::Dedup)]);
+            EXPECT_EQ(3u, total.records[size_t(Metrics::Stage::Write)]);
+            EXPECT_EQ(std::filesystem::file_size(output_file), total.bytes[size_t(Metrics::Stage::Write)]);
+            EXPECT_GT(total.nanoseconds[size_t(Metrics::Stage::Validate)], 0u);
+        }
+    }
+
+    // The 366th day of a common year is a leap day once ordinal dates are accepted.
+    options.accepted_formats = ISO8601_ACCEPT_ALL_DATETIMES;
+    options.threads = 1;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(2u, metrics.total().rejected[size_t(Metrics::Reason::LeapDay)]);
+    EXPECT_EQ(0u, metrics.total().rejected[size_t(Metrics::Reason::Format)]);
+
+    std::ostringstream json;
+    metrics.writeJson(json);
+    EXPECT_NE(std::string::npos, json.str().find("{\"threads\":[{\"thread\":0,\"rejected\":{\"length\":1,")) << json.str();
+    EXPECT_NE(std::string::npos, json.str().find("\"leap_day\":2,")) << json.str();
+    EXPECT_NE(std::string::npos, json.str().find("\"duplicates\":2,")) << json.str();
+    std::ostringstream prometheus;
+    metrics.writePrometheus(prometheus);
+    EXPECT_NE(std::string::npos, prometheus.str().find("# TYPE iso8601_rejected_records_total counter\n")) << prometheus.str();
+    EXPECT_NE(std::string::npos, prometheus.str().find("iso8601_rejected_records_total{thread=\"0\",reason=\"offset\"} 2\n"));
+    EXPECT_NE(std::string::npos, prometheus.str().find("iso8601_stage_records_total{thread=\"0\",stage=\"write\"} 3\n"));
+    EXPECT_TRUE(std::regex_search(prometheus.str(), std::regex("iso8601_stage_seconds_total\\{thread=\"0\",stage=\"validate\"\\} 0\\.\\d{9}\n")));
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601RadixSortTest, MatchesStdSort) {
+    std::vector<uint64_t> keys;
+    uint64_t state = 0x243F6A8885A308D3ull;
+    for (int i = 0; i < 100000; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        keys.push_back((state >> 12) | 1);
+    }
+    std::vector<uint64_t> expected = keys;
+    std::sort(expected.begin(), expected.end());
+    iso8601RadixSortKeys(keys);
+    EXPECT_EQ(expected, keys);
+
+    // Keys that only differ in one digit skip the other passes.
+    std::vector<uint64_t> same_digits;
+    for (int i = 1000; i > 0; i--) {
+        same_digits.push_back((uint64_t(i % 7) << 40) | 0x1234);
+    }
+    expected = same_digits;
+    std::sort(expected.begin(), expected.end());
+    iso8601RadixSortKeys(same_digits);
+    EXPECT_EQ(expected, same_digits);
+}
+
+// Matches of iso8601_find_datetimes as strings.
+std::vector<std::string> findDateTimes(const std::string& text) {
+    std::vector<std::string> found;
+    for (const auto& match : ISO8601DateTimeProcessor::findDateTimes(text)) {
+        EXPECT_EQ(text.data() + match.offset, match.value.data());
+        found.emplace_back(match.value);
+    }
+    return found;
+}
+
+TEST(ISO8601TextScanTest, FindsEveryDateTimeInLine) {
+    const std::string line = "start 2024-04-21T12:34:56Z then 2021-10-21T12:34:56+05:30, bad 2024-13-21T12:34:56Z "
+                             "2024-04-21T12:34:56X and last:1999-02-28T23:59:59-23:59";
+    auto matches = ISO8601DateTimeProcessor::findDateTimes(line);
+    ASSERT_EQ(3u, matches.size());
+    EXPECT_EQ(6u, matches[0].offset);
+    EXPECT_EQ("2024-04-21T12:34:56Z", matches[0].value);
+    EXPECT_EQ(32u, matches[1].offset);
+    EXPECT_EQ("2021-10-21T12:34:56+05:30", matches[1].value);
+    EXPECT_EQ(line.size() - 25, matches[2].offset);
+    EXPECT_EQ("1999-02-28T23:59:59-23:59", matches[2].value);
+}
+
+TEST(ISO8601TextScanTest, SkipsPartsOfLongerTokens) {
+    EXPECT_TRUE(findDateTimes("12024-04-21T12:34:56Z").empty());
+    EXPECT_TRUE(findDateTimes("2021-10-21T12:34:56+05:301").empty());
+    EXPECT_EQ(std::vector<std::string>({ "2024-04-21T12:34:56Z" }), findDateTimes("2024-04-21T12:34:56Z2024"));
+    EXPECT_EQ(std::vector<std::string>({ "2024-04-21T12:34:56Z", "2024-04-21T12:34:57Z" }),
+        findDateTimes("2024-04-21T12:34:56Z2024-04-21T12:34:57Z"));
+    EXPECT_TRUE(findDateTimes("").empty());
+    EXPECT_TRUE(findDateTimes("2024-04-21T12:34:56").empty());
+}
+
+TEST(ISO8601TextScanTest, ResumesAfterMaxMatches) {
+    std::string text;
+    for (int i = 0; i < 10; i++) {
+        text += "x 2024-04-21T12:34:5" + std::to_string(i) + "Z";
+    }
+    iso8601_record_span matches[4];
+    size_t offset = 0;
+    std::vector<std::string> found;
+    size_t count;
+    do {
+        size_t scanned = 0;
+        count = iso8601_find_datetimes(text.data() + offset, text.size() - offset, matches, 4, &scanned);
+        for (size_t i = 0; i < count; i++) {
+            found.push_back(text.substr(offset + matches[i].offset, matches[i].length));
+        }
+        offset += scanned;
+    } while (count == 4);
+    EXPECT_EQ(text.size(), offset);
+    EXPECT_EQ(10u, found.size());
+    EXPECT_EQ("2024-04-21T12:34:59Z", found.back());
+}
+
+TEST(ISO8601TextScanTest, MatchesPositionByPositionSearch) {
+    // Random text made of date-time fragments, checked against trying every start position.
+    const std::vector<std::string> pieces = { "2024-04-21T12:34:56Z", "2021-10-21T12:34:56+05:30", "1999-02-28T23:59:59-23:59",
+        "2024-13-21T12:34:56Z", "2024-04-21T", "-", "T", "Z", "7", " ", "+05:30", "2024-04-21", "\n" };
+    std::mt19937 random(8601);
+    for (int round = 0; round < 2000; round++) {
+        std::string text;
+        for (int i = std::uniform_int_distribution<int>(0, 12)(random); i > 0; i--) {
+            text += pieces[random() % pieces.size()];
+        }
+
+        std::vector<std::string> expected;
+        auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+        for (size_t start = 0; start < text.size();) {
+            size_t length = 0;
+            if (start == 0 || !is_digit(text[start - 1])) {
+                if (text.size() - start >= 25 && (text.size() - start == 25 || !is_digit(text[start + 25])) &&
+                    is_valid_iso8601_datetime_n(text.data() + start, 25)) {
+                    length = 25;
+                }
+                else if (text.size() - start >= 20 && is_valid_iso8601_datetime_n(text.data() + start, 20)) {
+                    length = 20;
+                }
+            }
+            if (length > 0) {
+                expected.push_back(text.substr(start, length));
+            }
+            start += length > 0 ? length : 1;
+        }
+        EXPECT_EQ(expected, findDateTimes(text)) << text;
+    }
+}
+
+TEST(ISO8601ProcessorTest, ExtractsDateTimesFromFreeText) {
+    const std::string input_file = "test_inputs/generated_mixed_text_message_datetime.txt";
+    const std::string output_file = temporaryOutputFile("iso8601_processor_free_text.txt");
+
+    // The regular expression the extraction used to be based on.
+    const std::regex pattern("\\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}(Z|\\+\\d{2}:\\d{2}|\\-\\d{2}:\\d{2})");
+    std::unordered_set<std::string> expected;
+    for (const auto& line : readDateTimeRecords(input_file)) {
+        for (std::sregex_iterator match(line.begin(), line.end(), pattern), end; match != end; ++match) {
+            if (ISO8601DateTimeProcessor::isDateTimeValid(match->str())) {
+                expected.insert(match->str());
+            }
+        }
+    }
+    ASSERT_EQ(10u, expected.size());
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.record_layout = ISO8601DateTimeProcessor::RecordLayout::FreeText;
+    for (unsigned threads : { 1u, 4u }) {
+        options.threads = threads;
+        options.parallel_chunk_size = 256;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+        EXPECT_EQ(expected, readOutputSet(output_file));
+    }
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601CorpusGeneratorTest, IsDeterministicAndFollowsRatios) {
+    ISO8601CorpusGenerator::CorpusOptions options;
+    options.invalid_ratio = 0.25;
+    options.duplicate_ratio = 0.5;
+    options.offset_ratio = 0.75;
+    ISO8601CorpusGenerator generator(options);
+    ISO8601CorpusGenerator same_seed(options);
+
+    const int rows = 40000;
+    int invalid = 0;
+    int offsets = 0;
+    std::unordered_set<std::string> unique;
+    for (int row = 0; row < rows; row++) {
+        std::string record = generator.nextRecord();
+        ASSERT_EQ(record, same_seed.nextRecord());
+        if (!ISO8601DateTimeProcessor::isDateTimeValid(record)) {
+            invalid++;
+            continue;
+        }
+        offsets += record.size() == 25;
+        unique.insert(record);
+    }
+
+    const int valid = rows - invalid;
+    EXPECT_NEAR(0.25, double(invalid) / rows, 0.02);
+    EXPECT_NEAR(0.5, 1.0 - double(unique.size()) / valid, 0.02);
+    EXPECT_NEAR(0.75, double(offsets) / valid, 0.02);
+}
+
+TEST(ISO8601ParseTest, DecodesFields) {
+    iso8601_datetime parsed;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime("2024-02-29T23:58:07Z", parsed));
+    EXPECT_EQ(2024, parsed.year);
+    EXPECT_EQ(2, parsed.month);
+    EXPECT_EQ(29, parsed.day);
+    EXPECT_EQ(23, parsed.hour);
+    EXPECT_EQ(58, parsed.minute);
+    EXPECT_EQ(7, parsed.second);
+    EXPECT_EQ(0, parsed.fraction_digits);
+    EXPECT_EQ(0, parsed.offset_minutes);
+    EXPECT_EQ(0u, parsed.format);
+    EXPECT_EQ(ISO8601_ERROR_NONE, parsed.error);
+
+    ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime("0001-12-31T00:00:00-09:30", parsed));
+    EXPECT_EQ(1, parsed.year);
+    EXPECT_EQ(12, parsed.month);
+    EXPECT_EQ(31, parsed.day);
+    EXPECT_EQ(-570, parsed.offset_minutes);
+    EXPECT_EQ(ISO8601_FORMAT_OFFSET, parsed.format);
+
+    ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime("2021-10-21T12:34:56+05:45", parsed));
+    EXPECT_EQ(345, parsed.offset_minutes);
+    int64_t seconds = 0;
+    ASSERT_TRUE(iso8601_datetime_to_unix_seconds("2021-10-21T12:34:56+05:45", 25, &seconds));
+    EXPECT_EQ(seconds, iso8601_parsed_to_unix_seconds(&parsed));
+}
+
+TEST(ISO8601ParseTest, ReportsFirstErrorAndPosition) {
+    struct Case {
+        const char* dt_str;
+        iso8601_error error;
+        uint32_t position;
+    };
+    const Case cases[] = {
+        { "", ISO8601_ERROR_LENGTH, 0 },
+        { "2024-04-21", ISO8601_ERROR_LENGTH, 10 },
+        { "2024-04-21T12:34:56", ISO8601_ERROR_LENGTH, 19 },
+        { "2024-04-21T12:34:56Zx", ISO8601_ERROR_LENGTH, 20 },
+        { "2024-04-21T12:34:56+01:00:00", ISO8601_ERROR_LENGTH, 25 },
+        { "2024-04-21T12:34:56+01", ISO8601_ERROR_LENGTH, 22 },
+        { "20x4-04-21T12:34:56Z", ISO8601_ERROR_DIGIT, 2 },
+        { "2024/04-21T12:34:56Z", ISO8601_ERROR_SEPARATOR, 4 },
+        { "2024-13-21T12:34:56Z", ISO8601_ERROR_MONTH, 5 },
+        { "2024-13-32T25:34:56Z", ISO8601_ERROR_MONTH, 5 },
+        { "2023-02-29T12:34:56Z", ISO8601_ERROR_DAY, 8 },
+        { "2024-04-21 12:34:56Z", ISO8601_ERROR_SEPARATOR, 10 },
+        { "2024-04-21T24:34:56Z", ISO8601_ERROR_HOUR, 11 },
+        { "2024-04-21T12-34:56Z", ISO8601_ERROR_SEPARATOR, 13 },
+        { "2024-04-21T12:60:56Z", ISO8601_ERROR_MINUTE, 14 },
+        { "2024-04-21T12:34:60Z", ISO8601_ERROR_SECOND, 17 },
+        { "2024-04-21T12:34:5aZ", ISO8601_ERROR_DIGIT, 18 },
+        { "2024-04-21T12:34:56X", ISO8601_ERROR_DESIGNATOR, 19 },
+        { "2024-04-21T12:34:56+24:00", ISO8601_ERROR_OFFSET_HOUR, 20 },
+        { "2024-04-21T12:34:56+01-00", ISO8601_ERROR_SEPARATOR, 22 },
+        { "2024-04-21T12:34:56+01:60", ISO8601_ERROR_OFFSET_MINUTE, 23 },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_datetime parsed;
+        EXPECT_FALSE(iso8601_parse_datetime(test_case.dt_str, strlen(test_case.dt_str), &parsed)) << test_case.dt_str;
+        EXPECT_EQ(test_case.error, parsed.error) << test_case.dt_str << ": " << iso8601_error_message(parsed.error);
+        EXPECT_EQ(test_case.position, parsed.error_position) << test_case.dt_str;
+    }
+}
+
+TEST(ISO8601ParseTest, AgreesWithValidatorAndKey) {
+    std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    for (const auto& record : records) {
+        iso8601_datetime parsed;
+        bool valid = ISO8601DateTimeProcessor::parseDateTime(record, parsed);
+        ASSERT_EQ(ISO8601DateTimeProcessor::isDateTimeValid(record), valid) << record;
+        if (valid) {
+            EXPECT_EQ(ISO8601_KEY_UNIX_SECONDS(keyOf(record)), iso8601_parsed_to_unix_seconds(&parsed)) << record;
+        }
+        else {
+            EXPECT_NE(ISO8601_ERROR_NONE, parsed.error) << record;
+            EXPECT_LE(parsed.error_position, record.size()) << record;
+        }
+    }
+}
+
+TEST(ISO8601ParseTest, DecodesBasicFractionAndReducedFormats) {
+    struct Case {
+        const char* dt_str;
+        int second;
+        uint32_t fraction;
+        int fraction_digits;
+        int offset_minutes;
+        unsigned format;
+    };
+    const Case cases[] = {
+        { "20240421T123456Z", 56, 0, 0, 0, ISO8601_FORMAT_BASIC },
+        { "20240421T123456+0530", 56, 0, 0, 330, ISO8601_FORMAT_BASIC | ISO8601_FORMAT_OFFSET },
+        { "2024-04-21T12:34:56.5Z", 56, 500000000, 1, 0, 0 },
+        { "2024-04-21T12:34:56,123456789-01:00", 56, 123456789, 9, -60, ISO8601_FORMAT_COMMA | ISO8601_FORMAT_OFFSET },
+        { "20240421T123456,25Z", 56, 250000000, 2, 0, ISO8601_FORMAT_BASIC | ISO8601_FORMAT_COMMA },
+        { "2024-04-21T12:34Z", 0, 0, 0, 0, ISO8601_FORMAT_REDUCED },
+        { "2024-04-21T12:34,5Z", 30, 0, 1, 0, ISO8601_FORMAT_REDUCED | ISO8601_FORMAT_COMMA },
+        { "20240421T1234.25+0100", 15, 0, 2, 60, ISO8601_FORMAT_BASIC | ISO8601_FORMAT_REDUCED | ISO8601_FORMAT_OFFSET },
+        { "2024-04-21T12:34.001Z", 0, 60000000, 3, 0, ISO8601_FORMAT_REDUCED },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_datetime parsed;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime(test_case.dt_str, ISO8601_ACCEPT_ALL_DATETIMES, parsed))
+            << test_case.dt_str << ": " << iso8601_error_message(parsed.error);
+        EXPECT_EQ(2024, parsed.year) << test_case.dt_str;
+        EXPECT_EQ(4, parsed.month) << test_case.dt_str;
+        EXPECT_EQ(21, parsed.day) << test_case.dt_str;
+        EXPECT_EQ(12, parsed.hour) << test_case.dt_str;
+        EXPECT_EQ(34, parsed.minute) << test_case.dt_str;
+        EXPECT_EQ(test_case.second, parsed.second) << test_case.dt_str;
+        EXPECT_EQ(test_case.fraction, parsed.fraction) << test_case.dt_str;
+        EXPECT_EQ(test_case.fraction_digits, parsed.fraction_digits) << test_case.dt_str;
+        EXPECT_EQ(test_case.offset_minutes, parsed.offset_minutes) << test_case.dt_str;
+        EXPECT_EQ(test_case.format, parsed.format) << test_case.dt_str;
+        EXPECT_TRUE(is_valid_iso8601_datetime_format(test_case.dt_str, strlen(test_case.dt_str), ISO8601_ACCEPT_ALL_DATETIMES));
+    }
+
+    EXPECT_TRUE(is_valid_basic_iso8601_datetime_format("20240229T235959Z"));
+    EXPECT_TRUE(is_valid_basic_iso8601_datetime_format("20240421T1234,5-0930"));
+    EXPECT_FALSE(is_valid_basic_iso8601_datetime_format("20230229T235959Z"));
+    EXPECT_FALSE(is_valid_basic_iso8601_datetime_format("2024-04-21T12:34:56Z"));
+    EXPECT_FALSE(is_valid_basic_iso8601_datetime_format("20240421T123456+05:30"));
+}
+
+TEST(ISO8601ParseTest, RejectsFormatsThatAreNotAccepted) {
+    struct Case {
+        const char* dt_str;
+        unsigned accepted_formats;
+        iso8601_error error;
+        uint32_t position;
+    };
+    const Case cases[] = {
+        { "20240421T123456Z", ISO8601_ACCEPT_EXTENDED, ISO8601_ERROR_FORMAT, 4 },
+        { "2024-04-21T12:34:56Z", ISO8601_ACCEPT_BASIC, ISO8601_ERROR_FORMAT, 4 },
+        { "2024-04-21T12:34:56.5Z", ISO8601_ACCEPT_EXTENDED, ISO8601_ERROR_FORMAT, 19 },
+        { "2024-04-21T12:34Z", ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_FRACTION, ISO8601_ERROR_SEPARATOR, 16 },
+        { "2024-04-21T12:34:56.1234567890Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_FRACTION, 29 },
+        { "2024-04-21T12:34:56.Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 20 },
+        { "2024-04-21T12:34:56,5", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_LENGTH, 21 },
+        { "2024-0421T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_SEPARATOR, 8 }, // Read as the ordinal date 2024-042.
+        { "20240421T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 11 },
+        { "20240421T123456+05:30", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 18 },
+        { "20240431T1234Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DAY, 6 },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_datetime parsed;
+        EXPECT_FALSE(ISO8601DateTimeProcessor::parseDateTime(test_case.dt_str, test_case.accepted_formats, parsed)) << test_case.dt_str;
+        EXPECT_EQ(test_case.error, parsed.error) << test_case.dt_str << ": " << iso8601_error_message(parsed.error);
+        EXPECT_EQ(test_case.position, parsed.error_position) << test_case.dt_str;
+    }
+}
+
+TEST(ISO8601ParseTest, ExtendedFormatMatchesFastPath) {
+    std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    for (const auto& record : records) {
+        bool valid = ISO8601DateTimeProcessor::isDateTimeValid(record);
+        EXPECT_EQ(valid, is_valid_iso8601_datetime_format(record.data(), record.size(), ISO8601_ACCEPT_EXTENDED)) << record;
+
+        // Every other format only adds strings to the extended ones.
+        iso8601_datetime parsed;
+        if (valid) {
+            ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime(record, ISO8601_ACCEPT_ALL_DATETIMES, parsed)) << record;
+            EXPECT_EQ(ISO8601_KEY_UNIX_SECONDS(keyOf(record)), iso8601_parsed_to_unix_seconds(&parsed)) << record;
+        }
+    }
+}
+
+TEST(ISO8601ProcessorTest, AcceptsOtherFormats) {
+    const std::string input_file = temporaryOutputFile("iso8601_processor_formats_input.txt");
+    const std::string output_file = temporaryOutputFile("iso8601_processor_formats_output.txt");
+    {
+        std::ofstream input_stream(input_file);
+        input_stream << "2024-04-21T12:00:00.250Z\n"
+                     << "20240421T140000+0200\n"
+                     << "2024-04-21T12:00:00Z\n"
+                     << "2024-04-21T11:59Z\n"
+                     << "2024-04-21T14:00:00,25+02:00\n"
+                     << "20240421T120000Z\n"
+                     << "2024-04-21T12:00:00.1234567891Z\n";
+    }
+
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    options.threads = 4;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(std::unordered_set<std::string>({ "2024-04-21T12:00:00Z" }), readOutputSet(output_file));
+
+    options.accepted_formats = ISO8601_ACCEPT_ALL_DATETIMES;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::Sorted;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(std::vector<std::string>({ "2024-04-21T11:59Z", "2024-04-21T12:00:00Z", "20240421T120000Z",
+        "20240421T140000+0200", "2024-04-21T12:00:00.250Z", "2024-04-21T14:00:00,25+02:00" }), readDateTimeRecords(output_file));
+
+    options.dedup_mode = ISO8601DateTimeProcessor::DedupMode::Instant;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::FirstOccurrence;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(std::vector<std::string>({ "2024-04-21T12:00:00.250Z", "20240421T140000+0200", "2024-04-21T11:59Z" }),
+        readDateTimeRecords(output_file));
+
+    options.output_format = ISO8601DateTimeProcessor::OutputFormat::CanonicalUtc;
+    options.output_order = ISO8601DateTimeProcessor::OutputOrder::Sorted;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::processDateTime(input_file, output_file, options));
+    EXPECT_EQ(std::vector<std::string>({ "2024-04-21T11:59:00Z", "2024-04-21T12:00:00Z", "2024-04-21T12:00:00.25Z" }),
+        readDateTimeRecords(output_file));
+
+    std::filesystem::remove(input_file);
+    std::filesystem::remove(output_file);
+}
+
+TEST(ISO8601ParseTest, DecodesOrdinalWeekAndExpandedDates) {
+    struct Case {
+        const char* dt_str;
+        int year;
+        int month;
+        int day;
+        unsigned format;
+    };
+    const Case cases[] = {
+        { "2024-112T12:34:56Z", 2024, 4, 21, ISO8601_FORMAT_ORDINAL },
+        { "2024112T123456Z", 2024, 4, 21, ISO8601_FORMAT_BASIC | ISO8601_FORMAT_ORDINAL },
+        { "2024-366T12:34:56Z", 2024, 12, 31, ISO8601_FORMAT_ORDINAL },
+        { "2023-060T12:34:56Z", 2023, 3, 1, ISO8601_FORMAT_ORDINAL },
+        { "2024-W16-7T12:34:56Z", 2024, 4, 21, ISO8601_FORMAT_WEEK },
+        { "2024W167T123456Z", 2024, 4, 21, ISO8601_FORMAT_BASIC | ISO8601_FORMAT_WEEK },
+        { "2020-W53-5T12:34:56Z", 2021, 1, 1, ISO8601_FORMAT_WEEK },
+        { "2021-W01-1T12:34:56Z", 2021, 1, 4, ISO8601_FORMAT_WEEK },
+        { "2025-W01-1T12:34:56Z", 2024, 12, 30, ISO8601_FORMAT_WEEK },
+        { "2026-W53-7T12:34:56Z", 2027, 1, 3, ISO8601_FORMAT_WEEK },
+        { "+012024-04-21T12:34:56Z", 12024, 4, 21, ISO8601_FORMAT_EXPANDED },
+        { "-000004-060T12:34:56Z", -4, 2, 29, ISO8601_FORMAT_EXPANDED | ISO8601_FORMAT_ORDINAL },
+        { "+002024W167T123456Z", 2024, 4, 21, ISO8601_FORMAT_EXPANDED | ISO8601_FORMAT_BASIC | ISO8601_FORMAT_WEEK },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_datetime parsed;
+        ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime(test_case.dt_str, ISO8601_ACCEPT_ALL_DATETIMES, parsed))
+            << test_case.dt_str << ": " << iso8601_error_message(parsed.error);
+        EXPECT_EQ(test_case.year, parsed.year) << test_case.dt_str;
+        EXPECT_EQ(test_case.month, parsed.month) << test_case.dt_str;
+        EXPECT_EQ(test_case.day, parsed.day) << test_case.dt_str;
+        EXPECT_EQ(test_case.format, parsed.format) << test_case.dt_str;
+        EXPECT_TRUE(is_valid_expanded_iso8601_datetime(test_case.dt_str)) << test_case.dt_str;
+    }
+
+    char utc[MAX_UTC_DATETIME_LENGTH];
+    iso8601_datetime parsed;
+    ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime("+999999-365T23:59:59-23:59", ISO8601_ACCEPT_ALL_DATETIMES, parsed));
+    EXPECT_EQ("+1000000-01-01T23:58:59Z", std::string(utc, iso8601_format_utc(iso8601_parsed_to_unix_seconds(&parsed), utc)));
+}
+
+TEST(ISO8601ParseTest, RejectsInvalidOrdinalAndWeekDates) {
+    struct Case {
+        const char* dt_str;
+        unsigned accepted_formats;
+        iso8601_error error;
+        uint32_t position;
+    };
+    const Case cases[] = {
+        { "2023-366T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DAY, 5 },
+        { "2024-000T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DAY, 5 },
+        { "2024-1x2T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 6 },
+        { "2021-W53-1T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_WEEK, 6 },
+        { "2024-W00-1T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_WEEK, 6 },
+        { "2024-W16-8T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_WEEKDAY, 9 },
+        { "2024-W167T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_SEPARATOR, 8 },
+        { "+02024-04-21T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 6 },
+        { "+0x1234-04-21T12:34:56Z", ISO8601_ACCEPT_ALL_DATETIMES, ISO8601_ERROR_DIGIT, 2 },
+        { "2024-112T12:34:56Z", ISO8601_ACCEPT_EXTENDED, ISO8601_ERROR_FORMAT, 5 },
+        { "2024-W16-7T12:34:56Z", ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_ORDINAL, ISO8601_ERROR_FORMAT, 5 },
+        { "+012024-04-21T12:34:56Z", ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_WEEK, ISO8601_ERROR_FORMAT, 0 },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_datetime parsed;
+        EXPECT_FALSE(ISO8601DateTimeProcessor::parseDateTime(test_case.dt_str, test_case.accepted_formats, parsed)) << test_case.dt_str;
+        EXPECT_EQ(test_case.error, parsed.error) << test_case.dt_str << ": " << iso8601_error_message(parsed.error);
+        EXPECT_EQ(test_case.position, parsed.error_position) << test_case.dt_str;
+    }
+}
+
+TEST(ISO8601ParseTest, EveryOrdinalAndWeekDateMatchesChrono) {
+    using namespace std::chrono;
+    for (int y = -1000; y <= 3000; y++) {
+        // The week of the 28th of December is the last week of the year.
+        const sys_days december_28 = year_month_day(year(y), December, day(28));
+        const sys_days thursday = december_28 + days(3) - days(weekday(december_28).iso_encoding() - 1);
+        const sys_days january_1 = year_month_day(year_month_day(thursday).year(), January, day(1));
+        ASSERT_EQ(unsigned((thursday - january_1).count() / 7 + 1), iso8601_weeks_in_year(y)) << y;
+    }
+
+    char dt_str[32];
+    const sys_days first = year_month_day(year(1899), January, day(1));
+    const sys_days last = year_month_day(year(2101), December, day(31));
+    for (sys_days date = first; date <= last; date += days(1)) {
+        const year_month_day calendar(date);
+        const int y = int(calendar.year());
+        const unsigned m = unsigned(calendar.month());
+        const unsigned d = unsigned(calendar.day());
+
+        // ISO week: the week containing the Thursday of the same week.
+        const unsigned iso_weekday = weekday(date).iso_encoding();
+        const sys_days thursday = date + days(4) - days(iso_weekday);
+        const year_month_day thursday_calendar(thursday);
+        const int week_year = int(thursday_calendar.year());
+        const unsigned week = unsigned((thursday - sys_days(year_month_day(thursday_calendar.year(), January, day(1)))).count() / 7 + 1);
+        const unsigned ordinal = unsigned((date - sys_days(year_month_day(calendar.year(), January, day(1)))).count() + 1);
+
+        iso8601_datetime parsed;
+        std::snprintf(dt_str, sizeof(dt_str), "%04d-W%02u-%uT12:34:56Z", week_year, week, iso_weekday);
+        ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime(dt_str, ISO8601_ACCEPT_ALL_DATETIMES, parsed)) << dt_str;
+        ASSERT_EQ(std::make_tuple(y, m, d), std::make_tuple(int(parsed.year), unsigned(parsed.month), unsigned(parsed.day))) << dt_str;
+
+        std::snprintf(dt_str, sizeof(dt_str), "%+07d%03uT123456Z", y, ordinal);
+        ASSERT_TRUE(ISO8601DateTimeProcessor::parseDateTime(dt_str, ISO8601_ACCEPT_ALL_DATETIMES, parsed)) << dt_str;
+        ASSERT_EQ(std::make_tuple(y, m, d), std::make_tuple(int(parsed.year), unsigned(parsed.month), unsigned(parsed.day))) << dt_str;
+    }
+}
+
+// Records of every notation for comparing ISO8601StaticValidator with the C library:
+// the fixtures, generated records of each shape and single character mutations.
+std::vector<std::string> staticValidatorCorpus() {
+    std::vector<std::string> records = readDateTimeRecords("test_inputs/generated_mixed_iso8601_datetime_10000_invalid_2901.txt");
+    ISO8601CorpusGenerator generator(ISO8601CorpusGenerator::CorpusOptions{});
+    for (auto shape : { ISO8601CorpusGenerator::RecordShape::OutOfRange, ISO8601CorpusGenerator::RecordShape::Malformed,
+        ISO8601CorpusGenerator::RecordShape::Calendar, ISO8601CorpusGenerator::RecordShape::Basic,
+        ISO8601CorpusGenerator::RecordShape::Ordinal, ISO8601CorpusGenerator::RecordShape::Week,
+        ISO8601CorpusGenerator::RecordShape::Expanded }) {
+        for (int i = 0; i < 2000; i++) {
+            records.push_back(generator.shapeRecord(shape));
+        }
+    }
+    const std::vector<std::string> mutations = singleCharacterMutations(
+        { "2024-04-21T12:34:56Z", "2000-02-29T00:00:00-23:59", "20240421T123456,5+0100", "20240421T1234,5Z",
+          "2024-04-21T12:34.25Z", "2024-04-21T12:34:56.123456789Z", "2024-366T12:34:56+05:30", "2024112T123456Z",
+          "2020-W53-7T12:34:56Z", "2024W167T123456-0100", "+012024-04-21T12:34:56Z", "-000001-02-29T00:00:00Z" },
+        "0129:-.,TWZ+/ ");
+    records.insert(records.end(), mutations.begin(), mutations.end());
+    return records;
+}
+
+template <unsigned AcceptedFormats>
+void compareStaticWithCApi(const std::vector<std::string>& records) {
+    for (const auto& record : records) {
+        iso8601_datetime expected{};
+        iso8601_datetime actual{};
+        const bool valid = iso8601_parse_datetime_format(record.data(), record.size(), AcceptedFormats, &expected);
+        ASSERT_EQ(valid, ISO8601StaticValidator<AcceptedFormats>::parse(record, actual)) << record << " in formats " << AcceptedFormats;
+        ASSERT_EQ(valid, ISO8601StaticValidator<AcceptedFormats>::isValid(record)) << record;
+        EXPECT_EQ(valid, is_valid_iso8601_datetime_format(record.data(), record.size(), AcceptedFormats)) << record;
+        ASSERT_EQ(expected.error, actual.error) << record << " in formats " << AcceptedFormats;
+        ASSERT_EQ(expected.error_position, actual.error_position) << record;
+        if (valid) {
+            EXPECT_EQ(std::make_tuple(expected.year, expected.month, expected.day, expected.hour, expected.minute, expected.second),
+                std::make_tuple(actual.year, actual.month, actual.day, actual.hour, actual.minute, actual.second)) << record;
+            EXPECT_EQ(std::make_tuple(expected.fraction_digits, expected.fraction, expected.offset_minutes, expected.format),
+                std::make_tuple(actual.fraction_digits, actual.fraction, actual.offset_minutes, actual.format)) << record;
+        }
+    }
+}
+
+TEST(ISO8601StaticValidatorTest, MatchesCApiOnSharedCorpus) {
+    const std::vector<std::string> records = staticValidatorCorpus();
+    compareStaticWithCApi<ISO8601_ACCEPT_EXTENDED>(records);
+    compareStaticWithCApi<ISO8601_ACCEPT_BASIC>(records);
+    compareStaticWithCApi<ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_FRACTION>(records);
+    compareStaticWithCApi<ISO8601_ACCEPT_BASIC | ISO8601_ACCEPT_FRACTION | ISO8601_ACCEPT_REDUCED>(records);
+    compareStaticWithCApi<ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_ORDINAL | ISO8601_ACCEPT_WEEK>(records);
+    compareStaticWithCApi<ISO8601_ACCEPT_ALL_DATETIMES>(records);
+}
+
+TEST(ISO8601StaticValidatorTest, ChecksLiteralsAtCompileTime) {
+    static_assert(ISO8601StaticValidator<>::isValid("2024-02-29T12:34:56Z"));
+    static_assert(ISO8601StaticValidator<>::isValid("9999-12-31T23:59:59-23:59"));
+    static_assert(!ISO8601StaticValidator<>::isValid("2023-02-29T12:34:56Z"));
+    static_assert(!ISO8601StaticValidator<>::isValid("20240421T123456Z"));
+    static_assert(ISO8601StaticValidator<ISO8601_ACCEPT_BASIC | ISO8601_ACCEPT_FRACTION>::isValid("20240421T123456,5+0100"));
+    static_assert(!ISO8601StaticValidator<ISO8601_ACCEPT_BASIC>::isValid("20240421T123456,5+0100"));
+
+    constexpr iso8601_datetime week_date = ISO8601StaticValidator<ISO8601_ACCEPT_ALL_DATETIMES>::literal("2024-W16-7T12:34:56+01:00");
+    static_assert(week_date.year == 2024 && week_date.month == 4 && week_date.day == 21 && week_date.offset_minutes == 60);
+    static_assert(ISO8601DateTimeProcessor::isDateTimeValid("2024-04-21T12:34:56Z"));
+
+    iso8601_datetime parsed{};
+    EXPECT_FALSE(ISO8601StaticValidator<>::parse("2024-04-21T12:34:56.5Z", parsed));
+    EXPECT_EQ(ISO8601_ERROR_FORMAT, parsed.error);
+    EXPECT_EQ(19u, parsed.error_position);
+}
+
+TEST(ISO8601IntervalTest, ParsesDurations) {
+    iso8601_duration duration;
+    ASSERT_TRUE(iso8601_parse_duration("P3Y6M4DT12H30M5S", 16, &duration)) << iso8601_error_message(duration.error);
+    const uint32_t expected[ISO8601_DURATION_UNITS] = { 3, 6, 0, 4, 12, 30, 5 };
+    for (int unit = 0; unit < ISO8601_DURATION_UNITS; unit++) {
+        EXPECT_EQ(expected[unit], duration.values[unit]) << unit;
+    }
+    EXPECT_EQ(0x7B, duration.units);
+    EXPECT_EQ(ISO8601_DURATION_SECONDS, duration.fraction_unit);
+    EXPECT_EQ(0u, duration.fraction);
+
+    ASSERT_TRUE(iso8601_parse_duration("PT36,25H", 8, &duration));
+    EXPECT_EQ(36u, duration.values[ISO8601_DURATION_HOURS]);
+    EXPECT_EQ(ISO8601_DURATION_HOURS, duration.fraction_unit);
+    EXPECT_EQ(250000000u, duration.fraction);
+
+    ASSERT_TRUE(iso8601_parse_duration("P2W", 3, &duration));
+    EXPECT_EQ(2u, duration.values[ISO8601_DURATION_WEEKS]);
+    EXPECT_EQ(1 << ISO8601_DURATION_WEEKS, duration.units);
+
+    ASSERT_TRUE(iso8601_parse_duration("P123D", 5, &duration));
+    ASSERT_TRUE(iso8601_parse_duration("P1MT1M", 6, &duration));
+    EXPECT_EQ(1u, duration.values[ISO8601_DURATION_MONTHS]);
+    EXPECT_EQ(1u, duration.values[ISO8601_DURATION_MINUTES]);
+    ASSERT_TRUE(iso8601_parse_duration("PT0.000000001S", 14, &duration));
+    EXPECT_EQ(1u, duration.fraction);
+    ASSERT_TRUE(iso8601_parse_duration("P999999999Y", 11, &duration));
+    EXPECT_EQ(999999999u, duration.values[ISO8601_DURATION_YEARS]);
+}
+
+TEST(ISO8601IntervalTest, RejectsMalformedDurations) {
+    struct Case {
+        const char* duration;
+        iso8601_error error;
+        uint32_t position;
+    };
+    const Case cases[] = {
+        { "", ISO8601_ERROR_LENGTH, 0 },
+        { "P", ISO8601_ERROR_LENGTH, 1 },
+        { "PT", ISO8601_ERROR_LENGTH, 2 },
+        { "P1DT", ISO8601_ERROR_LENGTH, 4 },
+        { "1D", ISO8601_ERROR_DURATION, 0 },
+        { "P1", ISO8601_ERROR_LENGTH, 2 },
+        { "PD", ISO8601_ERROR_DIGIT, 1 },
+        { "P1D2Y", ISO8601_ERROR_DURATION, 4 },
+        { "P1D2D", ISO8601_ERROR_DURATION, 4 },
+        { "P1H", ISO8601_ERROR_DURATION, 2 },
+        { "PT1D", ISO8601_ERROR_DURATION, 3 },
+        { "P1W2D", ISO8601_ERROR_DURATION, 4 },
+        { "P1Y2W", ISO8601_ERROR_DURATION, 4 },
+        { "P1DTT1H", ISO8601_ERROR_DIGIT, 4 },
+        { "PT1,5H30M", ISO8601_ERROR_LENGTH, 6 },
+        { "PT1,H", ISO8601_ERROR_DIGIT, 4 },
+        { "PT1.0000000001S", ISO8601_ERROR_FRACTION, 13 },
+        { "P1000000000D", ISO8601_ERROR_DURATION, 10 },
+        { "P1D ", ISO8601_ERROR_DIGIT, 3 },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_duration duration;
+        EXPECT_FALSE(iso8601_parse_duration(test_case.duration, strlen(test_case.duration), &duration)) << test_case.duration;
+        EXPECT_EQ(test_case.error, duration.error) << test_case.duration << ": " << iso8601_error_message(duration.error);
+        EXPECT_EQ(test_case.position, duration.error_position) << test_case.duration;
+    }
+}
+
+TEST(ISO8601IntervalTest, ParsesIntervalsAndRecurringIntervals) {
+    iso8601_interval interval;
+    const char* start_end = "2024-04-21T12:00:00+02:00/2024-04-21T10:00:00Z";
+    ASSERT_TRUE(iso8601_parse_interval(start_end, strlen(start_end), ISO8601_ACCEPT_EXTENDED, &interval)) << iso8601_error_message(interval.error);
+    EXPECT_EQ(ISO8601_INTERVAL_START_END, interval.form);
+    EXPECT_EQ(12, interval.start.hour);
+    EXPECT_EQ(10, interval.end.hour);
+    EXPECT_EQ(0u, interval.recurrences);
+
+    const char* start_duration = "2024-112T12:00:00Z/PT1H30M";
+    ASSERT_TRUE(iso8601_parse_interval(start_duration, strlen(start_duration), ISO8601_ACCEPT_ALL_DATETIMES, &interval));
+    EXPECT_EQ(ISO8601_INTERVAL_START_DURATION, interval.form);
+    EXPECT_EQ(4, interval.start.month);
+    EXPECT_EQ(30u, interval.duration.values[ISO8601_DURATION_MINUTES]);
+
+    const char* duration_end = "P1W/2024-W16-7T12:00:00Z";
+    ASSERT_TRUE(iso8601_parse_interval(duration_end, strlen(duration_end), ISO8601_ACCEPT_ALL_DATETIMES, &interval));
+    EXPECT_EQ(ISO8601_INTERVAL_DURATION_END, interval.form);
+    EXPECT_EQ(1u, interval.duration.values[ISO8601_DURATION_WEEKS]);
+    EXPECT_EQ(21, interval.end.day);
+
+    ASSERT_TRUE(iso8601_parse_interval("P10D", 4, ISO8601_ACCEPT_EXTENDED, &interval));
+    EXPECT_EQ(ISO8601_INTERVAL_DURATION, interval.form);
+
+    const char* recurring = "R5/2024-01-01T00:00:00Z/P1DT2H";
+    ASSERT_TRUE(iso8601_parse_recurring_interval(recurring, strlen(recurring), ISO8601_ACCEPT_EXTENDED, &interval));
+    EXPECT_EQ(5u, interval.recurrences);
+    EXPECT_EQ(ISO8601_INTERVAL_START_DURATION, interval.form);
+    EXPECT_EQ(2024, interval.start.year);
+    EXPECT_EQ(2u, interval.duration.values[ISO8601_DURATION_HOURS]);
+
+    ASSERT_TRUE(iso8601_parse_recurring_interval("R/P1W", 5, ISO8601_ACCEPT_EXTENDED, &interval));
+    EXPECT_EQ(ISO8601_UNBOUNDED_RECURRENCES, interval.recurrences);
+
+    EXPECT_TRUE(is_valid_iso8601_datetime_interval("20240421T1200Z/20240421T1200,5Z"));
+    EXPECT_TRUE(is_valid_iso8601_datetime_interval("2024-01-01T00:00:00+01:00/2023-12-31T23:00:00.5Z"));
+    EXPECT_TRUE(is_valid_iso8601_datetime_interval("PT36,5H"));
+    EXPECT_TRUE(is_valid_iso8601_recurring_time_interval("R12/P1Y/2024-W01-1T00:00:00Z"));
+    EXPECT_FALSE(is_valid_iso8601_datetime_interval("R12/P1Y/2024-W01-1T00:00:00Z"));
+    EXPECT_FALSE(is_valid_iso8601_recurring_time_interval("P1Y/2024-W01-1T00:00:00Z"));
+}
+
+TEST(ISO8601IntervalTest, RecurringIntervalsBetweenDates) {
+    iso8601_interval interval;
+    const char* weeks = "R5/2024-W01/2024-W10";
+    ASSERT_TRUE(iso8601_parse_recurring_interval(weeks, strlen(weeks), ISO8601_ACCEPT_ALL_DATETIMES | ISO8601_ACCEPT_DATE, &interval))
+        << iso8601_error_message(interval.error);
+    EXPECT_EQ(ISO8601_INTERVAL_START_END, interval.form);
+    EXPECT_EQ(5u, interval.recurrences);
+    EXPECT_EQ(1, interval.start.month);
+    EXPECT_EQ(1, interval.start.day);
+    EXPECT_EQ(3, interval.end.month);
+    EXPECT_EQ(4, interval.end.day);
+    EXPECT_EQ(0, interval.end.hour);
+    EXPECT_NE(0u, interval.end.format & ISO8601_FORMAT_DATE);
+
+    const char* days = "R3/2024-032/P10D";
+    ASSERT_TRUE(iso8601_parse_recurring_interval(days, strlen(days), ISO8601_ACCEPT_ALL_DATETIMES | ISO8601_ACCEPT_DATE, &interval));
+    EXPECT_EQ(ISO8601_INTERVAL_START_DURATION, interval.form);
+    EXPECT_EQ(2, interval.start.month);
+    EXPECT_EQ(1, interval.start.day);
+    EXPECT_EQ(10u, interval.duration.values[ISO8601_DURATION_DAYS]);
+
+    // Week 1 of 2025 starts on Monday the 30th of December 2024.
+    const char* year_before = "R/2025W01/P1W";
+    ASSERT_TRUE(iso8601_parse_recurring_interval(year_before, strlen(year_before), ISO8601_ACCEPT_ALL_DATETIMES | ISO8601_ACCEPT_DATE, &interval));
+    EXPECT_EQ(2024, interval.start.year);
+    EXPECT_EQ(12, interval.start.month);
+    EXPECT_EQ(30, interval.start.day);
+
+    EXPECT_TRUE(is_valid_iso8601_recurring_time_interval("R5/2024W01/2024W10"));
+    EXPECT_TRUE(is_valid_iso8601_recurring_time_interval("R3/2024032/P10D"));
+    EXPECT_TRUE(is_valid_iso8601_recurring_time_interval("R2/2024-04-21/2024-04-21T12:00:00Z"));
+    EXPECT_TRUE(is_valid_iso8601_recurring_time_interval("R2/P1W/2024-W16-7"));
+    EXPECT_FALSE(is_valid_iso8601_recurring_time_interval("R5/2021-W53/2022-W01"));
+    EXPECT_FALSE(is_valid_iso8601_recurring_time_interval("R5/2024-W10/2024-W01"));
+    EXPECT_FALSE(is_valid_iso8601_recurring_time_interval("R3/2023-366/P10D"));
+
+    // A date alone is still not a date-time.
+    EXPECT_FALSE(is_valid_iso8601_datetime_format("2024-032", 8, ISO8601_ACCEPT_ALL_DATETIMES));
+    EXPECT_FALSE(iso8601_parse_recurring_interval(days, strlen(days), ISO8601_ACCEPT_ALL_DATETIMES, &interval));
+    EXPECT_EQ(ISO8601_ERROR_LENGTH, interval.error);
+    EXPECT_EQ(11u, interval.error_position);
+}
+
+TEST(ISO8601IntervalTest, RejectsMalformedIntervals) {
+    struct Case {
+        const char* interval;
+        iso8601_error error;
+        uint32_t position;
+    };
+    const Case cases[] = {
+        { "R5/2024-01-01T00:00:00Z", ISO8601_ERROR_INTERVAL, 23 },
+        { "R5/P1D/P2D", ISO8601_ERROR_INTERVAL, 7 },
+        { "R5/2024-01-01T00:00:00Z/2023-12-31T23:59:59Z", ISO8601_ERROR_ORDER, 24 },
+        { "R5/2024-01-01T00:00:00-01:00/2024-01-01T00:30:00Z", ISO8601_ERROR_ORDER, 29 },
+        { "R5/2024-01-01T00:00:00.5Z/2024-01-01T00:00:00.25Z", ISO8601_ERROR_ORDER, 26 },
+        { "R5/2024-13-01T00:00:00Z/P1D", ISO8601_ERROR_MONTH, 8 },
+        { "R5/2024-01-01T00:00:00Z/P1H", ISO8601_ERROR_DURATION, 26 },
+        { "R5/P1D/2024-01-01T00:00:00Z/P1D", ISO8601_ERROR_LENGTH, 27 },
+        { "R5/2024-01-01T00:00:00Z/", ISO8601_ERROR_LENGTH, 24 },
+        { "5/P1D", ISO8601_ERROR_RECURRENCE, 0 },
+        { "R5P1D", ISO8601_ERROR_RECURRENCE, 2 },
+        { "R1234567890/P1D", ISO8601_ERROR_RECURRENCE, 10 },
+    };
+    for (const Case& test_case : cases) {
+        iso8601_interval interval;
+        EXPECT_FALSE(iso8601_parse_recurring_interval(test_case.interval, strlen(test_case.interval), ISO8601_ACCEPT_ALL_DATETIMES, &interval)) << test_case.interval;
+        EXPECT_EQ(test_case.error, interval.error) << test_case.interval << ": " << iso8601_error_message(interval.error);
+        EXPECT_EQ(test_case.position, interval.error_position) << test_case.interval;
+    }
+}
 
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
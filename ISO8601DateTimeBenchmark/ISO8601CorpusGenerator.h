@@ -0,0 +1,297 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ISO8601DateTimeValidator/ISO8601BufferedWriter.h"
+
+// Deterministic generator of date-time corpora for benchmarks.
+// Every random decision comes from a splitmix64 stream seeded with CorpusOptions::seed,
+// and no <random> distribution is involved, so the same options produce byte-identical
+// files on every platform and standard library.
+class ISO8601CorpusGenerator
+{
+public:
+    struct CorpusOptions
+    {
+        uint64_t rows = 1000000;
+        uint64_t seed = 8601;
+        double invalid_ratio = 0.1;   // Records that are not a valid date-time.
+        double duplicate_ratio = 0.2; // Valid records that repeat an earlier value.
+        double offset_ratio = 0.5;    // Valid records with an hh:mm offset instead of Z.
+        double noise_ratio = 0.0;     // Records embedded in a line of log text.
+    };
+
+    // Shapes of single records, used to benchmark the validator shape by shape.
+    enum class RecordShape
+    {
+        Utc,          // YYYY-MM-DDThh:mm:ssZ
+        Offset,       // YYYY-MM-DDThh:mm:ss+hh:mm
+        OutOfRange,   // Right length and separators, a field out of range.
+        Malformed,    // Wrong length, separator or character.
+        LogLine,      // A valid date-time inside a line of log text.
+        Calendar,     // YYYY-MM-DDThh:mm:ss with Z or an hh:mm offset.
+        Basic,        // YYYYMMDDThhmmss with Z or an hhmm offset.
+        Ordinal,      // YYYY-DDDThh:mm:ss with Z or an hh:mm offset.
+        Week,         // YYYY-Www-DThh:mm:ss with Z or an hh:mm offset.
+        Expanded,     // +YYYYYY-MM-DDThh:mm:ss or -YYYYYY-..., with Z or an hh:mm offset.
+        Recurring     // Rn/start/PnDTnH or Rn/PTnM/end with calendar date-times.
+    };
+
+    explicit ISO8601CorpusGenerator(const CorpusOptions& options)
+        : options_(options), state_(options.seed)
+    {
+        recent_.reserve(RECENT_VALUES);
+    }
+
+    // Next record of the corpus, without line terminator.
+    std::string nextRecord()
+    {
+        std::string record;
+        if (chance(options_.invalid_ratio)) {
+            record = chance(0.5) ? shapeRecord(RecordShape::OutOfRange) : shapeRecord(RecordShape::Malformed);
+        }
+        else if (!recent_.empty() && chance(options_.duplicate_ratio)) {
+            record = recent_[next() % recent_.size()];
+        }
+        else {
+            record = validDateTime(chance(options_.offset_ratio));
+            remember(record);
+        }
+
+        if (chance(options_.noise_ratio)) {
+            record = logLine(record);
+        }
+        return record;
+    }
+
+    std::string shapeRecord(RecordShape shape)
+    {
+        switch (shape)
+        {
+        case RecordShape::Utc:
+            return validDateTime(false);
+        case RecordShape::Offset:
+            return validDateTime(true);
+        case RecordShape::OutOfRange:
+            return outOfRange(validDateTime(chance(0.5)));
+        case RecordShape::Malformed:
+            return malformed(validDateTime(chance(0.5)));
+        case RecordShape::Calendar:
+            return validDateTime(chance(0.5));
+        case RecordShape::Basic:
+            return basic(validDateTime(chance(0.5)));
+        case RecordShape::Ordinal:
+            return ordinalDateTime(chance(0.5));
+        case RecordShape::Week:
+            return weekDateTime(chance(0.5));
+        case RecordShape::Expanded:
+            return (chance(0.5) ? "+00" : "-00") + validDateTime(chance(0.5));
+        case RecordShape::Recurring:
+            return recurringInterval();
+        default:
+            return logLine(validDateTime(chance(0.5)));
+        }
+    }
+
+    // Writes options.rows records, one per line. Returns false if the file cannot be written.
+    static bool writeCorpus(const std::string& file_name, const CorpusOptions& options)
+    {
+        ISO8601BufferedWriter writer;
+        if (!writer.open(file_name)) {
+            return false;
+        }
+        ISO8601CorpusGenerator generator(options);
+        for (uint64_t row = 0; row < options.rows; row++) {
+            writer.write(generator.nextRecord());
+            writer.write("\n");
+        }
+        return writer.close();
+    }
+
+private:
+    // Number of recent unique values that duplicates are drawn from.
+    static constexpr size_t RECENT_VALUES = 1 << 16;
+
+    uint64_t next()
+    {
+        // splitmix64
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    int between(int low, int high)
+    {
+        return low + static_cast<int>(next() % static_cast<uint64_t>(high - low + 1));
+    }
+
+    bool chance(double ratio)
+    {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < ratio;
+    }
+
+    void remember(const std::string& record)
+    {
+        if (recent_.size() < RECENT_VALUES) {
+            recent_.push_back(record);
+        }
+        else {
+            recent_[next() % RECENT_VALUES] = record;
+        }
+    }
+
+    static void appendDigits(std::string& text, int value, int count)
+    {
+        char digits[8];
+        for (int i = count - 1; i >= 0; i--) {
+            digits[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        text.append(digits, count);
+    }
+
+    static bool isLeapYear(int year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    std::string validDateTime(bool with_offset)
+    {
+        static const int days_in_month[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        int year = between(1970, 2099);
+        int month = between(1, 12);
+        int day = between(1, days_in_month[month] + (month == 2 && isLeapYear(year)));
+
+        std::string text;
+        text.reserve(32);
+        appendDigits(text, year, 4);
+        text += '-';
+        appendDigits(text, month, 2);
+        text += '-';
+        appendDigits(text, day, 2);
+        appendTime(text, with_offset);
+        return text;
+    }
+
+    std::string ordinalDateTime(bool with_offset)
+    {
+        int year = between(1970, 2099);
+        std::string text;
+        appendDigits(text, year, 4);
+        text += '-';
+        appendDigits(text, between(1, 365 + isLeapYear(year)), 3);
+        appendTime(text, with_offset);
+        return text;
+    }
+
+    // Every year has at least 52 weeks, so week 53 is left out.
+    std::string weekDateTime(bool with_offset)
+    {
+        std::string text;
+        appendDigits(text, between(1970, 2099), 4);
+        text += "-W";
+        appendDigits(text, between(1, 52), 2);
+        text += '-';
+        appendDigits(text, between(1, 7), 1);
+        appendTime(text, with_offset);
+        return text;
+    }
+
+    std::string recurringInterval()
+    {
+        std::string text = "R";
+        text += std::to_string(between(1, 99));
+        text += '/';
+        if (chance(0.5)) {
+            text += validDateTime(chance(0.5));
+            text += "/P" + std::to_string(between(1, 30)) + "DT" + std::to_string(between(0, 23)) + "H";
+        }
+        else {
+            text += "PT" + std::to_string(between(1, 999)) + "M/";
+            text += validDateTime(chance(0.5));
+        }
+        return text;
+    }
+
+    // Drops the separators of an extended calendar date-time.
+    static std::string basic(const std::string& text)
+    {
+        std::string basic_text;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != ':' && !(text[i] == '-' && i < 10)) {
+                basic_text += text[i];
+            }
+        }
+        return basic_text;
+    }
+
+    void appendTime(std::string& text, bool with_offset)
+    {
+        text += 'T';
+        appendDigits(text, between(0, 23), 2);
+        text += ':';
+        appendDigits(text, between(0, 59), 2);
+        text += ':';
+        appendDigits(text, between(0, 59), 2);
+        if (!with_offset) {
+            text += 'Z';
+            return;
+        }
+
+        // Offsets in use today: -12:00 to +14:00 in quarter hours.
+        static const int offset_minutes[4] = { 0, 30, 45, 15 };
+        int hours = between(-12, 14);
+        text += hours < 0 ? '-' : '+';
+        appendDigits(text, hours < 0 ? -hours : hours, 2);
+        text += ':';
+        appendDigits(text, offset_minutes[next() % (hours == 14 || hours == -12 ? 1 : 4)], 2);
+    }
+
+    std::string outOfRange(std::string text)
+    {
+        // Positions of the month, day, hour, minute and second fields.
+        static const size_t fields[5] = { 5, 8, 11, 14, 17 };
+        static const char* const values[5] = { "13", "32", "24", "60", "61" };
+        int field = between(0, 4);
+        text.replace(fields[field], 2, values[field]);
+        return text;
+    }
+
+    std::string malformed(std::string text)
+    {
+        switch (between(0, 3))
+        {
+        case 0:
+            text.pop_back(); // Truncated.
+            break;
+        case 1:
+            text[10] = ' '; // Wrong date and time separator.
+            break;
+        case 2:
+            text[static_cast<size_t>(between(0, 18))] = 'x';
+            break;
+        default:
+            text += '0'; // Too long.
+            break;
+        }
+        return text;
+    }
+
+    std::string logLine(const std::string& record)
+    {
+        std::string line = "INFO [worker-";
+        appendDigits(line, between(0, 63), 2);
+        line += "] request ";
+        appendDigits(line, between(0, 999999), 6);
+        line += " handled at ";
+        line += record;
+        line += " status=200 elapsed_ms=";
+        appendDigits(line, between(0, 999), 3);
+        return line;
+    }
+
+    CorpusOptions options_;
+    uint64_t state_;
+    std::vector<std::string> recent_;
+};
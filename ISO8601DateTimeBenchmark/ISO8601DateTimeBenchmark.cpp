@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../ISO8601DateTimeValidator/ISO8601DateTimeProcessor.h"
+#include "ISO8601CorpusGenerator.h"
+
+// Benchmarks of the validator and of the processor.
+//
+// Microbenchmarks time each validation entry point on records of one shape at a time.
+// End-to-end benchmarks run processDateTime on a generated (or given) corpus in every
+// processing mode and report MB/s and rows/s of input. Each measurement is repeated
+// and the best run is reported.
+
+namespace
+{
+    struct BenchmarkOptions
+    {
+        ISO8601CorpusGenerator::CorpusOptions corpus;
+        std::string input_file;    // Existing corpus to run on; generated when empty.
+        std::string generate_file; // Only write the corpus to this file.
+        int iterations = 3;
+        size_t micro_records = 1 << 16;
+        bool micro = true;
+        bool end_to_end = true;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedSeconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Keeps the compiler from dropping the benchmarked calls.
+    volatile size_t benchmark_sink = 0;
+
+    template <typename Run>
+    double bestSeconds(int iterations, Run&& run)
+    {
+        double best = 0;
+        for (int i = 0; i < iterations; i++) {
+            auto start = Clock::now();
+            run();
+            double seconds = elapsedSeconds(start);
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    }
+
+    void printMicroResult(const std::string& shape, const std::string& entry_point, double seconds, size_t records)
+    {
+        std::cout << std::left << std::setw(14) << shape << std::setw(32) << entry_point << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << seconds * 1e9 / records << " ns/record"
+            << std::setw(10) << records / seconds / 1e6 << " Mrecords/s" << std::endl;
+    }
+
+    void runMicroBenchmarks(const BenchmarkOptions& options)
+    {
+        const std::pair<ISO8601CorpusGenerator::RecordShape, const char*> shapes[] = {
+            { ISO8601CorpusGenerator::RecordShape::Utc, "utc" },
+            { ISO8601CorpusGenerator::RecordShape::Offset, "offset" },
+            { ISO8601CorpusGenerator::RecordShape::OutOfRange, "out-of-range" },
+            { ISO8601CorpusGenerator::RecordShape::Malformed, "malformed" },
+        };
+        // Enough passes over the records for each measurement to take a few milliseconds.
+        const int passes = 32;
+
+        std::cout << "Validation per record shape (" << options.micro_records << " records)" << std::endl;
+        ISO8601CorpusGenerator generator(options.corpus);
+        for (const auto& [shape, shape_name] : shapes) {
+            std::vector<std::string> records;
+            for (size_t i = 0; i < options.micro_records; i++) {
+                records.push_back(generator.shapeRecord(shape));
+            }
+            std::vector<const char*> pointers;
+            std::vector<size_t> lengths;
+            for (const auto& record : records) {
+                pointers.push_back(record.c_str());
+                lengths.push_back(record.size());
+            }
+            const size_t total = records.size() * passes;
+
+            double seconds = bestSeconds(options.iterations, [&]() {
+                size_t valid = 0;
+                for (int pass = 0; pass < passes; pass++) {
+                    for (const char* record : pointers) {
+                        valid += is_valid_iso8601_datetime(record);
+                    }
+                }
+                benchmark_sink = valid;
+            });
+            printMicroResult(shape_name, "is_valid_iso8601_datetime", seconds, total);
+
+            seconds = bestSeconds(options.iterations, [&]() {
+                size_t valid = 0;
+                for (int pass = 0; pass < passes; pass++) {
+                    for (size_t i = 0; i < pointers.size(); i++) {
+                        valid += is_valid_iso8601_datetime_n(pointers[i], lengths[i]);
+                    }
+                }
+                benchmark_sink = valid;
+            });
+            printMicroResult(shape_name, "is_valid_iso8601_datetime_n", seconds, total);
+
+            // The same check inlined from the header.
+            seconds = bestSeconds(options.iterations, [&]() {
+                size_t valid = 0;
+                for (int pass = 0; pass < passes; pass++) {
+                    for (size_t i = 0; i < pointers.size(); i++) {
+                        valid += ISO8601StaticValidator<>::isValid(std::string_view(pointers[i], lengths[i]));
+                    }
+                }
+                benchmark_sink = valid;
+            });
+            printMicroResult(shape_name, "ISO8601StaticValidator", seconds, total);
+
+            std::unique_ptr<bool[]> results(new bool[records.size()]);
+            for (int level = ISO8601_SIMD_SCALAR; level <= ISO8601_SIMD_AVX2; level++) {
+                if (iso8601_simd_select_level(static_cast<iso8601_simd_level>(level)) != level) {
+                    continue; // Not supported by this CPU.
+                }
+                seconds = bestSeconds(options.iterations, [&]() {
+                    size_t valid = 0;
+                    for (int pass = 0; pass < passes; pass++) {
+                        valid += is_valid_iso8601_datetime_batch(pointers.data(), lengths.data(), records.size(), results.get());
+                    }
+                    benchmark_sink = valid;
+                });
+                static const char* const level_names[] = { "batch (scalar)", "batch (SSE4.2)", "batch (AVX2)" };
+                printMicroResult(shape_name, level_names[level], seconds, total);
+            }
+            iso8601_simd_select_level(ISO8601_SIMD_AVX2);
+
+            // The same records as an Arrow string column, with and without the epoch column.
+            std::string column_data;
+            std::vector<int32_t> offsets{ 0 };
+            for (const auto& record : records) {
+                column_data += record;
+                offsets.push_back(static_cast<int32_t>(column_data.size()));
+            }
+            const iso8601_string_column column{ column_data.data(), offsets.data(), nullptr, nullptr, records.size() };
+            std::vector<uint8_t> validity((records.size() + 7) / 8);
+            std::vector<int64_t> microseconds(records.size());
+            for (bool epoch : { false, true }) {
+                seconds = bestSeconds(options.iterations, [&]() {
+                    size_t valid = 0;
+                    for (int pass = 0; pass < passes; pass++) {
+                        valid += iso8601_validate_string_column(&column, 0, records.size(), ISO8601_ACCEPT_EXTENDED,
+                            validity.data(), epoch ? microseconds.data() : nullptr);
+                    }
+                    benchmark_sink = valid;
+                });
+                printMicroResult(shape_name, epoch ? "string column, epoch us" : "string column", seconds, total);
+            }
+        }
+
+        // Date notations with every format accepted, half of them with an offset. The
+        // extended notations take fixed width fast paths, the basic format the general
+        // parser; ordinal and week dates are converted to calendar dates by closed form
+        // arithmetic.
+        const std::pair<ISO8601CorpusGenerator::RecordShape, const char*> notations[] = {
+            { ISO8601CorpusGenerator::RecordShape::Calendar, "calendar" },
+            { ISO8601CorpusGenerator::RecordShape::Basic, "basic" },
+            { ISO8601CorpusGenerator::RecordShape::Ordinal, "ordinal" },
+            { ISO8601CorpusGenerator::RecordShape::Week, "week" },
+            { ISO8601CorpusGenerator::RecordShape::Expanded, "expanded" },
+        };
+        std::ostringstream relative;
+        double calendar_seconds = 0;
+        for (const auto& [shape, shape_name] : notations) {
+            std::vector<std::string> records;
+            for (size_t i = 0; i < options.micro_records; i++) {
+                records.push_back(generator.shapeRecord(shape));
+            }
+            double seconds = bestSeconds(options.iterations, [&]() {
+                size_t valid = 0;
+                for (int pass = 0; pass < passes; pass++) {
+                    for (const auto& record : records) {
+                        valid += is_valid_iso8601_datetime_format(record.data(), record.size(), ISO8601_ACCEPT_ALL_DATETIMES);
+                    }
+                }
+                benchmark_sink = valid;
+            });
+            printMicroResult(shape_name, "is_valid_iso8601_datetime_format", seconds, records.size() * passes);
+            const double format_seconds = seconds;
+            seconds = bestSeconds(options.iterations, [&]() {
+                size_t valid = 0;
+                for (int pass = 0; pass < passes; pass++) {
+                    for (const auto& record : records) {
+                        valid += ISO8601StaticValidator<ISO8601_ACCEPT_ALL_DATETIMES>::isValid(record);
+                    }
+                }
+                benchmark_sink = valid;
+            });
+            printMicroResult(shape_name, "ISO8601StaticValidator<ALL>", seconds, records.size() * passes);
+            seconds = format_seconds;
+            if (calendar_seconds == 0) {
+                calendar_seconds = seconds;
+            }
+            else {
+                relative << " " << shape_name << " " << std::setprecision(2) << seconds / calendar_seconds << "x";
+            }
+        }
+        std::cout << "Relative to the calendar date:" << relative.str() << std::endl;
+
+        // Recurring intervals: the recurrences, then each part by the duration or the
+        // date-time parser, without copying any part.
+        std::vector<std::string> intervals;
+        for (size_t i = 0; i < options.micro_records; i++) {
+            intervals.push_back(generator.shapeRecord(ISO8601CorpusGenerator::RecordShape::Recurring));
+        }
+        double interval_seconds = bestSeconds(options.iterations, [&]() {
+            size_t valid = 0;
+            iso8601_interval interval;
+            for (int pass = 0; pass < passes; pass++) {
+                for (const auto& record : intervals) {
+                    valid += iso8601_parse_recurring_interval(record.data(), record.size(), ISO8601_ACCEPT_ALL_DATETIMES, &interval);
+                }
+            }
+            benchmark_sink = valid;
+        });
+        printMicroResult("recurring", "iso8601_parse_recurring_interval", interval_seconds, intervals.size() * passes);
+
+        // Extraction from log lines is measured on one buffer of newline separated lines.
+        std::string text;
+        for (size_t i = 0; i < options.micro_records; i++) {
+            text += generator.shapeRecord(ISO8601CorpusGenerator::RecordShape::LogLine);
+            text += '\n';
+        }
+        double seconds = bestSeconds(options.iterations, [&]() {
+            size_t found = 0;
+            for (int pass = 0; pass < passes; pass++) {
+                found += ISO8601DateTimeProcessor::findDateTimes(text).size();
+            }
+            benchmark_sink = found;
+        });
+        printMicroResult("log-line", "findDateTimes", seconds, options.micro_records * passes);
+        std::cout << std::endl;
+    }
+
+    struct EndToEndMode
+    {
+        const char* name;
+        ISO8601DateTimeProcessor::ProcessingOptions options;
+    };
+
+    std::vector<EndToEndMode> endToEndModes()
+    {
+        using Processor = ISO8601DateTimeProcessor;
+        std::vector<EndToEndMode> modes;
+        auto add = [&](const char* name, auto configure) {
+            Processor::ProcessingOptions options;
+            configure(options);
+            modes.push_back({ name, options });
+        };
+
+        add("streamed", [](Processor::ProcessingOptions& o) { o.input_mode = Processor::InputMode::Streamed; });
+        add("async read", [](Processor::ProcessingOptions& o) { o.input_mode = Processor::InputMode::AsyncRead; });
+        add("mapped", [](Processor::ProcessingOptions& o) { o.input_mode = Processor::InputMode::MemoryMapped; });
+        add("mapped, metrics", [](Processor::ProcessingOptions& o) {
+            static ISO8601Metrics metrics;
+            o.input_mode = Processor::InputMode::MemoryMapped;
+            o.metrics = &metrics;
+        });
+        add("streamed, all threads", [](Processor::ProcessingOptions& o) {
+            o.input_mode = Processor::InputMode::Streamed;
+            o.threads = 0;
+        });
+        add("async read, all threads", [](Processor::ProcessingOptions& o) {
+            o.input_mode = Processor::InputMode::AsyncRead;
+            o.threads = 0;
+        });
+        add("mapped, all threads", [](Processor::ProcessingOptions& o) { o.threads = 0; });
+        add("instant dedup", [](Processor::ProcessingOptions& o) { o.dedup_mode = Processor::DedupMode::Instant; });
+        add("approximate dedup", [](Processor::ProcessingOptions& o) {
+            o.approximate_dedup = true;
+            o.output_order = Processor::OutputOrder::FirstOccurrence;
+        });
+        add("canonical UTC output", [](Processor::ProcessingOptions& o) { o.output_format = Processor::OutputFormat::CanonicalUtc; });
+        add("sorted output", [](Processor::ProcessingOptions& o) { o.output_order = Processor::OutputOrder::Sorted; });
+        add("first occurrence output", [](Processor::ProcessingOptions& o) { o.output_order = Processor::OutputOrder::FirstOccurrence; });
+        add("free text", [](Processor::ProcessingOptions& o) { o.record_layout = Processor::RecordLayout::FreeText; });
+        add("free text, all threads", [](Processor::ProcessingOptions& o) {
+            o.record_layout = Processor::RecordLayout::FreeText;
+            o.threads = 0;
+        });
+        return modes;
+    }
+
+    bool runEndToEndBenchmarks(const BenchmarkOptions& options, const std::string& input_file)
+    {
+        std::error_code error;
+        const uintmax_t input_size = std::filesystem::file_size(input_file, error);
+        if (error) {
+            std::cerr << "Error: Unable to read input file " << input_file << std::endl;
+            return false;
+        }
+        size_t rows = 0;
+        {
+            ISO8601MappedFile mapped_file;
+            if (mapped_file.open(input_file)) {
+                rows = static_cast<size_t>(std::count(mapped_file.data(), mapped_file.data() + mapped_file.size(), '\n'));
+            }
+        }
+
+        const std::string output_file = (std::filesystem::temp_directory_path() / "iso8601_benchmark_output.txt").string();
+        std::cout << "End to end: " << input_file << " (" << input_size / 1e6 << " MB, " << rows << " rows)" << std::endl;
+
+        for (const auto& mode : endToEndModes()) {
+            bool ok = true;
+            // processDateTime reports every run on stdout.
+            std::ostringstream discarded;
+            std::streambuf* cout_buffer = std::cout.rdbuf(discarded.rdbuf());
+            double seconds = bestSeconds(options.iterations, [&]() {
+                ok = ISO8601DateTimeProcessor::processDateTime(input_file, output_file, mode.options) && ok;
+            });
+            std::cout.rdbuf(cout_buffer);
+            if (!ok) {
+                std::cerr << "Error: " << mode.name << " run failed." << std::endl;
+                return false;
+            }
+
+            std::cout << std::left << std::setw(26) << mode.name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << seconds * 1e3 << " ms" << std::setw(10) << input_size / seconds / 1e6 << " MB/s"
+                << std::setw(10) << rows / seconds / 1e6 << " Mrows/s" << std::endl;
+        }
+        std::filesystem::remove(output_file, error);
+        return true;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: ISO8601DateTimeBenchmark [options]\n"
+            "  --rows N            rows of the generated corpus (default 1000000)\n"
+            "  --seed N            seed of the generated corpus (default 8601)\n"
+            "  --invalid R         ratio of invalid records (default 0.1)\n"
+            "  --duplicates R      ratio of valid records repeating an earlier value (default 0.2)\n"
+            "  --offsets R         ratio of valid records with an hh:mm offset (default 0.5)\n"
+            "  --noise R           ratio of records embedded in log text (default 0)\n"
+            "  --generate FILE     only write the corpus to FILE\n"
+            "  --input FILE        run the end to end benchmarks on FILE instead of a generated corpus\n"
+            "  --iterations N      runs per measurement; the best one is reported (default 3)\n"
+            "  --micro-only        only run the validation microbenchmarks\n"
+            "  --end-to-end-only   only run the end to end benchmarks\n";
+    }
+
+    bool parseArguments(int argc, char** argv, BenchmarkOptions& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            bool has_value = i + 1 < argc;
+            auto value = [&]() { return std::string(argv[++i]); };
+
+            if (argument == "--micro-only") {
+                options.end_to_end = false;
+            }
+            else if (argument == "--end-to-end-only") {
+                options.micro = false;
+            }
+            else if (!has_value) {
+                return false;
+            }
+            else if (argument == "--rows") {
+                options.corpus.rows = std::strtoull(value().c_str(), nullptr, 10);
+            }
+            else if (argument == "--seed") {
+                options.corpus.seed = std::strtoull(value().c_str(), nullptr, 10);
+            }
+            else if (argument == "--invalid") {
+                options.corpus.invalid_ratio = std::strtod(value().c_str(), nullptr);
+            }
+            else if (argument == "--duplicates") {
+                options.corpus.duplicate_ratio = std::strtod(value().c_str(), nullptr);
+            }
+            else if (argument == "--offsets") {
+                options.corpus.offset_ratio = std::strtod(value().c_str(), nullptr);
+            }
+            else if (argument == "--noise") {
+                options.corpus.noise_ratio = std::strtod(value().c_str(), nullptr);
+            }
+            else if (argument == "--generate") {
+                options.generate_file = value();
+            }
+            else if (argument == "--input") {
+                options.input_file = value();
+            }
+            else if (argument == "--iterations") {
+                options.iterations = std::max(1, std::atoi(value().c_str()));
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    if (!options.generate_file.empty()) {
+        if (!ISO8601CorpusGenerator::writeCorpus(options.generate_file, options.corpus)) {
+            std::cerr << "Error: Unable to write " << options.generate_file << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (options.micro) {
+        runMicroBenchmarks(options);
+    }
+
+    if (options.end_to_end) {
+        std::string input_file = options.input_file;
+        bool generated = input_file.empty();
+        if (generated) {
+            input_file = (std::filesystem::temp_directory_path() / "iso8601_benchmark_corpus.txt").string();
+            if (!ISO8601CorpusGenerator::writeCorpus(input_file, options.corpus)) {
+                std::cerr << "Error: Unable to write " << input_file << std::endl;
+                return 1;
+            }
+        }
+
+        bool ok = runEndToEndBenchmarks(options, input_file);
+        if (generated) {
+            std::error_code error;
+            std::filesystem::remove(input_file, error);
+        }
+        if (!ok) {
+            return 1;
+        }
+    }
+    return 0;
+}
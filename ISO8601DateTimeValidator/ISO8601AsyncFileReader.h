@@ -0,0 +1,455 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ISO8601_HAS_IO_URING 1
+// Older C libraries do not name the io_uring system calls; their numbers are the same on
+// every architecture but alpha.
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+#endif
+#endif
+
+// Reads a regular file from start to end in blocks and serves them in file order as a
+// std::streambuf, so it can stand in for the std::filebuf of a std::ifstream.
+// On Linux up to depth blocks are read ahead through an io_uring into registered
+// buffers: the kernel fills the next blocks while the current one is validated, so a
+// cold page cache or a slow disk costs waiting time only when validation is faster than
+// the disk. Where no ring can be set up (kernels before 5.1, io_uring disabled or blocked
+// by seccomp, other systems), every block is read with pread when it is needed.
+// A failed read throws from underflow(), which std::istream reports as badbit.
+class ISO8601AsyncFileReader : public std::streambuf
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+    static constexpr unsigned DEFAULT_DEPTH = 4;
+
+    enum class Backend
+    {
+        None,    // No file is open.
+        IoUring, // Blocks are read ahead through an io_uring.
+        Pread    // Blocks are read one at a time when they are needed.
+    };
+
+    explicit ISO8601AsyncFileReader(size_t block_size = DEFAULT_BLOCK_SIZE, unsigned depth = DEFAULT_DEPTH)
+        : block_size_(block_size > 0 ? block_size : 1), slots_(depth > 0 ? depth : 1),
+        buffers_(block_size_ * slots_.size())
+    {
+        for (size_t index = 0; index < slots_.size(); index++) {
+            slots_[index].data = buffers_.data() + index * block_size_;
+        }
+    }
+
+    ISO8601AsyncFileReader(const ISO8601AsyncFileReader&) = delete;
+    ISO8601AsyncFileReader& operator=(const ISO8601AsyncFileReader&) = delete;
+
+    ~ISO8601AsyncFileReader()
+    {
+        close();
+    }
+
+    // Opens a regular file and, on the io_uring backend, starts reading its first blocks.
+    // With use_io_uring false the pread backend is used even where io_uring is available.
+    bool open(const std::string& file_name, bool use_io_uring = true)
+    {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        if (GetFileType(file_) != FILE_TYPE_DISK) {
+            close();
+            return false;
+        }
+        (void)use_io_uring;
+#else
+        fd_ = ::open(file_name.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat file_status;
+        if (fstat(fd_, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+            close();
+            return false;
+        }
+#ifdef ISO8601_HAS_IO_URING
+        if (use_io_uring && setupRing()) {
+            backend_ = Backend::IoUring;
+            for (size_t index = 0; index < slots_.size(); index++) {
+                queueBlock(index);
+            }
+            submit();
+            return true;
+        }
+#else
+        (void)use_io_uring;
+#endif
+#endif
+        backend_ = Backend::Pread;
+        return true;
+    }
+
+    // Waits for the reads still in flight and closes the file.
+    void close()
+    {
+#ifdef ISO8601_HAS_IO_URING
+        if (ring_fd_ >= 0) {
+            // The kernel may still write into the buffers until a read completes.
+            while (in_flight_ > 0) {
+                if (!reapCompletion(false) && !enter(pending_, 1, IORING_ENTER_GETEVENTS)) {
+                    break;
+                }
+            }
+            teardownRing();
+        }
+#endif
+#ifdef _WIN32
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+        backend_ = Backend::None;
+        next_offset_ = 0;
+        sequence_ = 0;
+        end_of_file_ = false;
+        serving_ = false;
+        setg(nullptr, nullptr, nullptr);
+    }
+
+    Backend backend() const { return backend_; }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (backend_ == Backend::None) {
+            return traits_type::eof();
+        }
+
+        const size_t index = static_cast<size_t>(sequence_ % slots_.size());
+        Slot& slot = slots_[index];
+        if (backend_ == Backend::Pread) {
+            slot.size = 0;
+            while (slot.size < block_size_) {
+                const int64_t read = readAt(slot.data + slot.size, block_size_ - slot.size, next_offset_ + slot.size);
+                if (read < 0) {
+                    throw std::ios_base::failure("Unable to read input file");
+                }
+                if (read == 0) {
+                    break;
+                }
+                slot.size += static_cast<size_t>(read);
+            }
+            next_offset_ += slot.size;
+        }
+#ifdef ISO8601_HAS_IO_URING
+        else {
+            // The block served last is free again: read the next one into it.
+            if (serving_) {
+                queueBlock(static_cast<size_t>((sequence_ - 1) % slots_.size()));
+                if (!submit()) {
+                    throw std::ios_base::failure("Unable to read input file");
+                }
+            }
+            while (!slot.done) {
+                if (!reapCompletion(true) && !enter(pending_, 1, IORING_ENTER_GETEVENTS)) {
+                    throw std::ios_base::failure("Unable to read input file");
+                }
+            }
+            if (slot.error != 0) {
+                throw std::ios_base::failure("Unable to read input file");
+            }
+        }
+#endif
+        serving_ = true;
+        sequence_++;
+        if (slot.size == 0) {
+            return traits_type::eof();
+        }
+        setg(slot.data, slot.data, slot.data + slot.size);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    // One block of the file and the buffer it is read into.
+    struct Slot
+    {
+        char* data = nullptr;
+        uint64_t offset = 0;
+        size_t size = 0;  // Bytes read so far.
+        bool done = false;
+        int error = 0;
+    };
+
+    // Reads at most size bytes at offset; returns the bytes read, 0 at the end of the file
+    // and -1 on failure.
+    int64_t readAt(char* data, size_t size, uint64_t offset)
+    {
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read = 0;
+        if (!ReadFile(file_, data, static_cast<DWORD>(size < 0x40000000 ? size : 0x40000000), &read, &position)) {
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+        }
+        return read;
+#else
+        while (true) {
+            const ssize_t read = pread(fd_, data, size, static_cast<off_t>(offset));
+            if (read >= 0 || errno != EINTR) {
+                return read;
+            }
+        }
+#endif
+    }
+
+#ifdef ISO8601_HAS_IO_URING
+    bool setupRing()
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(slots_.size()), &params));
+        if (ring_fd_ < 0) {
+            ring_fd_ = -1;
+            return false;
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = sq_ring_size_ > cq_ring_size_ ? sq_ring_size_ : cq_ring_size_;
+        }
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ :
+            mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            sqes_ = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqes);
+            teardownRing();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Registered buffers spare the kernel mapping them for every read. They count
+        // against RLIMIT_MEMLOCK on older kernels; without them the reads are plain readv.
+        iovecs_.resize(slots_.size());
+        for (size_t index = 0; index < slots_.size(); index++) {
+            iovecs_[index] = { slots_[index].data, block_size_ };
+        }
+        fixed_buffers_ = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iovecs_.data(),
+            static_cast<unsigned>(iovecs_.size())) == 0;
+        return true;
+    }
+
+    void teardownRing()
+    {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != nullptr && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != nullptr && sq_ring_ != MAP_FAILED) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+        sq_ring_ = cq_ring_ = nullptr;
+        sqes_ = nullptr;
+        in_flight_ = 0;
+        pending_ = 0;
+    }
+
+    // Queues the read of the next block of the file into a slot, unless the end of the
+    // file has been seen; the slot then stays empty and marks the end.
+    void queueBlock(size_t index)
+    {
+        Slot& slot = slots_[index];
+        slot.offset = next_offset_;
+        slot.size = 0;
+        slot.error = 0;
+        slot.done = end_of_file_;
+        if (!end_of_file_) {
+            next_offset_ += block_size_;
+            queueRead(index);
+        }
+    }
+
+    // Queues the read of the rest of a slot's block.
+    void queueRead(size_t index)
+    {
+        Slot& slot = slots_[index];
+        const unsigned tail = *sq_tail_;
+        const unsigned entry = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[entry];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = fd_;
+        sqe.off = slot.offset + slot.size;
+        sqe.user_data = index;
+        if (fixed_buffers_) {
+            sqe.opcode = IORING_OP_READ_FIXED;
+            sqe.addr = reinterpret_cast<uint64_t>(slot.data + slot.size);
+            sqe.len = static_cast<uint32_t>(block_size_ - slot.size);
+            sqe.buf_index = static_cast<uint16_t>(index);
+        }
+        else {
+            iovecs_[index] = { slot.data + slot.size, block_size_ - slot.size };
+            sqe.opcode = IORING_OP_READV;
+            sqe.addr = reinterpret_cast<uint64_t>(&iovecs_[index]);
+            sqe.len = 1;
+        }
+        sq_array_[entry] = entry;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        pending_++;
+        in_flight_++;
+    }
+
+    // Submits the queued reads without waiting for any of them.
+    bool submit()
+    {
+        return pending_ == 0 || enter(pending_, 0, 0);
+    }
+
+    bool enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        while (true) {
+            const long submitted = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+            if (submitted >= 0) {
+                pending_ -= static_cast<unsigned>(submitted) < pending_ ? static_cast<unsigned>(submitted) : pending_;
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+
+    // Takes one completion off the ring, if there is one. A short read is resubmitted for
+    // the rest of the block, since only a read of 0 bytes marks the end of the file.
+    bool reapCompletion(bool resubmit)
+    {
+        const unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        const size_t index = static_cast<size_t>(cqe.user_data);
+        const int result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        in_flight_--;
+        if (!resubmit) {
+            return true;
+        }
+
+        Slot& slot = slots_[index];
+        if (result > 0) {
+            slot.size += static_cast<size_t>(result);
+        }
+        if (result == 0) {
+            end_of_file_ = true;
+        }
+        if ((result == -EINTR || result == -EAGAIN || result > 0) && slot.size < block_size_) {
+            queueRead(index);
+            if (submit()) {
+                return true;
+            }
+            slot.error = EIO;
+        }
+        else if (result < 0) {
+            slot.error = -result;
+        }
+        slot.done = true;
+        return true;
+    }
+#endif
+
+    size_t block_size_;
+    std::vector<Slot> slots_;
+    std::vector<char> buffers_;
+    Backend backend_ = Backend::None;
+    // File offset of the next block to read.
+    uint64_t next_offset_ = 0;
+    // Number of blocks served so far; the next one is in slot sequence_ % depth.
+    uint64_t sequence_ = 0;
+    bool end_of_file_ = false;
+    // Whether the get area holds a block, whose slot is free once it is used up.
+    bool serving_ = false;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+#ifdef ISO8601_HAS_IO_URING
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    std::vector<iovec> iovecs_;
+    bool fixed_buffers_ = false;
+    unsigned pending_ = 0;   // Reads queued but not submitted.
+    unsigned in_flight_ = 0; // Reads queued and not completed.
+#endif
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Output file, or stdout, written through one large buffer.
+// Nothing is flushed per record: the buffer goes to the stream only when it is
+// full, on sync() and when the writer is closed.
+class ISO8601BufferedWriter
+{
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    // File name that writes to stdout instead of a file.
+    static constexpr const char* STDOUT_FILE_NAME = "-";
+
+    ISO8601BufferedWriter() : buffer_(BUFFER_SIZE) {}
+    ISO8601BufferedWriter(const ISO8601BufferedWriter&) = delete;
+    ISO8601BufferedWriter& operator=(const ISO8601BufferedWriter&) = delete;
+
+    ~ISO8601BufferedWriter()
+    {
+        close();
+    }
+
+    // Opens file_name, replacing its contents, or adding to them with append.
+    bool open(const std::string& file_name, bool append = false)
+    {
+        if (file_name == STDOUT_FILE_NAME) {
+            stream_ = &std::cout;
+            return true;
+        }
+        file_stream_.open(file_name, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+        if (!file_stream_.is_open()) {
+            return false;
+        }
+        stream_ = &file_stream_;
+        return true;
+    }
+
+    // Returns room for at least size characters; the characters actually written
+    // have to be committed with commit(). size must not exceed BUFFER_SIZE.
+    char* reserve(size_t size)
+    {
+        if (buffer_.size() - used_ < size) {
+            flush();
+        }
+        return buffer_.data() + used_;
+    }
+
+    void commit(size_t size)
+    {
+        used_ += size;
+    }
+
+    void write(std::string_view text)
+    {
+        if (text.size() > buffer_.size()) {
+            flush();
+            stream_->write(text.data(), static_cast<std::streamsize>(text.size()));
+            bytes_written_ += text.size();
+            return;
+        }
+        std::memcpy(reserve(text.size()), text.data(), text.size());
+        commit(text.size());
+    }
+
+    void flush()
+    {
+        if (used_ > 0 && stream_ != nullptr) {
+            stream_->write(buffer_.data(), static_cast<std::streamsize>(used_));
+            bytes_written_ += used_;
+        }
+        used_ = 0;
+    }
+
+    // Flushes the buffer and the stream, so everything written so far reaches a pipe.
+    void sync()
+    {
+        flush();
+        if (stream_ != nullptr) {
+            stream_->flush();
+        }
+    }
+
+    // Flushes the buffer and closes the file. Returns false if any write failed.
+    bool close()
+    {
+        if (stream_ == nullptr) {
+            return true;
+        }
+        flush();
+        stream_->flush();
+        bool good = stream_->good();
+        if (stream_ == &file_stream_) {
+            file_stream_.close();
+            good = good && !file_stream_.fail();
+        }
+        stream_ = nullptr;
+        return good;
+    }
+
+    // Bytes handed to the stream so far; everything written once the writer is closed.
+    uint64_t bytesWritten() const { return bytes_written_; }
+
+private:
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    uint64_t bytes_written_ = 0;
+    std::ofstream file_stream_;
+    std::ostream* stream_ = nullptr;
+};
@@ -1,96 +1,1546 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <iostream>
 #include <fstream>
-#include <regex>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include "../ISO8601DateTimeValidatorLib/isodatetime_validator.h"
+#include "ISO8601ApproximateSet.h"
+#include "ISO8601AsyncFileReader.h"
+#include "ISO8601BufferedWriter.h"
+#include "ISO8601DedupIndex.h"
+#include "ISO8601KeySet.h"
+#include "ISO8601MappedFile.h"
+#include "ISO8601Metrics.h"
+#include "ISO8601RadixSort.h"
+#include "ISO8601SpscRing.h"
+#include "ISO8601StaticValidator.h"
+#include "ISO8601TextArena.h"
+#include "ISO8601WindowedKeySet.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
 
 class ISO8601DateTimeProcessor
 {
 public:
+    // Where the records of the input file are read from.
+    enum class InputMode
+    {
+        Auto,         // Memory map regular files and stream everything else (pipes, stdin).
+        MemoryMapped, // Fail if the input file cannot be memory mapped.
+        Streamed,     // Always read the input in blocks.
+        AsyncRead     // Read a file in blocks with several reads in flight (io_uring on Linux,
+                      // pread where it is unavailable), so reading overlaps validation.
+    };
+
+    // What makes two valid date-time values duplicates of each other.
+    enum class DedupMode
+    {
+        Exact,  // Identical strings.
+        Instant // The same UTC instant, e.g. 2024-04-21T12:00:00Z and 2024-04-21T14:00:00+02:00.
+                // The first notation seen for an instant is kept.
+    };
+
+    // How the unique values are written.
+    enum class OutputFormat
+    {
+        Original,    // As they appeared in the input.
+        CanonicalUtc // Normalized to UTC: YYYY-MM-DDThh:mm:ssZ.
+    };
+
+    // In which order the unique values are written.
+    enum class OutputOrder
+    {
+        Unordered,      // Whatever order the dedup set holds them in.
+        Sorted,         // Chronologically by UTC instant; equal instants are ordered by their offset.
+        FirstOccurrence // In the order they first appear in the input. Single threaded processing
+                        // writes each value as soon as it is read instead of holding all of them.
+    };
+
+    // How the date-time values are laid out in the input.
+    enum class RecordLayout
+    {
+        OnePerLine, // Every line is one record; lines that are not a valid date-time are skipped.
+        FreeText    // Every valid date-time anywhere in the text is taken, e.g. from log lines.
+    };
+
+    struct ProcessingOptions
+    {
+        InputMode input_mode = InputMode::Auto;
+        // Number of worker threads; 0 uses every hardware thread. With more than one
+        // thread a memory mapped input is split into chunks that are validated and
+        // deduplicated in parallel, and the values are written in the order of their
+        // first occurrence in the input. Streamed input (stdin, pipes) goes through a
+        // pipeline instead: a reader thread, this many validator threads and the calling
+        // thread deduplicating and writing, so reading and writing overlap validation.
+        unsigned threads = 1;
+        // Size of the chunks the input is split into for parallel processing. Chunks
+        // are extended to the end of their last line, so no record is split.
+        size_t parallel_chunk_size = 4 << 20;
+        DedupMode dedup_mode = DedupMode::Exact;
+        OutputFormat output_format = OutputFormat::Original;
+        OutputOrder output_order = OutputOrder::Unordered;
+        RecordLayout record_layout = RecordLayout::OnePerLine;
+        // ISO8601_ACCEPT_* formats of one per line records. Values in formats other than
+        // the fixed width extended ones are kept as text and are processed on the calling
+        // thread. Free text is only searched for the extended formats.
+        unsigned accepted_formats = ISO8601_ACCEPT_EXTENDED;
+        // Approximate dedup for unbounded streams: a blocked Bloom filter of fixed size
+        // replaces the exact sets, under either dedup mode. A new value is taken for a
+        // duplicate, and dropped, with a probability of about false_positive_rate while
+        // at most approximate_capacity distinct values have been seen, and more often
+        // after that. With FirstOccurrence output nothing else is kept, so memory stays
+        // fixed however long the input is. Like windowed dedup, it runs on the calling thread
+        // or the streamed pipeline.
+        bool approximate_dedup = false;
+        uint64_t approximate_capacity = uint64_t(1) << 22;
+        double false_positive_rate = 0.001;
+        // Windowed dedup for streams that are nearly sorted by time: only the values
+        // within dedup_window_seconds of the latest instant seen are remembered, so a
+        // repeat is recognized while its first occurrence is still inside the window.
+        // Values older than the window are written as new. With FirstOccurrence output
+        // memory follows the window rather than the input. 0 remembers every value.
+        // Cannot be combined with approximate_dedup.
+        int64_t dedup_window_seconds = 0;
+        // Receives the rejection reasons, duplicate counts and stage timings of every
+        // thread of the run; nullptr skips the counting. Thread 0 is the calling thread,
+        // thread 1 the reader of the streamed pipeline and the threads from 2 on are the
+        // validators or the parallel workers.
+        ISO8601Metrics* metrics = nullptr;
+        // Incremental processing: the dedup state of earlier runs is kept in this file,
+        // see ISO8601DedupIndex. A run only reads the input past the bytes consumed
+        // before, up to its last complete line, appends the values that are not in the
+        // index to the output and merges them into the index. Needs an input that can be
+        // memory mapped, extended format values and exact dedup. Empty processes the
+        // whole input.
+        std::string index_file;
+    };
+
+    // Counts of a run of processDateTime.
+    struct ProcessingSummary
+    {
+        uint64_t unique_values = 0;      // Values written.
+        uint64_t estimated_distinct = 0; // HyperLogLog estimate of the distinct valid values; only with approximate dedup.
+        uint64_t late_values = 0;        // Values older than the dedup window; only with windowed dedup.
+        uint64_t skipped_bytes = 0;      // Input bytes consumed by earlier runs; only with an index file.
+    };
+
+    // Counts of one input of processDateTimeFiles.
+    struct InputSummary
+    {
+        std::string input_file;
+        uint64_t bytes = 0;
+        uint64_t records = 0;       // Lines, or the lines searched with free text.
+        uint64_t valid_values = 0;  // Valid date-times, duplicates included.
+        uint64_t unique_values = 0; // Values not seen in an earlier input, nor earlier in this one.
+    };
+
+    // A date-time found in free text and its byte offset from the start of the text.
+    struct DateTimeMatch
+    {
+        size_t offset;
+        std::string_view value;
+    };
+
+    // Input file name used to read the records from stdin.
+    static constexpr const char* STDIN_FILE_NAME = "-";
+
+    // Output file name used to write the values to stdout.
+    static constexpr const char* STDOUT_FILE_NAME = ISO8601BufferedWriter::STDOUT_FILE_NAME;
+
     static bool processDateTime(const std::string& input_file, const std::string& output_file) {
-        std::unordered_set<std::string> unique_datetimes;
+        return processDateTime(input_file, output_file, ProcessingOptions());
+    }
+
+    static bool processDateTime(const std::string& input_file, const std::string& output_file, const ProcessingOptions& options) {
+        ProcessingSummary summary;
+        return processDateTime(input_file, output_file, options, summary);
+    }
 
-        if (!readDateTimeValues(input_file, unique_datetimes)) {
-            return false; // Unable to read input file
+    static bool processDateTime(const std::string& input_file, const std::string& output_file, const ProcessingOptions& options,
+        ProcessingSummary& summary) {
+        ISO8601MappedFile mapped_file;
+        summary = ProcessingSummary();
+        if (options.approximate_dedup && options.dedup_window_seconds > 0) {
+            std::cerr << "Error: Approximate and windowed dedup cannot be combined." << std::endl;
+            return false;
         }
 
-        if (!writeUniqueDateTimeValues(output_file, unique_datetimes)) {
-            return false; // Unable to write output file
+        unsigned threads = resolveThreadCount(options.threads);
+        if (options.metrics != nullptr) {
+            options.metrics->prepare(METRICS_FIRST_WORKER + threads);
+        }
+        if (!options.index_file.empty()) {
+            return processIncremental(input_file, output_file, threads, options, summary);
         }
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        ISO8601BufferedWriter writer;
+        if (threads > 1 && !acceptsTextDateTimes(options) && hasExactKeySet(options) &&
+            mapsInputFile(options, input_file) && openMappedFile(mapped_file, input_file, metrics)) {
+            std::vector<uint64_t> unique_datetimes = processMappedParallel({ mapped_file.view() }, threads, options);
+            summary.unique_values = unique_datetimes.size();
+            if (!writeParallelDateTimeValues(writer, output_file, unique_datetimes, options)) {
+                return false; // Unable to open output file
+            }
+        }
+        else if (options.output_order == OutputOrder::FirstOccurrence) {
+            if (!openOutputFile(writer, output_file)) {
+                return false; // Unable to open output file
+            }
+
+            // Whenever the input has to be waited for, the values so far are passed on.
+            UniqueDateTimes unique_datetimes(options);
+            if (!readDateTimeValues(input_file, options, mapped_file, unique_datetimes, [&](const auto& value) {
+                    writeDateTimeValue(writer, value, options.output_format);
+                }, [&]() { writer.sync(); })) {
+                return false; // Unable to read input file
+            }
+            unique_datetimes.summarize(summary);
+        }
+        else {
+            UniqueDateTimes unique_datetimes(options);
+            if (!readDateTimeValues(input_file, options, mapped_file, unique_datetimes, [](const auto&) {}, []() {})) {
+                return false; // Unable to read input file
+            }
+            unique_datetimes.summarize(summary);
 
-        std::cout << "Unique valid date-time values have been written to " << output_file << std::endl;
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Write);
+            if (!openOutputFile(writer, output_file)) {
+                return false; // Unable to open output file
+            }
+            writeUniqueDateTimeValues(writer, unique_datetimes, options);
+        }
+
+        {
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Write);
+            if (!closeOutputFile(writer)) {
+                return false; // Unable to write output file
+            }
+        }
+        if (metrics != nullptr) {
+            metrics->add(ISO8601Metrics::Stage::Write, writer.bytesWritten(), summary.unique_values);
+        }
+
+        reportOutputFile(output_file);
         return true;
     }
 
-    static bool isDateTimeValid(const std::string& dt_str)
+    // Processes several inputs as if they were one, read one after the other: the values
+    // are deduplicated across all of them and written to one output. Every input is memory
+    // mapped and split into chunks of at most parallel_chunk_size, which the threads take
+    // one at a time whichever input they belong to, so a large input is shared out like
+    // many small ones. Needs extended format values and neither approximate nor windowed
+    // dedup. input_summaries receives the counts of every input.
+    static bool processDateTimeFiles(const std::vector<std::string>& input_files, const std::string& output_file,
+        const ProcessingOptions& options, ProcessingSummary& summary, std::vector<InputSummary>& input_summaries)
     {
-        return is_valid_iso8601_datetime(dt_str.c_str());
+        summary = ProcessingSummary();
+        input_summaries.clear();
+        if (acceptsTextDateTimes(options) || !hasExactKeySet(options) || !options.index_file.empty()) {
+            std::cerr << "Error: Processing several inputs needs extended format values, neither approximate nor windowed dedup, and no index file." << std::endl;
+            return false;
+        }
+
+        const unsigned threads = resolveThreadCount(options.threads);
+        if (options.metrics != nullptr) {
+            options.metrics->prepare(METRICS_FIRST_WORKER + threads);
+        }
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        std::vector<ISO8601MappedFile> mapped_files(input_files.size());
+        std::vector<std::string_view> inputs;
+        for (size_t f = 0; f < input_files.size(); f++) {
+            if (input_files[f] == STDIN_FILE_NAME || !openMappedFile(mapped_files[f], input_files[f], metrics)) {
+                std::cerr << "Error: Unable to memory map input file " << input_files[f] << "." << std::endl;
+                return false;
+            }
+            inputs.push_back(mapped_files[f].view());
+        }
+
+        std::vector<uint64_t> unique_datetimes = processMappedParallel(inputs, threads, options, &input_summaries);
+        for (size_t f = 0; f < input_files.size(); f++) {
+            input_summaries[f].input_file = input_files[f];
+        }
+        summary.unique_values = unique_datetimes.size();
+
+        ISO8601BufferedWriter writer;
+        if (!writeParallelDateTimeValues(writer, output_file, unique_datetimes, options)) {
+            return false;
+        }
+        {
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Write);
+            if (!closeOutputFile(writer)) {
+                return false;
+            }
+        }
+        if (metrics != nullptr) {
+            metrics->add(ISO8601Metrics::Stage::Write, writer.bytesWritten(), summary.unique_values);
+        }
+        reportOutputFile(output_file);
+        return true;
+    }
+
+    // Whether an input names several files: a directory, or a file name with the
+    // wildcards * and ?, such as logs/2024-04-21T*.txt.
+    static bool isInputPattern(const std::string& input)
+    {
+        std::error_code error;
+        return std::filesystem::is_directory(input, error) ||
+            std::filesystem::path(input).filename().string().find_first_of("*?") != std::string::npos;
+    }
+
+    // Lists the regular files of a directory, or those matching the wildcards of the file
+    // name of a pattern, sorted by name. Fails if nothing matches.
+    static bool findInputFiles(const std::string& pattern, std::vector<std::string>& input_files)
+    {
+        input_files.clear();
+        std::error_code error;
+        std::filesystem::path directory = pattern;
+        std::string file_pattern = "*";
+        if (!std::filesystem::is_directory(directory, error)) {
+            directory = std::filesystem::path(pattern).parent_path();
+            file_pattern = std::filesystem::path(pattern).filename().string();
+            if (directory.empty()) {
+                directory = ".";
+            }
+        }
+
+        for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error)) {
+            if (entry->is_regular_file(error) && matchesWildcards(entry->path().filename().string(), file_pattern)) {
+                input_files.push_back(entry->path().string());
+            }
+        }
+        if (error || input_files.empty()) {
+            std::cerr << "Error: No input file matches " << pattern << "." << std::endl;
+            return false;
+        }
+        std::sort(input_files.begin(), input_files.end());
+        return true;
+    }
+
+    static constexpr bool isDateTimeValid(std::string_view dt_str)
+    {
+        return ISO8601StaticValidator<>::isValid(dt_str);
+    }
+
+    // Validates dt_str and decodes its fields in one pass. On failure result.error
+    // and result.error_position tell why.
+    static constexpr bool parseDateTime(std::string_view dt_str, iso8601_datetime& result)
+    {
+        return ISO8601StaticValidator<>::parse(dt_str, result);
     }
+
+    // Same as parseDateTime for any combination of ISO8601_ACCEPT_* formats.
+    // The formats the command line offers are parsed inline, the others by the C library.
+    static bool parseDateTime(std::string_view dt_str, unsigned accepted_formats, iso8601_datetime& result)
+    {
+        switch (accepted_formats)
+        {
+        case ISO8601_ACCEPT_EXTENDED:
+            return ISO8601StaticValidator<ISO8601_ACCEPT_EXTENDED>::parse(dt_str, result);
+        case ISO8601_ACCEPT_ALL_DATETIMES:
+            return ISO8601StaticValidator<ISO8601_ACCEPT_ALL_DATETIMES>::parse(dt_str, result);
+        default:
+            return iso8601_parse_datetime_format(dt_str.data(), dt_str.size(), accepted_formats, &result);
+        }
+    }
+
+    // Finds every valid date-time in a text containing a mixture of messages and
+    // date-time strings, such as generated_mixed_text_message_datetime.txt, in order.
+    // The values point into text.
+    static std::vector<DateTimeMatch> findDateTimes(std::string_view text)
+    {
+        std::vector<DateTimeMatch> matches;
+        forEachDateTimeInText(text, [&](std::string_view dt_str) {
+            matches.push_back({ static_cast<size_t>(dt_str.data() - text.data()), dt_str });
+        });
+        return matches;
+    }
+
+    // Validates an Arrow string column in place into an Arrow validity bitmap of
+    // (rows + 7) / 8 bytes and, if epoch_microseconds is not nullptr, a column of rows
+    // microseconds since the epoch; see iso8601_validate_string_column. The rows are
+    // split into ranges of COLUMN_RANGE_ROWS that are validated on up to threads threads,
+    // 0 for every hardware thread. Returns the number of valid rows.
+    static size_t validateStringColumn(const iso8601_string_column& column, unsigned accepted_formats,
+        uint8_t* validity, int64_t* epoch_microseconds, unsigned threads = 1)
+    {
+        const size_t ranges = (column.rows + COLUMN_RANGE_ROWS - 1) / COLUMN_RANGE_ROWS;
+        std::atomic<size_t> valid{ 0 };
+        parallelFor(ranges, resolveThreadCount(threads), [&](size_t range, unsigned) {
+            const size_t begin = range * COLUMN_RANGE_ROWS;
+            valid += iso8601_validate_string_column(&column, begin, std::min(column.rows, begin + COLUMN_RANGE_ROWS),
+                accepted_formats, validity, epoch_microseconds);
+        });
+        return valid;
+    }
+
 private:
-    static bool readDateTimeValues(const std::string& input_file, std::unordered_set<std::string>& unique_datetimes)
+    // Rows of a string column validated as one task; a multiple of 8, so the tasks write
+    // separate bytes of the validity bitmap, and large enough to amortize handing them out.
+    static constexpr size_t COLUMN_RANGE_ROWS = 1 << 16;
+
+    // Size of the blocks read from a streamed input. Records are validated in place
+    // inside the block, ISO8601_CHUNK_RECORDS at a time.
+    static constexpr size_t READ_BUFFER_SIZE = 1 << 20;
+
+    // Valid records are partitioned into 2^DEDUP_SHARD_BITS dedup shards by the top
+    // bits of the hash of their key, so every shard can be deduplicated without locking.
+    static constexpr unsigned DEDUP_SHARD_BITS = 6;
+    static constexpr size_t DEDUP_SHARDS = size_t(1) << DEDUP_SHARD_BITS;
+
+    // Records of one call of iso8601_validate_chunk, located relative to base.
+    // stable is set when base stays valid after the chunk has been handled (memory
+    // mapped input); otherwise the records have to be copied to be kept.
+    struct RecordChunk
+    {
+        const char* base;
+        const iso8601_record_span* spans;
+        const uint64_t* valid_bitmap;
+        size_t count;
+        bool stable;
+
+        std::string_view record(size_t i) const { return std::string_view(base + spans[i].offset, spans[i].length); }
+        bool isValid(size_t i) const { return ISO8601_BITMAP_TEST(valid_bitmap, i) != 0; }
+    };
+
+    // Metrics slots of the threads of a run; see ProcessingOptions::metrics.
+    static constexpr size_t METRICS_CALLING_THREAD = 0;
+    static constexpr size_t METRICS_READER_THREAD = 1;
+    static constexpr size_t METRICS_FIRST_WORKER = 2;
+
+    // Counters of a thread of the run, or nullptr if nothing is counted.
+    static ISO8601Metrics::Counters* threadMetrics(const ProcessingOptions& options, size_t slot)
+    {
+        if constexpr (ISO8601_METRICS_ENABLED) {
+            if (options.metrics != nullptr) {
+                return &options.metrics->thread(slot);
+            }
+        }
+        return nullptr;
+    }
+
+    // Validates records ISO8601_CHUNK_RECORDS at a time into spans and a bitmap of its own,
+    // which the returned chunk refers to until the next call. With metrics, the records
+    // are counted, and the rejected ones are parsed again for the reason.
+    class ChunkValidator
+    {
+    public:
+        ChunkValidator(const ProcessingOptions& options, ISO8601Metrics::Counters* metrics)
+            : spans_(ISO8601_CHUNK_RECORDS), options_(options), metrics_(metrics) {}
+
+        RecordChunk validate(const char* data, size_t size, bool end_of_input, bool stable, size_t& consumed)
+        {
+            ISO8601Metrics::StageTimer timer(metrics_, ISO8601Metrics::Stage::Validate);
+            consumed = 0;
+            size_t count = iso8601_validate_chunk(data, size, end_of_input,
+                spans_.data(), valid_bitmap_, ISO8601_CHUNK_RECORDS, &consumed);
+            RecordChunk chunk{ data, spans_.data(), valid_bitmap_, count, stable };
+            if (metrics_ != nullptr) {
+                metrics_->add(ISO8601Metrics::Stage::Validate, consumed, count);
+                countRejections(chunk);
+            }
+            return chunk;
+        }
+
+    private:
+        // Free text has no records to reject, only date-times to find.
+        void countRejections(const RecordChunk& chunk)
+        {
+            if (options_.record_layout != RecordLayout::OnePerLine) {
+                return;
+            }
+            const bool accepts_extended = (options_.accepted_formats & ISO8601_ACCEPT_EXTENDED) != 0;
+            for (size_t i = 0; i < chunk.count; i++) {
+                if (accepts_extended && chunk.isValid(i)) {
+                    continue;
+                }
+                iso8601_datetime parsed;
+                if (!parseDateTime(chunk.record(i), options_.accepted_formats, parsed)) {
+                    metrics_->reject(chunk.record(i), parsed);
+                }
+            }
+        }
+
+        std::vector<iso8601_record_span> spans_;
+        uint64_t valid_bitmap_[ISO8601_BITMAP_WORDS(ISO8601_CHUNK_RECORDS)];
+        const ProcessingOptions& options_;
+        ISO8601Metrics::Counters* metrics_;
+    };
+
+    // Blocks of READ_BUFFER_SIZE bytes in flight in the streamed pipeline, per validator
+    // thread. The pipeline never holds more, however long the input is.
+    static constexpr size_t PIPELINE_BLOCKS_PER_VALIDATOR = 2;
+
+    // A block of whole records moving through the streamed pipeline, and the values the
+    // validator found in it, in input order.
+    struct PipelineBlock
+    {
+        std::vector<char> data;
+        size_t size = 0;
+        // Packed keys of the valid values; 0, which is never a key, for the next value of texts.
+        std::vector<uint64_t> keys;
+        std::vector<std::pair<std::string_view, iso8601_datetime>> texts;
+        // Whether the last read into the block was short, so the input is waited for.
+        bool caught_up = false;
+    };
+
+    // Number of matches collected per call of iso8601_find_datetimes.
+    static constexpr size_t TEXT_MATCH_BATCH = 64;
+
+    // Key of a valid record and the position of the record in the input.
+    struct PositionedKey
+    {
+        uint64_t position;
+        uint64_t key;
+    };
+
+    // A valid value that has no packed key: basic format, a decimal fraction or
+    // reduced precision. Kept as text with its instant; the text is stored in the arena of
+    // the UniqueDateTimes, or is the record itself while it is being written.
+    struct TextDateTime
+    {
+        std::string_view text;
+        int64_t seconds;   // Since 1970-01-01T00:00:00Z.
+        uint32_t fraction; // Nanoseconds.
+    };
+
+    // Offset code of the keys that stand for whole second text values in Instant mode.
+    // Real offsets are below 24 hours, so the code is never taken by a real key.
+    static constexpr uint64_t TEXT_KEY_OFFSET_CODE = 0x7FF;
+
+    // End of the instants a packed key can hold.
+    static constexpr int64_t MAX_KEY_SECONDS = (int64_t(1) << (64 - ISO8601_KEY_INSTANT_SHIFT)) - ISO8601_KEY_EPOCH_BIAS;
+
+    // Unique values of a run on the calling thread.
+    class UniqueDateTimes
+    {
+    public:
+        explicit UniqueDateTimes(const ProcessingOptions& options)
+            : keys(ignoredKeyBits(options.dedup_mode)), dedup_mode_(options.dedup_mode),
+            retain_values_(options.output_order != OutputOrder::FirstOccurrence)
+        {
+            if (options.approximate_dedup) {
+                filter_ = std::make_unique<ISO8601BlockedBloomFilter>(options.approximate_capacity, options.false_positive_rate);
+                distinct_ = std::make_unique<ISO8601HyperLogLog>();
+            }
+            else if (options.dedup_window_seconds > 0) {
+                window_ = std::make_unique<ISO8601WindowedKeySet>(options.dedup_window_seconds, ignoredKeyBits(options.dedup_mode));
+            }
+        }
+
+        // Returns true if the value of key was not seen before.
+        bool insertKey(uint64_t key)
+        {
+            if (hasKeySet()) {
+                return counted(keys.insert(key));
+            }
+            const bool inserted = window_ ? window_->insert(key) : insertApproximate(key >> ignoredKeyBits(dedup_mode_));
+            if (!counted(inserted)) {
+                return false;
+            }
+            if (retain_values_) {
+                retained_keys.push_back(key);
+            }
+            return true;
+        }
+
+        // Returns the stored value if text was not seen before, nullptr otherwise.
+        // In Instant mode a whole second value is deduplicated through a key with
+        // TEXT_KEY_OFFSET_CODE, so it also matches the extended values of its instant.
+        // Expanded years beyond the range of the keys are deduplicated by their text.
+        // Without values to write at the end, only the last one is kept.
+        const TextDateTime* insertText(std::string_view text, const iso8601_datetime& parsed)
+        {
+            const int64_t seconds = iso8601_parsed_to_unix_seconds(&parsed);
+            const bool instant_key = dedup_mode_ == DedupMode::Instant && parsed.fraction == 0 &&
+                seconds >= -ISO8601_KEY_EPOCH_BIAS && seconds < MAX_KEY_SECONDS;
+            const uint64_t key = instant_key
+                ? (static_cast<uint64_t>(seconds + ISO8601_KEY_EPOCH_BIAS) << ISO8601_KEY_INSTANT_SHIFT) | TEXT_KEY_OFFSET_CODE
+                : 0;
+            char instant[INSTANT_TEXT_SIZE];
+            std::string_view stored;
+            bool inserted;
+            if (filter_) {
+                inserted = insertApproximate(instant_key ? key >> ISO8601_KEY_INSTANT_SHIFT
+                    : dedup_mode_ == DedupMode::Exact ? std::hash<std::string_view>()(text)
+                    : iso8601Mix64(static_cast<uint64_t>(seconds)) ^ parsed.fraction);
+            }
+            else if (window_) {
+                inserted = instant_key ? window_->insert(key) : window_->insertText(seconds,
+                    dedup_mode_ == DedupMode::Exact ? text : instantText(seconds, parsed.fraction, instant));
+            }
+            else if (dedup_mode_ == DedupMode::Exact) {
+                std::tie(stored, inserted) = text_index_.insert(text);
+            }
+            else if (instant_key) {
+                inserted = keys.insert(key);
+            }
+            else {
+                inserted = text_index_.insert(instantText(seconds, parsed.fraction, instant)).second;
+            }
+            if (!counted(inserted)) {
+                return nullptr;
+            }
+            if (!retain_values_) {
+                last_text_ = { text, seconds, parsed.fraction };
+                return &last_text_;
+            }
+            // In Exact mode the index already holds a copy of the text.
+            if (stored.data() == nullptr) {
+                stored = values_arena_.store(text);
+            }
+            texts.push_back({ stored, seconds, parsed.fraction });
+            return &texts.back();
+        }
+
+        // Whether the unique keys are in keys rather than in retained_keys.
+        bool hasKeySet() const { return !filter_ && !window_; }
+
+        void summarize(ProcessingSummary& summary) const
+        {
+            summary.unique_values = unique_values_;
+            summary.estimated_distinct = distinct_ ? distinct_->estimate() : 0;
+            summary.late_values = window_ ? window_->lateValues() : 0;
+        }
+
+        // Keys of the unique values; with approximate or windowed dedup they are in retained_keys instead.
+        ISO8601KeySet keys;
+        std::vector<uint64_t> retained_keys;
+        std::vector<TextDateTime> texts;
+
+    private:
+        bool counted(bool inserted)
+        {
+            unique_values_ += inserted;
+            return inserted;
+        }
+
+        static constexpr size_t INSTANT_TEXT_SIZE = sizeof(int64_t) + sizeof(uint32_t);
+
+        // Seconds and fraction as raw bytes, which are only ever compared, in buffer.
+        static std::string_view instantText(int64_t seconds, uint32_t fraction, char (&buffer)[INSTANT_TEXT_SIZE])
+        {
+            std::memcpy(buffer, &seconds, sizeof(seconds));
+            std::memcpy(buffer + sizeof(seconds), &fraction, sizeof(fraction));
+            return std::string_view(buffer, INSTANT_TEXT_SIZE);
+        }
+
+        bool insertApproximate(uint64_t value)
+        {
+            distinct_->add(value);
+            return filter_->insert(value);
+        }
+
+        DedupMode dedup_mode_;
+        // Whether the values are written after the whole input has been read.
+        bool retain_values_;
+        uint64_t unique_values_ = 0;
+        TextDateTime last_text_;
+        // Text of the values in Exact mode; seconds and fraction of the values without a key in Instant mode.
+        ISO8601TextSet text_index_;
+        // Text of the retained values that text_index_ does not hold.
+        ISO8601TextArena values_arena_;
+        std::unique_ptr<ISO8601BlockedBloomFilter> filter_;
+        std::unique_ptr<ISO8601HyperLogLog> distinct_;
+        std::unique_ptr<ISO8601WindowedKeySet> window_;
+    };
+
+    // * matches any characters, ? any one character.
+    static bool matchesWildcards(std::string_view name, std::string_view pattern)
+    {
+        // Where to resume after the last *: the pattern after it, and the name it has taken.
+        size_t star = std::string_view::npos;
+        size_t star_name = 0;
+        size_t n = 0;
+        size_t p = 0;
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                n++;
+                p++;
+            }
+            else if (p < pattern.size() && pattern[p] == '*') {
+                star = ++p;
+                star_name = n;
+            }
+            else if (star != std::string_view::npos) {
+                p = star;
+                n = ++star_name;
+            }
+            else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+    // Orders the unique keys of the parallel path and writes them to a newly opened output.
+    static bool writeParallelDateTimeValues(ISO8601BufferedWriter& writer, const std::string& output_file,
+        std::vector<uint64_t>& unique_datetimes, const ProcessingOptions& options)
+    {
+        ISO8601Metrics::StageTimer timer(threadMetrics(options, METRICS_CALLING_THREAD), ISO8601Metrics::Stage::Write);
+        if (options.output_order == OutputOrder::Sorted) {
+            iso8601RadixSortKeys(unique_datetimes);
+        }
+        if (!openOutputFile(writer, output_file)) {
+            return false;
+        }
+        writeDateTimeValues(writer, unique_datetimes, options.output_format);
+        return true;
+    }
+
+    static void reportOutputFile(const std::string& output_file)
+    {
+        // stdout carries the values themselves.
+        if (output_file != STDOUT_FILE_NAME) {
+            std::cout << "Unique valid date-time values have been written to " << output_file << std::endl;
+        }
+    }
+
+    // Processes the bytes of the input added since the last run recorded in the index.
+    // The new bytes go through the parallel path, which returns their unique keys in
+    // input order; the keys the index already holds are then dropped, the rest is
+    // appended to the output and merged into the index. The index is saved after the
+    // output has been written, together with the length of the output. A run interrupted
+    // in between is repeated: the next run first cuts the output back to the length the
+    // index records, so the values of the lost run are not written twice. An output on
+    // stdout cannot be cut back, and may repeat the values of an interrupted run.
+    static bool processIncremental(const std::string& input_file, const std::string& output_file, unsigned threads,
+        const ProcessingOptions& options, ProcessingSummary& summary)
+    {
+        if (acceptsTextDateTimes(options) || !hasExactKeySet(options)) {
+            std::cerr << "Error: Incremental processing needs extended format values and exact dedup." << std::endl;
+            return false;
+        }
+        const unsigned ignored_bits = ignoredKeyBits(options.dedup_mode);
+        ISO8601DedupIndex index;
+        if (!index.open(options.index_file, ignored_bits)) {
+            std::cerr << "Error: Unable to read dedup index." << std::endl;
+            return false;
+        }
+        if (index.ignoredLowBits() != ignored_bits) {
+            std::cerr << "Error: The dedup index was built with another dedup mode." << std::endl;
+            return false;
+        }
+
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        ISO8601MappedFile mapped_file;
+        if (input_file == STDIN_FILE_NAME || !openMappedFile(mapped_file, input_file, metrics)) {
+            std::cerr << "Error: Incremental processing needs an input file that can be memory mapped." << std::endl;
+            return false;
+        }
+        const std::string_view input = mapped_file.view();
+        ISO8601DedupIndex::Input consumed;
+        consumed.name = std::filesystem::absolute(input_file).lexically_normal().string();
+        const size_t begin = static_cast<size_t>(index.resumeOffset(consumed.name, input));
+        // A line still being appended is left for the next run.
+        const size_t last_newline = input.find_last_of('\n');
+        const size_t end = last_newline != std::string_view::npos && last_newline >= begin ? last_newline + 1 : begin;
+        summary.skipped_bytes = begin;
+
+        ISO8601DedupIndex::Output written;
+        if (output_file != STDOUT_FILE_NAME) {
+            written.name = std::filesystem::absolute(output_file).lexically_normal().string();
+            if (!truncateUnindexedOutput(output_file, written.name, index.output())) {
+                return false;
+            }
+        }
+
+        std::vector<uint64_t> unique_datetimes = processMappedParallel({ input.substr(begin, end - begin) }, threads, options);
+
+        ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Write);
+        std::vector<uint64_t> sorted_keys = unique_datetimes;
+        iso8601RadixSortKeys(sorted_keys);
+        std::vector<uint64_t> known_keys;
+        std::vector<uint64_t> new_keys;
+        index.partition(sorted_keys, known_keys, new_keys);
+        if (metrics != nullptr) {
+            metrics->duplicates += known_keys.size();
+        }
+        if (options.output_order != OutputOrder::Sorted && !known_keys.empty()) {
+            ISO8601KeySet known(ignored_bits);
+            known.reserve(known_keys.size());
+            for (uint64_t key : known_keys) {
+                known.insert(key);
+            }
+            unique_datetimes.erase(std::remove_if(unique_datetimes.begin(), unique_datetimes.end(),
+                [&](uint64_t key) { return known.contains(key); }), unique_datetimes.end());
+        }
+        summary.unique_values = new_keys.size();
+
+        ISO8601BufferedWriter writer;
+        if (!writer.open(output_file, true)) {
+            std::cerr << "Error: Unable to open output file." << std::endl;
+            return false;
+        }
+        writeDateTimeValues(writer, options.output_order == OutputOrder::Sorted ? new_keys : unique_datetimes,
+            options.output_format);
+        if (!closeOutputFile(writer)) {
+            return false;
+        }
+        if (metrics != nullptr) {
+            metrics->add(ISO8601Metrics::Stage::Write, writer.bytesWritten(), summary.unique_values);
+        }
+
+        consumed.consumed_bytes = end;
+        consumed.fingerprint = ISO8601DedupIndex::fingerprint(input.substr(0, end));
+        if (!written.name.empty()) {
+            std::error_code error;
+            written.bytes = std::filesystem::file_size(output_file, error);
+        }
+        if (!index.save(options.index_file, new_keys, consumed, written)) {
+            std::cerr << "Error: Unable to write dedup index." << std::endl;
+            return false;
+        }
+        reportOutputFile(output_file);
+        return true;
+    }
+
+    // Cuts off what a run that did not get to save the index appended to the output.
+    // An output the index does not know, or one shorter than recorded (rotated or
+    // truncated by hand), is left alone.
+    static bool truncateUnindexedOutput(const std::string& output_file, const std::string& output_name,
+        const ISO8601DedupIndex::Output& indexed)
+    {
+        std::error_code error;
+        if (indexed.name != output_name || !std::filesystem::exists(output_file, error)) {
+            return true;
+        }
+        const uint64_t size = std::filesystem::file_size(output_file, error);
+        if (!error && size > indexed.bytes) {
+            std::filesystem::resize_file(output_file, indexed.bytes, error);
+        }
+        if (error) {
+            std::cerr << "Error: Unable to restore the output to the length recorded in the dedup index." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Whether every unique key is held in one exact set, which the sharded parallel path builds too.
+    static bool hasExactKeySet(const ProcessingOptions& options)
+    {
+        return !options.approximate_dedup && options.dedup_window_seconds <= 0;
+    }
+
+    static bool acceptsTextDateTimes(const ProcessingOptions& options)
+    {
+        return options.record_layout == RecordLayout::OnePerLine && options.accepted_formats != ISO8601_ACCEPT_EXTENDED;
+    }
+
+    static bool isTextDateTimeKey(uint64_t key)
+    {
+        return (key & TEXT_KEY_OFFSET_CODE) == TEXT_KEY_OFFSET_CODE;
+    }
+
+    // Unique values are kept as packed keys (see iso8601_datetime_key) and turned
+    // back into text by the writer, so no record is copied or kept as a string.
+    // Only values in other accepted formats are copied, as TextDateTime.
+    // on_unique is called with the key or the TextDateTime of every value the first
+    // time it is seen, in input order. on_caught_up is called when every value read so
+    // far has been handled and the input has nothing more yet, such as an idle pipe.
+    template <typename UniqueHandler, typename CaughtUpHandler>
+    static bool readDateTimeValues(const std::string& input_file, const ProcessingOptions& options,
+        ISO8601MappedFile& mapped_file, UniqueDateTimes& unique_datetimes, UniqueHandler&& on_unique,
+        CaughtUpHandler&& on_caught_up)
+    {
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        auto insert_key = [&](uint64_t key) {
+            const bool unique = unique_datetimes.insertKey(key);
+            if (unique) {
+                on_unique(key);
+            }
+            if (metrics != nullptr) {
+                metrics->deduplicated(unique);
+            }
+        };
+        auto insert_text = [&](std::string_view text, const iso8601_datetime& parsed) {
+            const TextDateTime* value = unique_datetimes.insertText(text, parsed);
+            if (value != nullptr) {
+                on_unique(*value);
+            }
+            if (metrics != nullptr) {
+                metrics->deduplicated(value != nullptr);
+            }
+        };
+        auto handle_chunk = [&](const RecordChunk& chunk) {
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Dedup);
+            forEachValue(chunk, options, insert_key, insert_text);
+        };
+
+        const unsigned validators = resolveThreadCount(options.threads);
+        return readRecordChunks(input_file, options, mapped_file, handle_chunk, [&](std::istream& input_stream) {
+            if (validators == 1) {
+                return validateStreamedChunks(input_stream, options, metrics, handle_chunk, on_caught_up);
+            }
+            return processStreamedPipeline(input_stream, options, validators, insert_key, insert_text, on_caught_up);
+        });
+    }
+
+    // Calls on_key with the packed key of every valid extended value of a chunk, and
+    // on_text with the text and fields of every valid value in another accepted format,
+    // in input order.
+    template <typename KeyHandler, typename TextHandler>
+    static void forEachValue(const RecordChunk& chunk, const ProcessingOptions& options,
+        KeyHandler&& on_key, TextHandler&& on_text)
+    {
+        if (!acceptsTextDateTimes(options)) {
+            forEachDateTime(chunk, options.record_layout, [&](std::string_view dt_str) {
+                on_key(dateTimeKey(dt_str));
+            });
+            return;
+        }
+
+        // Records that fail the extended fast path are parsed again in the accepted formats.
+        const bool accepts_extended = (options.accepted_formats & ISO8601_ACCEPT_EXTENDED) != 0;
+        for (size_t i = 0; i < chunk.count; i++) {
+            if (accepts_extended && chunk.isValid(i)) {
+                on_key(dateTimeKey(chunk.record(i)));
+                continue;
+            }
+            iso8601_datetime parsed;
+            if (parseDateTime(chunk.record(i), options.accepted_formats, parsed)) {
+                on_text(chunk.record(i), parsed);
+            }
+        }
+    }
+
+    // Calls handler with every valid date-time of a chunk of records.
+    template <typename DateTimeHandler>
+    static void forEachDateTime(const RecordChunk& chunk, RecordLayout record_layout, DateTimeHandler&& handler)
+    {
+        for (size_t i = 0; i < chunk.count; i++) {
+            if (record_layout == RecordLayout::FreeText) {
+                forEachDateTimeInText(chunk.record(i), handler);
+            }
+            else if (chunk.isValid(i)) {
+                handler(chunk.record(i));
+            }
+        }
+    }
+
+    template <typename DateTimeHandler>
+    static void forEachDateTimeInText(std::string_view text, DateTimeHandler&& handler)
+    {
+        iso8601_record_span matches[TEXT_MATCH_BATCH];
+        size_t count;
+        do {
+            size_t scanned = 0;
+            count = iso8601_find_datetimes(text.data(), text.size(), matches, TEXT_MATCH_BATCH, &scanned);
+            for (size_t i = 0; i < count; i++) {
+                handler(text.substr(matches[i].offset, matches[i].length));
+            }
+            text.remove_prefix(scanned);
+        } while (count == TEXT_MATCH_BATCH);
+    }
+
+    static uint64_t dateTimeKey(std::string_view dt_str)
+    {
+        return iso8601_datetime_key(dt_str.data(), dt_str.size());
+    }
+
+    // Low bits of the packed keys that the dedup sets ignore.
+    static unsigned ignoredKeyBits(DedupMode dedup_mode)
+    {
+        return dedup_mode == DedupMode::Instant ? ISO8601_KEY_INSTANT_SHIFT : 0;
+    }
+
+    static unsigned resolveThreadCount(unsigned threads)
+    {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        return threads == 0 ? 1 : threads;
+    }
+
+    // Runs task(0, worker) ... task(count - 1, worker) on up to threads threads, including
+    // the calling one, which is worker 0.
+    template <typename Task>
+    static void parallelFor(size_t count, unsigned threads, Task&& task)
+    {
+        std::atomic<size_t> next_index{ 0 };
+        auto worker = [&](unsigned t) {
+            for (size_t i = next_index++; i < count; i = next_index++) {
+                task(i, t);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads && t < count; t++) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+
+    // A part of an input of the parallel path, validated as one task.
+    struct ChunkRange
+    {
+        size_t input;
+        size_t begin;
+        size_t end;
+        uint64_t records = 0;
+        uint64_t valid_values = 0;
+    };
+
+    // Validates and deduplicates memory mapped inputs on several threads, as if they were
+    // one input read one after the other.
+    // 1. Every input is split into chunks at newline boundaries. Each chunk is validated
+    //    independently and its valid records are partitioned by dedup shard.
+    // 2. Each shard deduplicates its records, visiting the chunks in input order.
+    // 3. The unique records of all shards are merged by their position in the inputs.
+    // The result only depends on the inputs, not on the number of threads.
+    // input_summaries, if given, receives the counts of every input but its name.
+    static std::vector<uint64_t> processMappedParallel(const std::vector<std::string_view>& inputs, unsigned threads,
+        const ProcessingOptions& options, std::vector<InputSummary>* input_summaries = nullptr)
+    {
+        const unsigned ignored_bits = ignoredKeyBits(options.dedup_mode);
+
+        // Positions count from the start of the first input through all of them.
+        std::vector<uint64_t> input_positions;
+        std::vector<ChunkRange> chunk_ranges;
+        uint64_t position = 0;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const char* data = inputs[i].data();
+            const size_t size = inputs[i].size();
+            for (size_t begin = 0; begin < size;) {
+                size_t end = std::min(size, begin + std::max<size_t>(options.parallel_chunk_size, 1));
+                if (end < size) {
+                    const void* newline = std::memchr(data + end, '\n', size - end);
+                    end = newline != nullptr ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+                }
+                chunk_ranges.push_back({ i, begin, end });
+                begin = end;
+            }
+            input_positions.push_back(position);
+            position += size;
+        }
+
+        // partitions[chunk][shard] holds the keys of the valid records of a chunk that belong to a shard.
+        std::vector<std::vector<std::vector<PositionedKey>>> partitions(chunk_ranges.size());
+        parallelFor(chunk_ranges.size(), threads, [&](size_t c, unsigned worker) {
+            ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_FIRST_WORKER + worker);
+            ChunkRange& range = chunk_ranges[c];
+            const char* data = inputs[range.input].data();
+            const uint64_t input_position = input_positions[range.input];
+            auto& shards = partitions[c];
+            shards.resize(DEDUP_SHARDS);
+            auto partition = [&](const RecordChunk& chunk) {
+                range.records += chunk.count;
+                forEachDateTime(chunk, options.record_layout, [&](std::string_view dt_str) {
+                    uint64_t key = dateTimeKey(dt_str);
+                    shards[shardOf(key >> ignored_bits)].push_back({ input_position + static_cast<uint64_t>(dt_str.data() - data), key });
+                    range.valid_values++;
+                });
+            };
+            validateMappedChunks(data + range.begin, range.end - range.begin, options, metrics, partition);
+        });
+
+        std::vector<std::vector<PositionedKey>> shard_unique(DEDUP_SHARDS);
+        parallelFor(DEDUP_SHARDS, threads, [&](size_t shard, unsigned worker) {
+            ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_FIRST_WORKER + worker);
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Dedup);
+            ISO8601KeySet seen(ignored_bits);
+            for (auto& shards : partitions) {
+                for (const PositionedKey& record : shards[shard]) {
+                    const bool unique = seen.insert(record.key);
+                    if (unique) {
+                        shard_unique[shard].push_back(record);
+                    }
+                    if (metrics != nullptr) {
+                        metrics->deduplicated(unique);
+                    }
+                }
+                std::vector<PositionedKey>().swap(shards[shard]);
+            }
+        });
+
+        size_t total = 0;
+        for (const auto& unique : shard_unique) {
+            total += unique.size();
+        }
+        std::vector<PositionedKey> merged;
+        merged.reserve(total);
+        for (auto& unique : shard_unique) {
+            merged.insert(merged.end(), unique.begin(), unique.end());
+            std::vector<PositionedKey>().swap(unique);
+        }
+        std::sort(merged.begin(), merged.end(), [](const PositionedKey& a, const PositionedKey& b) {
+            return a.position < b.position;
+        });
+
+        if (input_summaries != nullptr) {
+            input_summaries->assign(inputs.size(), InputSummary());
+            for (size_t i = 0; i < inputs.size(); i++) {
+                (*input_summaries)[i].bytes = inputs[i].size();
+            }
+            for (const ChunkRange& range : chunk_ranges) {
+                (*input_summaries)[range.input].records += range.records;
+                (*input_summaries)[range.input].valid_values += range.valid_values;
+            }
+            size_t input = 0;
+            for (const PositionedKey& record : merged) {
+                while (input + 1 < inputs.size() && record.position >= input_positions[input + 1]) {
+                    input++;
+                }
+                (*input_summaries)[input].unique_values++;
+            }
+        }
+
+        std::vector<uint64_t> unique_datetimes(merged.size());
+        for (size_t i = 0; i < merged.size(); i++) {
+            unique_datetimes[i] = merged[i].key;
+        }
+        return unique_datetimes;
+    }
+
+    static size_t shardOf(uint64_t key)
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - DEDUP_SHARD_BITS));
+    }
+
+    // Validates every record of the input and passes the results to handler one chunk at a time.
+    // An input that is not memory mapped is handed to read_stream instead.
+    template <typename ChunkHandler, typename StreamReader>
+    static bool readRecordChunks(const std::string& input_file, const ProcessingOptions& options,
+        ISO8601MappedFile& mapped_file, ChunkHandler&& handler, StreamReader&& read_stream)
     {
-        std::ifstream input_stream(input_file);
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        if (mapsInputFile(options, input_file)) {
+            if (openMappedFile(mapped_file, input_file, metrics)) {
+                validateMappedChunks(mapped_file.data(), mapped_file.size(), options, metrics, handler);
+                return true;
+            }
+            if (options.input_mode == InputMode::MemoryMapped) {
+                std::cerr << "Error: Unable to memory map input file." << std::endl;
+                return false;
+            }
+        }
+
+        if (input_file == STDIN_FILE_NAME) {
+            return read_stream(std::cin);
+        }
+
+        if (options.input_mode == InputMode::AsyncRead) {
+            ISO8601AsyncFileReader reader;
+            if (!reader.open(input_file)) {
+                std::cerr << "Error: Unable to open input file." << std::endl;
+                return false;
+            }
+            std::istream input_stream(&reader);
+            return read_stream(input_stream);
+        }
+
+        std::ifstream input_stream(input_file, std::ios::binary);
         if (!input_stream.is_open()) {
             std::cerr << "Error: Unable to open input file." << std::endl;
             return false;
         }
+        return read_stream(input_stream);
+    }
+
+    static bool mapsInputFile(const ProcessingOptions& options, const std::string& input_file)
+    {
+        return (options.input_mode == InputMode::Auto || options.input_mode == InputMode::MemoryMapped) &&
+            input_file != STDIN_FILE_NAME;
+    }
+
+    // Maps the input file. The pages are only read when they are validated, so the read
+    // stage of a mapped input holds little more than its size.
+    static bool openMappedFile(ISO8601MappedFile& mapped_file, const std::string& input_file,
+        ISO8601Metrics::Counters* metrics)
+    {
+        ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Read);
+        if (!mapped_file.open(input_file)) {
+            return false;
+        }
+        if (metrics != nullptr) {
+            metrics->add(ISO8601Metrics::Stage::Read, mapped_file.size(), 0);
+        }
+        return true;
+    }
+
+    template <typename ChunkHandler>
+    static void validateMappedChunks(const char* data, size_t size, const ProcessingOptions& options,
+        ISO8601Metrics::Counters* metrics, ChunkHandler& handler)
+    {
+        ChunkValidator validator(options, metrics);
+        size_t offset = 0;
+        while (offset < size) {
+            size_t consumed = 0;
+            handler(validator.validate(data + offset, size - offset, true, true, consumed));
+            offset += consumed;
+        }
+    }
 
-        std::string line;
-        while (std::getline(input_stream, line)) {
-            if (isDateTimeValid(line)) {
-                if (isDateTimeUnique(line, unique_datetimes))
-                {
-                    unique_datetimes.insert(line);
+    template <typename ChunkHandler, typename CaughtUpHandler>
+    static bool validateStreamedChunks(std::istream& input_stream, const ProcessingOptions& options,
+        ISO8601Metrics::Counters* metrics, ChunkHandler& handler, CaughtUpHandler& on_caught_up)
+    {
+        std::vector<char> buffer(READ_BUFFER_SIZE);
+        ChunkValidator validator(options, metrics);
+
+        // Bytes of an incomplete record carried over from the previous block.
+        size_t pending = 0;
+        bool end_of_input = false;
+        while (!end_of_input) {
+            if (pending == buffer.size()) {
+                // A single record does not fit into the buffer.
+                buffer.resize(buffer.size() * 2);
+            }
+
+            const size_t requested = buffer.size() - pending;
+            const size_t read = readBlock(input_stream, buffer.data() + pending, requested, metrics);
+            size_t size = pending + read;
+            end_of_input = !input_stream;
+            if (input_stream.bad()) {
+                std::cerr << "Error: Unable to read input file." << std::endl;
+                return false;
+            }
+
+            size_t offset = 0;
+            size_t count;
+            do {
+                size_t consumed = 0;
+                RecordChunk chunk = validator.validate(buffer.data() + offset, size - offset, end_of_input, false, consumed);
+                count = chunk.count;
+                handler(chunk);
+                offset += consumed;
+            } while (count == ISO8601_CHUNK_RECORDS);
+
+            pending = size - offset;
+            std::memmove(buffer.data(), buffer.data() + offset, pending);
+            if (!end_of_input && read < requested) {
+                on_caught_up();
+            }
+        }
+        return true;
+    }
+
+    // Reads up to size bytes of a stream into data and returns how many were read.
+    // stdin is read with a single read of its file descriptor, which returns what a pipe
+    // holds instead of waiting for size bytes, so values of a trickling input are passed
+    // on as they arrive. The end of the input and errors set the stream state either way.
+    static size_t readBlock(std::istream& input_stream, char* data, size_t size, ISO8601Metrics::Counters* metrics)
+    {
+        ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Read);
+        size_t read;
+        if (&input_stream == &std::cin) {
+#ifdef _WIN32
+            const int result = _read(0, data, static_cast<unsigned>(std::min<size_t>(size, std::numeric_limits<int>::max())));
+#else
+            ssize_t result;
+            do {
+                result = ::read(STDIN_FILENO, data, size);
+            } while (result < 0 && errno == EINTR);
+#endif
+            if (result <= 0) {
+                input_stream.setstate(result == 0 ? std::ios::eofbit | std::ios::failbit : std::ios::badbit);
+            }
+            read = result > 0 ? static_cast<size_t>(result) : 0;
+        }
+        else {
+            input_stream.read(data, static_cast<std::streamsize>(size));
+            read = static_cast<size_t>(input_stream.gcount());
+        }
+        if (metrics != nullptr) {
+            metrics->add(ISO8601Metrics::Stage::Read, read, 0);
+        }
+        return read;
+    }
+
+    // Reads, validates and deduplicates a stream in three overlapping stages:
+    // 1. A reader thread fills blocks with whole records and deals them out to the
+    //    validators in turn. Bytes of a record cut off at the end of a block are carried
+    //    over to the next one.
+    // 2. Each validator thread finds the keys and texts of the valid values of its blocks.
+    // 3. The calling thread collects the blocks in the order they were dealt out, passes
+    //    their values to on_key and on_text, and hands the blocks back to the reader.
+    // Every pair of stages is connected by a bounded single producer single consumer
+    // ring, and the blocks are recycled, so memory stays the same for unbounded input.
+    // Values reach the handlers in input order, exactly as on a single thread. A short read
+    // of stdin ends a block at its last complete line, and on_caught_up is called once the
+    // values of that block have been handled.
+    template <typename KeyHandler, typename TextHandler, typename CaughtUpHandler>
+    static bool processStreamedPipeline(std::istream& input_stream, const ProcessingOptions& options,
+        unsigned validators, KeyHandler&& on_key, TextHandler&& on_text, CaughtUpHandler& on_caught_up)
+    {
+        const size_t block_count = validators * PIPELINE_BLOCKS_PER_VALIDATOR + 2;
+        std::vector<PipelineBlock> blocks(block_count);
+        ISO8601SpscRing<size_t> free_blocks(block_count);
+        for (size_t index = 0; index < block_count; index++) {
+            blocks[index].data.resize(READ_BUFFER_SIZE);
+            free_blocks.push(index);
+        }
+        std::vector<std::unique_ptr<ISO8601SpscRing<size_t>>> to_validator;
+        std::vector<std::unique_ptr<ISO8601SpscRing<size_t>>> from_validator;
+        for (unsigned v = 0; v < validators; v++) {
+            to_validator.push_back(std::make_unique<ISO8601SpscRing<size_t>>(PIPELINE_BLOCKS_PER_VALIDATOR));
+            from_validator.push_back(std::make_unique<ISO8601SpscRing<size_t>>(PIPELINE_BLOCKS_PER_VALIDATOR));
+        }
+
+        bool read_failed = false;
+        std::thread reader([&]() {
+            ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_READER_THREAD);
+            std::vector<char> carry;
+            for (uint64_t sequence = 0;; sequence++) {
+                size_t index = 0;
+                free_blocks.pop(index);
+                PipelineBlock& block = blocks[index];
+                if (block.data.size() < carry.size()) {
+                    block.data.resize(carry.size());
                 }
+                std::memcpy(block.data.data(), carry.data(), carry.size());
+                size_t size = carry.size();
+                carry.clear();
+
+                bool end_of_input = false;
+                while (true) {
+                    if (size == block.data.size()) {
+                        // A single record does not fit into the block.
+                        block.data.resize(block.data.size() * 2);
+                    }
+                    const size_t requested = block.data.size() - size;
+                    const size_t read = readBlock(input_stream, block.data.data() + size, requested, metrics);
+                    size += read;
+                    block.caught_up = read < requested;
+                    end_of_input = !input_stream;
+                    if (end_of_input) {
+                        read_failed = input_stream.bad();
+                        break;
+                    }
+                    size_t end = size;
+                    while (end > 0 && block.data[end - 1] != '\n') {
+                        end--;
+                    }
+                    if (end > 0) {
+                        carry.assign(block.data.data() + end, block.data.data() + size);
+                        size = end;
+                        break;
+                    }
+                }
+
+                block.size = size;
+                to_validator[sequence % validators]->push(index);
+                if (end_of_input) {
+                    break;
+                }
+            }
+            for (auto& ring : to_validator) {
+                ring->close();
             }
+        });
+
+        std::vector<std::thread> workers;
+        for (unsigned v = 0; v < validators; v++) {
+            workers.emplace_back([&, v]() {
+                ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_FIRST_WORKER + v);
+                ChunkValidator validator(options, metrics);
+                size_t index = 0;
+                while (to_validator[v]->pop(index)) {
+                    PipelineBlock& block = blocks[index];
+                    block.keys.clear();
+                    block.texts.clear();
+                    for (size_t offset = 0; offset < block.size;) {
+                        size_t consumed = 0;
+                        RecordChunk chunk = validator.validate(block.data.data() + offset, block.size - offset, true, false, consumed);
+                        ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Validate);
+                        forEachValue(chunk, options, [&](uint64_t key) {
+                            block.keys.push_back(key);
+                        }, [&](std::string_view text, const iso8601_datetime& parsed) {
+                            block.keys.push_back(0);
+                            block.texts.emplace_back(text, parsed);
+                        });
+                        offset += consumed;
+                    }
+                    from_validator[v]->push(index);
+                }
+                from_validator[v]->close();
+            });
         }
 
-        input_stream.close();
+        // Blocks come back in the order they were dealt out; the first closed and empty
+        // ring means the reader has stopped.
+        ISO8601Metrics::Counters* metrics = threadMetrics(options, METRICS_CALLING_THREAD);
+        size_t index = 0;
+        for (uint64_t sequence = 0; from_validator[sequence % validators]->pop(index); sequence++) {
+            const PipelineBlock& block = blocks[index];
+            ISO8601Metrics::StageTimer timer(metrics, ISO8601Metrics::Stage::Dedup);
+            size_t text = 0;
+            for (uint64_t key : block.keys) {
+                if (key != 0) {
+                    on_key(key);
+                }
+                else {
+                    on_text(block.texts[text].first, block.texts[text].second);
+                    text++;
+                }
+            }
+            if (block.caught_up) {
+                on_caught_up();
+            }
+            free_blocks.push(index);
+        }
+
+        reader.join();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (read_failed) {
+            std::cerr << "Error: Unable to read input file." << std::endl;
+            return false;
+        }
         return true;
     }
 
-    static bool writeUniqueDateTimeValues(const std::string& output_file, const std::unordered_set<std::string>& unique_datetimes)
+    // Writes the date-time strings of a range of packed keys, one per line.
+    template <typename DateTimeKeys>
+    static void writeDateTimeValues(ISO8601BufferedWriter& writer, const DateTimeKeys& unique_datetimes,
+        OutputFormat output_format)
     {
-        std::ofstream output_stream(output_file);
-        if (!output_stream.is_open()) {
-            std::cerr << "Error: Unable to open output file." << std::endl;
-            return false;
+        for (uint64_t key : unique_datetimes) {
+            writeDateTimeValue(writer, key, output_format);
+        }
+    }
+
+    // Writes the unique values of a run on the calling thread.
+    static void writeUniqueDateTimeValues(ISO8601BufferedWriter& writer, const UniqueDateTimes& unique_datetimes,
+        const ProcessingOptions& options)
+    {
+        if (!unique_datetimes.hasKeySet()) {
+            writeUniqueDateTimeValues(writer, unique_datetimes.retained_keys, unique_datetimes.texts, options);
+        }
+        else {
+            writeUniqueDateTimeValues(writer, unique_datetimes.keys, unique_datetimes.texts, options);
+        }
+    }
+
+    template <typename DateTimeKeys>
+    static void writeUniqueDateTimeValues(ISO8601BufferedWriter& writer, const DateTimeKeys& unique_keys,
+        const std::vector<TextDateTime>& unique_texts, const ProcessingOptions& options)
+    {
+        if (options.output_order != OutputOrder::Sorted) {
+            for (uint64_t key : unique_keys) {
+                if (!isTextDateTimeKey(key)) {
+                    writeDateTimeValue(writer, key, options.output_format);
+                }
+            }
+            for (const TextDateTime& value : unique_texts) {
+                writeDateTimeValue(writer, value, options.output_format);
+            }
+            return;
         }
 
-        for (const auto& dt_str : unique_datetimes) {
-            output_stream << dt_str << std::endl;
+        std::vector<uint64_t> keys;
+        keys.reserve(unique_keys.size());
+        for (uint64_t key : unique_keys) {
+            if (!isTextDateTimeKey(key)) {
+                keys.push_back(key);
+            }
         }
+        iso8601RadixSortKeys(keys);
+
+        std::vector<const TextDateTime*> texts;
+        texts.reserve(unique_texts.size());
+        for (const TextDateTime& value : unique_texts) {
+            texts.push_back(&value);
+        }
+        std::sort(texts.begin(), texts.end(), [](const TextDateTime* a, const TextDateTime* b) {
+            if (a->seconds != b->seconds) {
+                return a->seconds < b->seconds;
+            }
+            if (a->fraction != b->fraction) {
+                return a->fraction < b->fraction;
+            }
+            return a->text < b->text;
+        });
 
-        output_stream.close();
+        // Merge by instant; at the same instant the key, which has no fraction, comes first.
+        size_t k = 0;
+        for (const TextDateTime* value : texts) {
+            for (; k < keys.size() && ISO8601_KEY_UNIX_SECONDS(keys[k]) <= value->seconds; k++) {
+                writeDateTimeValue(writer, keys[k], options.output_format);
+            }
+            writeDateTimeValue(writer, *value, options.output_format);
+        }
+        for (; k < keys.size(); k++) {
+            writeDateTimeValue(writer, keys[k], options.output_format);
+        }
+    }
+
+    static bool openOutputFile(ISO8601BufferedWriter& writer, const std::string& output_file)
+    {
+        if (!writer.open(output_file)) {
+            std::cerr << "Error: Unable to open output file." << std::endl;
+            return false;
+        }
         return true;
     }
 
-    static bool isDateTimeUnique(const std::string& line, const std::unordered_set<std::string>& unique_datetimes)
+    static bool closeOutputFile(ISO8601BufferedWriter& writer)
     {
-        return unique_datetimes.find(line) == unique_datetimes.end();
+        if (!writer.close()) {
+            std::cerr << "Error: Unable to write output file." << std::endl;
+            return false;
+        }
+        return true;
     }
 
-    // This function is useful for extracting datetime patterns from a file containing a mixture of text messages 
-    // and datetime strings.
-    // Parameters:
-    // - line: A string representing a message read from the file.
-    // Returns:
-    // - A string containing the datetime pattern if a match is found; otherwise, an empty string.
-    static std::string getDateTimeRegexPattern(const std::string& line)
+    // Formats a key straight into the output buffer, followed by a newline.
+    static void writeDateTimeValue(ISO8601BufferedWriter& writer, uint64_t key, OutputFormat output_format)
     {
-        std::regex pattern("\\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}(Z|\\+\\d{2}:\\d{2}|\\-\\d{2}:\\d{2})");
-        
-        std::smatch match;
+        char* line = writer.reserve(std::max(MAX_DATETIME_LENGTH, MAX_UTC_DATETIME_LENGTH) + 1);
+        size_t length = output_format == OutputFormat::CanonicalUtc
+            ? iso8601_format_utc(ISO8601_KEY_UNIX_SECONDS(key), line)
+            : iso8601_format_datetime_key(key, line);
+        line[length] = '\n';
+        writer.commit(length + 1);
+    }
+    // Writes a text value followed by a newline. Normalized to UTC, a fraction is kept
+    // without its trailing zeros: YYYY-MM-DDThh:mm:ss.fffZ.
+    static void writeDateTimeValue(ISO8601BufferedWriter& writer, const TextDateTime& value, OutputFormat output_format)
+    {
+        if (output_format != OutputFormat::CanonicalUtc) {
+            writer.write(value.text);
+            writer.write("\n");
+            return;
+        }
 
-        if (std::regex_search(line, match, pattern))
-        {
-            if (!match.empty())
-            {
-                return match[0]; 
+        char* line = writer.reserve(MAX_UTC_DATETIME_LENGTH + 1 + ISO8601_MAX_FRACTION_DIGITS + 1);
+        size_t length = iso8601_format_utc(value.seconds, line) - 1; // Without the Z.
+        if (value.fraction != 0) {
+            char digits[ISO8601_MAX_FRACTION_DIGITS];
+            uint32_t fraction = value.fraction;
+            for (int i = ISO8601_MAX_FRACTION_DIGITS - 1; i >= 0; i--) {
+                digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            size_t digit_count = ISO8601_MAX_FRACTION_DIGITS;
+            while (digits[digit_count - 1] == '0') {
+                digit_count--;
             }
+            line[length++] = '.';
+            std::memcpy(line + length, digits, digit_count);
+            length += digit_count;
         }
-        return "";
+        line[length++] = 'Z';
+        line[length++] = '\n';
+        writer.commit(length);
     }
 };
-
@@ -1,13 +1,9 @@
 #include <string>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include "ISO8601DateTimeProcessor.h"
 
-/* TODO:
-1. Update the C library to support reading a chunk of records from a file.
-   Currently, the datetime format validation reads one record at a time.
-2. Concurrency is optional and may not be necessary for this task.
-3. Implement batch processing with a buffer size of 1024 records.
-*/
 std::string generateOutputFileName() 
 {
     /*  generated_mixed_iso8601_datetime_10000.txt
@@ -49,22 +45,267 @@ std::string generateOutputFileName()
     return output_file;
 }
 
-int main() 
+struct CommandLine
 {
+    // Generate with: ISO8601DateTimeBenchmark --generate test/generated_iso8601_datetime_1000000.txt --invalid 0 --duplicates 0
     std::string input_file = "test//generated_iso8601_datetime_1000000.txt";
-    std::string output_file = generateOutputFileName();
+    std::string output_file;
+    ISO8601DateTimeProcessor::ProcessingOptions options;
+    // Where the run metrics go, - for the report; empty to not collect them.
+    std::string metrics_file;
+    bool prometheus_metrics = false;
+};
+
+void printUsage()
+{
+    std::cerr << "Usage: ISO8601DateTimeValidator [options] [INPUT [OUTPUT]]\n"
+        "  INPUT, --input FILE    records to read, - for stdin (default test//generated_iso8601_datetime_1000000.txt)\n"
+        "  OUTPUT, --output FILE  unique values to write, - for stdout (default log//unique_datetimes_output_<date>_<time>.txt)\n"
+        "  --threads N            worker threads, 0 for every hardware thread (default 1)\n"
+        "  --streamed             read the input in blocks instead of memory mapping it\n"
+        "  --async-read           read the input in blocks with several reads in flight (io_uring on Linux)\n"
+        "  --dedup MODE           exact or instant (default exact)\n"
+        "  --format FORMAT        original or utc (default original)\n"
+        "  --order ORDER          unordered, sorted or first (default unordered)\n"
+        "  --layout LAYOUT        lines or text (default lines)\n"
+        "  --formats FORMATS      extended or all (default extended)\n"
+        "  --approximate          deduplicate with a Bloom filter of fixed size\n"
+        "  --capacity N           distinct values the Bloom filter is sized for (default 4194304)\n"
+        "  --false-positive R     rate of new values taken for duplicates within the capacity (default 0.001)\n"
+        "  --window SECONDS       only deduplicate values this close to the latest instant seen\n"
+        "  --index FILE           only process input added since the last run with FILE, appending to OUTPUT\n"
+        "  --metrics FILE         write rejection reasons, duplicates and stage timings to FILE, - for the report\n"
+        "  --metrics-format FMT   json or prometheus (default json)\n"
+        "Values are written to stdout as they are first seen with: - - --order first\n"
+        "INPUT may be a directory or a quoted wildcard such as 'logs/*.txt': its files are processed\n"
+        "together on the worker threads and deduplicated as one input\n";
+}
+
+bool parseArguments(int argc, char** argv, CommandLine& command_line)
+{
+    using Processor = ISO8601DateTimeProcessor;
+    Processor::ProcessingOptions& options = command_line.options;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        auto value = [&]() { return std::string(argv[++i]); };
+
+        if (argument == "--streamed") {
+            options.input_mode = Processor::InputMode::Streamed;
+        }
+        else if (argument == "--async-read") {
+            options.input_mode = Processor::InputMode::AsyncRead;
+        }
+        else if (argument == "--approximate") {
+            options.approximate_dedup = true;
+        }
+        else if (argument.size() < 2 || argument.compare(0, 2, "--") != 0) {
+            // A lone - is stdin or stdout.
+            if (positional == 0) {
+                command_line.input_file = argument;
+            }
+            else if (positional == 1) {
+                command_line.output_file = argument;
+            }
+            else {
+                return false;
+            }
+            positional++;
+        }
+        else if (!has_value) {
+            return false;
+        }
+        else if (argument == "--input") {
+            command_line.input_file = value();
+        }
+        else if (argument == "--output") {
+            command_line.output_file = value();
+        }
+        else if (argument == "--threads") {
+            options.threads = static_cast<unsigned>(std::strtoul(value().c_str(), nullptr, 10));
+        }
+        else if (argument == "--capacity") {
+            options.approximate_capacity = std::strtoull(value().c_str(), nullptr, 10);
+        }
+        else if (argument == "--false-positive") {
+            options.false_positive_rate = std::strtod(value().c_str(), nullptr);
+        }
+        else if (argument == "--window") {
+            options.dedup_window_seconds = std::strtoll(value().c_str(), nullptr, 10);
+        }
+        else if (argument == "--index") {
+            options.index_file = value();
+        }
+        else if (argument == "--metrics") {
+            command_line.metrics_file = value();
+        }
+        else if (argument == "--metrics-format") {
+            std::string format = value();
+            if (format == "json") {
+                command_line.prometheus_metrics = false;
+            }
+            else if (format == "prometheus") {
+                command_line.prometheus_metrics = true;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (argument == "--dedup") {
+            std::string mode = value();
+            if (mode == "exact") {
+                options.dedup_mode = Processor::DedupMode::Exact;
+            }
+            else if (mode == "instant") {
+                options.dedup_mode = Processor::DedupMode::Instant;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (argument == "--format") {
+            std::string format = value();
+            if (format == "original") {
+                options.output_format = Processor::OutputFormat::Original;
+            }
+            else if (format == "utc") {
+                options.output_format = Processor::OutputFormat::CanonicalUtc;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (argument == "--order") {
+            std::string order = value();
+            if (order == "unordered") {
+                options.output_order = Processor::OutputOrder::Unordered;
+            }
+            else if (order == "sorted") {
+                options.output_order = Processor::OutputOrder::Sorted;
+            }
+            else if (order == "first") {
+                options.output_order = Processor::OutputOrder::FirstOccurrence;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (argument == "--layout") {
+            std::string layout = value();
+            if (layout == "lines") {
+                options.record_layout = Processor::RecordLayout::OnePerLine;
+            }
+            else if (layout == "text") {
+                options.record_layout = Processor::RecordLayout::FreeText;
+            }
+            else {
+                return false;
+            }
+        }
+        else if (argument == "--formats") {
+            std::string formats = value();
+            if (formats == "extended") {
+                options.accepted_formats = ISO8601_ACCEPT_EXTENDED;
+            }
+            else if (formats == "all") {
+                options.accepted_formats = ISO8601_ACCEPT_ALL_DATETIMES;
+            }
+            else {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeMetrics(const CommandLine& command_line, const ISO8601Metrics& metrics, std::ostream& report)
+{
+    std::ofstream metrics_stream;
+    std::ostream* output = &report;
+    if (command_line.metrics_file != "-") {
+        metrics_stream.open(command_line.metrics_file, std::ios::binary | std::ios::trunc);
+        output = &metrics_stream;
+    }
+    if (command_line.prometheus_metrics) {
+        metrics.writePrometheus(*output);
+    }
+    else {
+        metrics.writeJson(*output);
+    }
+    output->flush();
+    if (!*output) {
+        std::cerr << "Error: Unable to write metrics file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    CommandLine command_line;
+    if (!parseArguments(argc, argv, command_line)) {
+        printUsage();
+        return 1;
+    }
+    if (command_line.output_file.empty()) {
+        command_line.output_file = generateOutputFileName();
+    }
+
+    // With the values on stdout, everything else goes to stderr.
+    std::ostream& report = command_line.output_file == ISO8601DateTimeProcessor::STDOUT_FILE_NAME ? std::cerr : std::cout;
+
+    ISO8601Metrics metrics;
+    if (!command_line.metrics_file.empty()) {
+        command_line.options.metrics = &metrics;
+    }
 
     auto startTime = std::chrono::steady_clock::now();
 
-    if (!ISO8601DateTimeProcessor::processDateTime(input_file, output_file)) {
+    ISO8601DateTimeProcessor::ProcessingSummary summary;
+    if (ISO8601DateTimeProcessor::isInputPattern(command_line.input_file)) {
+        std::vector<std::string> input_files;
+        std::vector<ISO8601DateTimeProcessor::InputSummary> input_summaries;
+        if (!ISO8601DateTimeProcessor::findInputFiles(command_line.input_file, input_files) ||
+            !ISO8601DateTimeProcessor::processDateTimeFiles(input_files, command_line.output_file, command_line.options,
+                summary, input_summaries)) {
+            std::cerr << "Error processing date-time values." << std::endl;
+            return 1;
+        }
+        for (const auto& input : input_summaries) {
+            report << input.input_file << ": records: " << input.records << ", valid: " << input.valid_values
+                << ", unique: " << input.unique_values << ", bytes: " << input.bytes << std::endl;
+        }
+        report << "Files: " << input_summaries.size() << ", unique values written: " << summary.unique_values << std::endl;
+    }
+    else if (!ISO8601DateTimeProcessor::processDateTime(command_line.input_file, command_line.output_file, command_line.options, summary)) {
         std::cerr << "Error processing date-time values." << std::endl;
         return 1;
     }
+    if (command_line.options.approximate_dedup) {
+        report << "Unique values written: " << summary.unique_values
+            << ", estimated distinct values: " << summary.estimated_distinct << std::endl;
+    }
+    if (!command_line.options.index_file.empty()) {
+        report << "Unique values appended: " << summary.unique_values
+            << ", input bytes skipped: " << summary.skipped_bytes << std::endl;
+    }
+    if (command_line.options.dedup_window_seconds > 0) {
+        report << "Unique values written: " << summary.unique_values
+            << ", values older than the window: " << summary.late_values << std::endl;
+    }
 
     auto endTime = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
 
-    std::cout << "Execution Time (ms): " << duration.count() << std::endl;
+    report << "Execution Time (ms): " << duration.count() << std::endl;
+
+    if (!command_line.metrics_file.empty() && !writeMetrics(command_line, metrics, report)) {
+        return 1;
+    }
 
     return 0;
 }
@@ -0,0 +1,273 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "ISO8601MappedFile.h"
+
+// Dedup state kept between incremental runs: the sorted packed keys (see
+// iso8601_datetime_key) of every unique value written so far, and for every input the
+// number of bytes already consumed, and the length of the output they were written to.
+// The file is memory mapped rather than loaded, so a run only touches the pages of the
+// keys it looks up. Layout, in the byte order of the machine that wrote it:
+//   header    magic, version, ignored low bits, key count, input count (32 bytes)
+//   keys      key count uint64_t, ascending
+//   inputs    consumed bytes, fingerprint, name length (uint32_t) and name, per input
+//   output    bytes, name length (uint32_t) and name; from version 2 on
+class ISO8601DedupIndex
+{
+public:
+    // An input file and how far earlier runs have read it.
+    struct Input
+    {
+        std::string name;
+        uint64_t consumed_bytes = 0;
+        // Hash of the last bytes consumed, to notice an input that was replaced or rewritten.
+        uint64_t fingerprint = 0;
+    };
+
+    // The output the keys have been written to, and its length when the index was saved.
+    // Anything past that length was written by a run that did not get to save the index.
+    struct Output
+    {
+        std::string name; // Empty if unknown, such as for stdout.
+        uint64_t bytes = 0;
+    };
+
+    ISO8601DedupIndex() = default;
+    ISO8601DedupIndex(const ISO8601DedupIndex&) = delete;
+    ISO8601DedupIndex& operator=(const ISO8601DedupIndex&) = delete;
+
+    // Maps an index file. A file that does not exist yet is an empty index for keys that
+    // ignore ignored_low_bits; otherwise the bits the file was written with are kept.
+    // Fails for a file that is not an index.
+    bool open(const std::string& file_name, unsigned ignored_low_bits)
+    {
+        file_.close();
+        keys_ = nullptr;
+        size_ = 0;
+        inputs_.clear();
+        output_ = Output();
+        ignored_low_bits_ = ignored_low_bits;
+
+        std::error_code error;
+        if (!std::filesystem::exists(file_name, error)) {
+            return !error;
+        }
+        if (!file_.open(file_name) || file_.size() < sizeof(Header)) {
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, file_.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || (header.version != VERSION && header.version != 1) ||
+            header.ignored_low_bits >= 64 || header.key_count > (file_.size() - sizeof(Header)) / sizeof(uint64_t)) {
+            return false;
+        }
+        ignored_low_bits_ = header.ignored_low_bits;
+        keys_ = reinterpret_cast<const uint64_t*>(file_.data() + sizeof(Header));
+        size_ = static_cast<size_t>(header.key_count);
+
+        size_t offset = sizeof(Header) + size_ * sizeof(uint64_t);
+        for (uint64_t i = 0; i < header.input_count; i++) {
+            Input input;
+            uint32_t name_length;
+            if (file_.size() - offset < INPUT_FIXED_SIZE) {
+                return false;
+            }
+            std::memcpy(&input.consumed_bytes, file_.data() + offset, sizeof(uint64_t));
+            std::memcpy(&input.fingerprint, file_.data() + offset + 8, sizeof(uint64_t));
+            std::memcpy(&name_length, file_.data() + offset + 16, sizeof(uint32_t));
+            offset += INPUT_FIXED_SIZE;
+            if (file_.size() - offset < name_length) {
+                return false;
+            }
+            input.name.assign(file_.data() + offset, name_length);
+            offset += name_length;
+            inputs_.push_back(std::move(input));
+        }
+        if (header.version >= 2) {
+            uint32_t name_length;
+            if (file_.size() - offset < OUTPUT_FIXED_SIZE) {
+                return false;
+            }
+            std::memcpy(&output_.bytes, file_.data() + offset, sizeof(uint64_t));
+            std::memcpy(&name_length, file_.data() + offset + 8, sizeof(uint32_t));
+            offset += OUTPUT_FIXED_SIZE;
+            if (file_.size() - offset < name_length) {
+                return false;
+            }
+            output_.name.assign(file_.data() + offset, name_length);
+        }
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    unsigned ignoredLowBits() const { return ignored_low_bits_; }
+    const std::vector<Input>& inputs() const { return inputs_; }
+    const Output& output() const { return output_; }
+
+    // Where to continue reading an input: the bytes earlier runs consumed, or 0 for an
+    // input the index does not know, one that got shorter, or one whose consumed bytes
+    // no longer end the same way, which is taken for a new file under the old name.
+    uint64_t resumeOffset(const std::string& name, std::string_view input) const
+    {
+        for (const Input& known : inputs_) {
+            if (known.name == name) {
+                if (known.consumed_bytes <= input.size() &&
+                    fingerprint(input.substr(0, static_cast<size_t>(known.consumed_bytes))) == known.fingerprint) {
+                    return known.consumed_bytes;
+                }
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    // Splits ascending keys, distinct once the ignored low bits are dropped, into the ones
+    // equal to a key of the index and the new ones. Every key is looked for with a
+    // galloping search from where the previous one stopped, so a few new keys cost a few
+    // binary searches over the mapped keys, and many cost one pass over them.
+    void partition(const std::vector<uint64_t>& sorted_keys, std::vector<uint64_t>& known_keys,
+        std::vector<uint64_t>& new_keys) const
+    {
+        size_t position = 0;
+        for (uint64_t key : sorted_keys) {
+            const uint64_t target = key >> ignored_low_bits_;
+            size_t high = position;
+            for (size_t step = 1; high < size_ && (keys_[high] >> ignored_low_bits_) < target; step *= 2) {
+                position = high + 1;
+                high += step;
+            }
+            position = static_cast<size_t>(std::lower_bound(keys_ + position, keys_ + std::min(high, size_), target,
+                [&](uint64_t stored, uint64_t value) { return (stored >> ignored_low_bits_) < value; }) - keys_);
+            if (position < size_ && (keys_[position] >> ignored_low_bits_) == target) {
+                known_keys.push_back(key);
+            }
+            else {
+                new_keys.push_back(key);
+            }
+        }
+    }
+
+    // Replaces the index file with one that also holds new_keys, ascending and none of them
+    // in the index, and records input and output. The new file is written next to the old
+    // one and renamed over it, so an interrupted save leaves the previous index intact.
+    // The index is closed afterwards.
+    bool save(const std::string& file_name, const std::vector<uint64_t>& new_keys, const Input& input,
+        const Output& output)
+    {
+        std::vector<const Input*> inputs;
+        for (const Input& known : inputs_) {
+            if (known.name != input.name) {
+                inputs.push_back(&known);
+            }
+        }
+        inputs.push_back(&input);
+
+        const std::string temporary_file = file_name + ".tmp";
+        {
+            std::ofstream index_stream(temporary_file, std::ios::binary | std::ios::trunc);
+            if (!index_stream.is_open()) {
+                return false;
+            }
+
+            Header header;
+            std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+            header.version = VERSION;
+            header.ignored_low_bits = ignored_low_bits_;
+            header.key_count = size_ + new_keys.size();
+            header.input_count = inputs.size();
+            index_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            // Merge the two ascending runs, a block at a time.
+            std::vector<uint64_t> block;
+            block.reserve(WRITE_BLOCK_KEYS);
+            size_t k = 0;
+            size_t n = 0;
+            while (k < size_ || n < new_keys.size()) {
+                if (n == new_keys.size() || (k < size_ && keys_[k] < new_keys[n])) {
+                    block.push_back(keys_[k++]);
+                }
+                else {
+                    block.push_back(new_keys[n++]);
+                }
+                if (block.size() == WRITE_BLOCK_KEYS) {
+                    index_stream.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(uint64_t)));
+                    block.clear();
+                }
+            }
+            index_stream.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(uint64_t)));
+
+            for (const Input* known : inputs) {
+                const uint32_t name_length = static_cast<uint32_t>(known->name.size());
+                index_stream.write(reinterpret_cast<const char*>(&known->consumed_bytes), sizeof(uint64_t));
+                index_stream.write(reinterpret_cast<const char*>(&known->fingerprint), sizeof(uint64_t));
+                index_stream.write(reinterpret_cast<const char*>(&name_length), sizeof(uint32_t));
+                index_stream.write(known->name.data(), static_cast<std::streamsize>(name_length));
+            }
+            const uint32_t output_name_length = static_cast<uint32_t>(output.name.size());
+            index_stream.write(reinterpret_cast<const char*>(&output.bytes), sizeof(uint64_t));
+            index_stream.write(reinterpret_cast<const char*>(&output_name_length), sizeof(uint32_t));
+            index_stream.write(output.name.data(), static_cast<std::streamsize>(output_name_length));
+            index_stream.close();
+            if (!index_stream) {
+                return false;
+            }
+        }
+
+        // A mapped file cannot be replaced on Windows.
+        file_.close();
+        keys_ = nullptr;
+        size_ = 0;
+        inputs_.clear();
+        output_ = Output();
+        std::error_code error;
+        std::filesystem::rename(temporary_file, file_name, error);
+        return !error;
+    }
+
+    // FNV-1a hash of the last FINGERPRINT_BYTES bytes of consumed.
+    static uint64_t fingerprint(std::string_view consumed)
+    {
+        if (consumed.size() > FINGERPRINT_BYTES) {
+            consumed.remove_prefix(consumed.size() - FINGERPRINT_BYTES);
+        }
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (char c : consumed) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+private:
+    static constexpr char MAGIC[8] = { 'I', 'S', 'O', '8', '6', '0', '1', 'X' };
+    // Version 1 files, without the output, are still read.
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t INPUT_FIXED_SIZE = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    static constexpr size_t OUTPUT_FIXED_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    static constexpr size_t FINGERPRINT_BYTES = 4096;
+    static constexpr size_t WRITE_BLOCK_KEYS = 1 << 16;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t ignored_low_bits;
+        uint64_t key_count;
+        uint64_t input_count;
+    };
+    static_assert(sizeof(Header) == 32, "The keys must start 8 byte aligned");
+
+    ISO8601MappedFile file_;
+    const uint64_t* keys_ = nullptr;
+    size_t size_ = 0;
+    unsigned ignored_low_bits_ = 0;
+    std::vector<Input> inputs_;
+    Output output_;
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Open addressing hash set of packed date-time keys (see iso8601_datetime_key).
+// Keys are stored inline in a power of two table with linear probing; 0 marks an
+// empty slot, which is never a valid key. Compared to std::unordered_set<std::string>
+// there is no node allocation per value and each key is hashed exactly once.
+//
+// The set can be told to ignore the low bits of its keys: keys that only differ in
+// those bits are considered equal and the first one inserted is kept. With
+// ISO8601_KEY_INSTANT_SHIFT this deduplicates by UTC instant while still remembering
+// the original notation of each instant.
+class ISO8601KeySet
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint64_t*;
+        using reference = const uint64_t&;
+
+        const_iterator(const uint64_t* slot, const uint64_t* end) : slot_(slot), end_(end) { skipEmpty(); }
+
+        reference operator*() const { return *slot_; }
+        const_iterator& operator++() { ++slot_; skipEmpty(); return *this; }
+        bool operator==(const const_iterator& other) const { return slot_ == other.slot_; }
+        bool operator!=(const const_iterator& other) const { return slot_ != other.slot_; }
+
+    private:
+        void skipEmpty()
+        {
+            while (slot_ != end_ && *slot_ == 0) {
+                ++slot_;
+            }
+        }
+
+        const uint64_t* slot_;
+        const uint64_t* end_;
+    };
+
+    explicit ISO8601KeySet(unsigned ignored_low_bits = 0)
+        : slots_(MIN_CAPACITY, 0), shift_(64 - MIN_CAPACITY_BITS), ignored_low_bits_(ignored_low_bits) {}
+
+    // Adds key to the set. Returns false if an equal key was already present.
+    bool insert(uint64_t key)
+    {
+        if ((size_ + 1) * 4 > slots_.size() * 3) {
+            grow();
+        }
+
+        size_t mask = slots_.size() - 1;
+        for (size_t slot = indexOf(key);; slot = (slot + 1) & mask) {
+            if (equal(slots_[slot], key)) {
+                return false;
+            }
+            if (slots_[slot] == 0) {
+                slots_[slot] = key;
+                size_++;
+                return true;
+            }
+        }
+    }
+
+    bool contains(uint64_t key) const
+    {
+        size_t mask = slots_.size() - 1;
+        for (size_t slot = indexOf(key);; slot = (slot + 1) & mask) {
+            if (equal(slots_[slot], key)) {
+                return true;
+            }
+            if (slots_[slot] == 0) {
+                return false;
+            }
+        }
+    }
+
+    // Makes room for count keys without rehashing.
+    void reserve(size_t count)
+    {
+        while (count * 4 > slots_.size() * 3) {
+            grow();
+        }
+    }
+
+    // Removes every key. The table keeps room for as many keys as it held, so refilling
+    // the set to the same size does not grow it again, but a table more than
+    // SHRINK_FACTOR times that size, left over from a burst, is given back.
+    void clear()
+    {
+        size_t capacity = MIN_CAPACITY;
+        unsigned shift = 64 - MIN_CAPACITY_BITS;
+        while (size_ * 4 > capacity * 3) {
+            capacity *= 2;
+            shift--;
+        }
+        if (slots_.size() > capacity * SHRINK_FACTOR) {
+            std::vector<uint64_t>(capacity, 0).swap(slots_);
+            shift_ = shift;
+        }
+        else {
+            std::fill(slots_.begin(), slots_.end(), 0);
+        }
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t memoryUsage() const { return slots_.size() * sizeof(uint64_t); }
+
+    const_iterator begin() const { return const_iterator(slots_.data(), slots_.data() + slots_.size()); }
+    const_iterator end() const { return const_iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size()); }
+
+private:
+    static constexpr unsigned MIN_CAPACITY_BITS = 10;
+    static constexpr size_t MIN_CAPACITY = size_t(1) << MIN_CAPACITY_BITS;
+    static constexpr size_t SHRINK_FACTOR = 4;
+
+    // Fibonacci hashing: the top bits of the product depend on every bit of the key.
+    size_t indexOf(uint64_t key) const
+    {
+        return static_cast<size_t>(((key >> ignored_low_bits_) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    // Empty slots never compare equal, since a key is never 0.
+    bool equal(uint64_t stored, uint64_t key) const
+    {
+        return stored != 0 && (stored >> ignored_low_bits_) == (key >> ignored_low_bits_);
+    }
+
+    void grow()
+    {
+        std::vector<uint64_t> old_slots(slots_.size() * 2, 0);
+        old_slots.swap(slots_);
+        shift_--;
+
+        size_t mask = slots_.size() - 1;
+        for (uint64_t key : old_slots) {
+            if (key != 0) {
+                size_t slot = indexOf(key);
+                while (slots_[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                slots_[slot] = key;
+            }
+        }
+    }
+
+    std::vector<uint64_t> slots_;
+    size_t size_ = 0;
+    unsigned shift_;
+    unsigned ignored_low_bits_;
+};
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a regular file.
+// Records validated from the mapping can be kept as std::string_view for as long as
+// the ISO8601MappedFile is alive, so no record has to be copied.
+class ISO8601MappedFile
+{
+public:
+    ISO8601MappedFile() = default;
+    ISO8601MappedFile(const ISO8601MappedFile&) = delete;
+    ISO8601MappedFile& operator=(const ISO8601MappedFile&) = delete;
+
+    ~ISO8601MappedFile()
+    {
+        close();
+    }
+
+    // Maps the whole file. Fails for anything that is not a regular file
+    // (pipes, terminals, character devices), which have to be streamed instead.
+    bool open(const std::string& file_name)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size)) {
+            CloseHandle(file);
+            return false;
+        }
+
+        if (file_size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+            if (data_ == nullptr) {
+                CloseHandle(file);
+                return false;
+            }
+        }
+        CloseHandle(file);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat file_status;
+        if (fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+
+        if (file_status.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            // The file is read once from start to end.
+            madvise(mapping, static_cast<size_t>(file_status.st_size), MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(mapping);
+        }
+        ::close(fd);
+        size_ = static_cast<size_t>(file_status.st_size);
+#endif
+        is_open_ = true;
+        return true;
+    }
+
+    void close()
+    {
+        if (data_ != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+        is_open_ = false;
+    }
+
+    bool is_open() const { return is_open_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+};
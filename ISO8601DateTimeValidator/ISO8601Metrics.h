@@ -0,0 +1,304 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../ISO8601DateTimeValidatorLib/isodatetime_validator.h"
+
+// Define ISO8601_DISABLE_METRICS to compile the metrics out: no counter is touched and
+// no clock is read during processing, whatever the options ask for.
+#ifdef ISO8601_DISABLE_METRICS
+inline constexpr bool ISO8601_METRICS_ENABLED = false;
+#else
+inline constexpr bool ISO8601_METRICS_ENABLED = true;
+#endif
+
+// Counters and stage timings of a run, one set per thread so the hot loops never share
+// a cache line or an atomic. They are added up and exported, as JSON or as Prometheus
+// text, once the run is over.
+class ISO8601Metrics
+{
+public:
+    // Why a record is not a valid date-time. LeapDay is a 29th of February, or a 366th
+    // day, in a common year; every other day out of range is Day.
+    enum class Reason
+    {
+        Length, Digit, Separator, Designator, Month, Day, LeapDay, Hour, Minute, Second,
+        Offset, Fraction, Format, Week, Weekday, Count
+    };
+
+    enum class Stage
+    {
+        Read,     // Reading or mapping the input.
+        Validate, // Validating records and extracting the keys of the valid values.
+        Dedup,    // Deduplicating the valid values, and writing them when written as found.
+        Write,    // Ordering and writing the unique values, and flushing the output.
+        Count
+    };
+
+    static constexpr size_t REASONS = static_cast<size_t>(Reason::Count);
+    static constexpr size_t STAGES = static_cast<size_t>(Stage::Count);
+
+    // Counters of one thread, on cache lines of their own.
+    struct alignas(64) Counters
+    {
+        std::array<uint64_t, REASONS> rejected{};
+        uint64_t duplicates = 0;
+        // Bytes read, validated or written; records validated, values deduplicated or written.
+        std::array<uint64_t, STAGES> bytes{};
+        std::array<uint64_t, STAGES> records{};
+        std::array<uint64_t, STAGES> nanoseconds{};
+
+        void add(Stage stage, uint64_t stage_bytes, uint64_t stage_records)
+        {
+            bytes[index(stage)] += stage_bytes;
+            records[index(stage)] += stage_records;
+        }
+
+        // Counts a record that parsed with an error.
+        void reject(std::string_view record, const iso8601_datetime& parsed)
+        {
+            rejected[index(reasonOf(record, parsed))]++;
+        }
+
+        // Counts a value passed to the dedup set, and whether it was a duplicate.
+        void deduplicated(bool unique)
+        {
+            records[index(Stage::Dedup)]++;
+            duplicates += !unique;
+        }
+
+        void merge(const Counters& other)
+        {
+            for (size_t i = 0; i < REASONS; i++) {
+                rejected[i] += other.rejected[i];
+            }
+            duplicates += other.duplicates;
+            for (size_t i = 0; i < STAGES; i++) {
+                bytes[i] += other.bytes[i];
+                records[i] += other.records[i];
+                nanoseconds[i] += other.nanoseconds[i];
+            }
+        }
+
+        bool empty() const
+        {
+            Counters none;
+            return rejected == none.rejected && duplicates == 0 && bytes == none.bytes &&
+                records == none.records && nanoseconds == none.nanoseconds;
+        }
+    };
+
+    // Adds the time from its construction to its destruction to a stage. Reads no clock
+    // without counters.
+    class StageTimer
+    {
+    public:
+        StageTimer(Counters* counters, Stage stage) : counters_(counters), stage_(stage)
+        {
+            if (counters_ != nullptr) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+        ~StageTimer()
+        {
+            if (counters_ != nullptr) {
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                counters_->nanoseconds[index(stage_)] +=
+                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+        }
+
+    private:
+        Counters* counters_;
+        Stage stage_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Discards the counters of an earlier run and makes room for threads threads.
+    // Must be called before the threads start.
+    void prepare(size_t threads)
+    {
+        threads_.assign(threads, Counters());
+    }
+
+    Counters& thread(size_t index) { return threads_[index]; }
+    const Counters& thread(size_t index) const { return threads_[index]; }
+    size_t threadCount() const { return threads_.size(); }
+
+    Counters total() const
+    {
+        Counters total;
+        for (const Counters& counters : threads_) {
+            total.merge(counters);
+        }
+        return total;
+    }
+
+    static const char* reasonName(Reason reason)
+    {
+        static const char* const names[REASONS] = {
+            "length", "digit", "separator", "designator", "month", "day", "leap_day", "hour", "minute", "second",
+            "offset", "fraction", "format", "week", "weekday"
+        };
+        return names[index(reason)];
+    }
+
+    static const char* stageName(Stage stage)
+    {
+        static const char* const names[STAGES] = { "read", "validate", "dedup", "write" };
+        return names[index(stage)];
+    }
+
+    static Reason reasonOf(std::string_view record, const iso8601_datetime& parsed)
+    {
+        switch (parsed.error)
+        {
+        case ISO8601_ERROR_LENGTH:
+            return Reason::Length;
+        case ISO8601_ERROR_DIGIT:
+            return Reason::Digit;
+        case ISO8601_ERROR_SEPARATOR:
+            return Reason::Separator;
+        case ISO8601_ERROR_DESIGNATOR:
+            return Reason::Designator;
+        case ISO8601_ERROR_MONTH:
+            return Reason::Month;
+        case ISO8601_ERROR_DAY:
+            return isLeapDay(record, parsed.error_position) ? Reason::LeapDay : Reason::Day;
+        case ISO8601_ERROR_HOUR:
+            return Reason::Hour;
+        case ISO8601_ERROR_MINUTE:
+            return Reason::Minute;
+        case ISO8601_ERROR_SECOND:
+            return Reason::Second;
+        case ISO8601_ERROR_OFFSET_HOUR:
+        case ISO8601_ERROR_OFFSET_MINUTE:
+            return Reason::Offset;
+        case ISO8601_ERROR_FRACTION:
+            return Reason::Fraction;
+        case ISO8601_ERROR_WEEK:
+            return Reason::Week;
+        case ISO8601_ERROR_WEEKDAY:
+            return Reason::Weekday;
+        default:
+            return Reason::Format;
+        }
+    }
+
+    // {"threads":[{"thread":0,...}],"total":{...}}, leaving out threads that did nothing.
+    void writeJson(std::ostream& output) const
+    {
+        output << "{\"threads\":[";
+        bool first = true;
+        for (size_t t = 0; t < threads_.size(); t++) {
+            if (threads_[t].empty()) {
+                continue;
+            }
+            output << (first ? "" : ",") << "{\"thread\":" << t << ',';
+            writeJsonCounters(output, threads_[t]);
+            output << '}';
+            first = false;
+        }
+        output << "],\"total\":{";
+        writeJsonCounters(output, total());
+        output << "}}\n";
+    }
+
+    // Prometheus text exposition format, one series per thread, leaving out threads that
+    // did nothing. Times are in seconds, as Prometheus expects, with nanosecond digits.
+    void writePrometheus(std::ostream& output) const
+    {
+        writePrometheusHeader(output, "iso8601_rejected_records_total", "Records that are not a valid date-time, by reason.");
+        forEachActiveThread([&](size_t t, const Counters& counters) {
+            for (size_t r = 0; r < REASONS; r++) {
+                output << "iso8601_rejected_records_total{thread=\"" << t << "\",reason=\""
+                    << reasonName(static_cast<Reason>(r)) << "\"} " << counters.rejected[r] << '\n';
+            }
+        });
+        writePrometheusHeader(output, "iso8601_duplicate_values_total", "Valid values dropped as duplicates.");
+        forEachActiveThread([&](size_t t, const Counters& counters) {
+            output << "iso8601_duplicate_values_total{thread=\"" << t << "\"} " << counters.duplicates << '\n';
+        });
+        writePrometheusStages(output, "iso8601_stage_bytes_total", "Bytes read, validated or written.",
+            [](const Counters& counters, size_t s) { return std::to_string(counters.bytes[s]); });
+        writePrometheusStages(output, "iso8601_stage_records_total", "Records validated, values deduplicated or written.",
+            [](const Counters& counters, size_t s) { return std::to_string(counters.records[s]); });
+        writePrometheusStages(output, "iso8601_stage_seconds_total", "Time spent in each stage.",
+            [](const Counters& counters, size_t s) { return seconds(counters.nanoseconds[s]); });
+    }
+
+private:
+    template <typename Enum>
+    static size_t index(Enum value)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    // A day error at a 29th of February or a 366th day; in a leap year neither is an error.
+    static bool isLeapDay(std::string_view record, size_t position)
+    {
+        if (record.substr(position, 3) == "366") {
+            return true;
+        }
+        return record.substr(position, 2) == "29" && position >= 2 &&
+            (record.substr(position - 2, 2) == "02" || (position >= 3 && record.substr(position - 3, 3) == "02-"));
+    }
+
+    static void writeJsonCounters(std::ostream& output, const Counters& counters)
+    {
+        output << "\"rejected\":{";
+        for (size_t r = 0; r < REASONS; r++) {
+            output << (r == 0 ? "" : ",") << '"' << reasonName(static_cast<Reason>(r)) << "\":" << counters.rejected[r];
+        }
+        output << "},\"duplicates\":" << counters.duplicates << ",\"stages\":{";
+        for (size_t s = 0; s < STAGES; s++) {
+            output << (s == 0 ? "" : ",") << '"' << stageName(static_cast<Stage>(s)) << "\":{\"bytes\":" << counters.bytes[s]
+                << ",\"records\":" << counters.records[s] << ",\"nanoseconds\":" << counters.nanoseconds[s] << '}';
+        }
+        output << '}';
+    }
+
+    static void writePrometheusHeader(std::ostream& output, const char* name, const char* help)
+    {
+        output << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " counter\n";
+    }
+
+    template <typename Value>
+    void writePrometheusStages(std::ostream& output, const char* name, const char* help, Value&& value) const
+    {
+        writePrometheusHeader(output, name, help);
+        forEachActiveThread([&](size_t t, const Counters& counters) {
+            for (size_t s = 0; s < STAGES; s++) {
+                output << name << "{thread=\"" << t << "\",stage=\"" << stageName(static_cast<Stage>(s)) << "\"} "
+                    << value(counters, s) << '\n';
+            }
+        });
+    }
+
+    template <typename Visitor>
+    void forEachActiveThread(Visitor&& visit) const
+    {
+        for (size_t t = 0; t < threads_.size(); t++) {
+            if (!threads_[t].empty()) {
+                visit(t, threads_[t]);
+            }
+        }
+    }
+
+    static std::string seconds(uint64_t nanoseconds)
+    {
+        std::string fraction = std::to_string(nanoseconds % 1000000000);
+        return std::to_string(nanoseconds / 1000000000) + '.' + std::string(9 - fraction.size(), '0') + fraction;
+    }
+
+    std::vector<Counters> threads_;
+};
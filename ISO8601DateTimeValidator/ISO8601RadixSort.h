@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sorts packed date-time keys in ascending order, which is chronological order
+// (see iso8601_datetime_key). LSD radix sort with 11 bit digits: keys use the low
+// 52 bits, so at most five passes over the data, and a pass is skipped when all
+// keys share the same digit. All digit histograms are built in a single pass.
+inline void iso8601RadixSortKeys(std::vector<uint64_t>& keys)
+{
+    constexpr unsigned DIGIT_BITS = 11;
+    constexpr size_t DIGIT_VALUES = size_t(1) << DIGIT_BITS;
+    constexpr unsigned KEY_BITS = 52;
+    constexpr unsigned PASSES = (KEY_BITS + DIGIT_BITS - 1) / DIGIT_BITS;
+
+    if (keys.size() < 2) {
+        return;
+    }
+
+    std::vector<size_t> histograms(PASSES * DIGIT_VALUES, 0);
+    for (uint64_t key : keys) {
+        for (unsigned pass = 0; pass < PASSES; pass++) {
+            histograms[pass * DIGIT_VALUES + ((key >> (pass * DIGIT_BITS)) & (DIGIT_VALUES - 1))]++;
+        }
+    }
+
+    std::vector<uint64_t> scratch(keys.size());
+    for (unsigned pass = 0; pass < PASSES; pass++) {
+        size_t* histogram = histograms.data() + pass * DIGIT_VALUES;
+        const unsigned shift = pass * DIGIT_BITS;
+        if (histogram[(keys[0] >> shift) & (DIGIT_VALUES - 1)] == keys.size()) {
+            continue;
+        }
+
+        // Exclusive prefix sums give the first output index of each digit.
+        size_t offset = 0;
+        for (size_t digit = 0; digit < DIGIT_VALUES; digit++) {
+            size_t count = histogram[digit];
+            histogram[digit] = offset;
+            offset += count;
+        }
+
+        for (uint64_t key : keys) {
+            scratch[histogram[(key >> shift) & (DIGIT_VALUES - 1)]++] = key;
+        }
+        keys.swap(scratch);
+    }
+}
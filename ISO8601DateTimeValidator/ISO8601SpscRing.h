@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded queue between exactly one producer thread and one consumer thread.
+// The producer only advances tail_ and the consumer only advances head_, each on its
+// own cache line, so neither push nor pop takes a lock. A push into a full ring and a
+// pop from an empty one spin briefly and then sleep in std::atomic::wait until the other
+// side moves, so a pipeline waiting on a slow input uses no CPU.
+// After close() the consumer still receives every item pushed before, then pop returns false.
+template <typename T>
+class ISO8601SpscRing
+{
+public:
+    explicit ISO8601SpscRing(size_t capacity)
+        : slots_(roundUpToPowerOfTwo(capacity)), mask_(slots_.size() - 1) {}
+
+    ISO8601SpscRing(const ISO8601SpscRing&) = delete;
+    ISO8601SpscRing& operator=(const ISO8601SpscRing&) = delete;
+
+    void push(T value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        for (unsigned spins = 0;; spins++) {
+            const size_t head = head_.load(std::memory_order_acquire);
+            if (tail - head != slots_.size()) {
+                break;
+            }
+            if (spins >= SPINS_BEFORE_WAIT) {
+                head_.wait(head, std::memory_order_acquire);
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    // Waits for the next item. Returns false once the ring is closed and empty.
+    bool pop(T& value)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        for (unsigned spins = 0;; spins++) {
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            if ((tail & ~CLOSED) != head) {
+                break;
+            }
+            // The flag is part of the tail, so an item pushed before close() is never lost.
+            if ((tail & CLOSED) != 0) {
+                return false;
+            }
+            if (spins >= SPINS_BEFORE_WAIT) {
+                tail_.wait(tail, std::memory_order_acquire);
+            }
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return true;
+    }
+
+    // Called by the producer after its last push.
+    void close()
+    {
+        tail_.fetch_or(CLOSED, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr unsigned SPINS_BEFORE_WAIT = 64;
+    // Top bit of tail_, set by close(). tail_ counts every push and never gets near it.
+    static constexpr size_t CLOSED = ~(~size_t(0) >> 1);
+
+    static size_t roundUpToPowerOfTwo(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{ 0 };
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{ 0 };
+    alignas(CACHE_LINE_SIZE) std::vector<T> slots_;
+    size_t mask_;
+};
@@ -0,0 +1,621 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include "../ISO8601DateTimeValidatorLib/isodatetime_validator.h"
+
+// Header only validator and parser with the results of the C library: for the same
+// string and formats, parse returns what iso8601_parse_datetime_format returns and fills
+// the same fields, error and error position included.
+// The accepted formats are a template argument, a combination of ISO8601_ACCEPT_* flags,
+// so every instantiation keeps only the checks of its formats, and everything is
+// constexpr: a call site can inline the whole check, and a literal can be checked while
+// compiling, e.g. static_assert(ISO8601StaticValidator<>::isValid("2024-04-21T12:34:56Z")).
+template <unsigned AcceptedFormats = ISO8601_ACCEPT_EXTENDED>
+class ISO8601StaticValidator
+{
+    static_assert(AcceptedFormats != 0 && (AcceptedFormats & ~ISO8601_ACCEPT_ALL_DATETIMES) == 0,
+        "AcceptedFormats must be a combination of ISO8601_ACCEPT_* flags");
+
+public:
+    // Same as is_valid_iso8601_datetime_format.
+    static constexpr bool isValid(std::string_view dt_str)
+    {
+        iso8601_datetime fields{};
+        if constexpr (AcceptedFormats == ISO8601_ACCEPT_EXTENDED) {
+            return decodeExtendedDateTime(dt_str, fields);
+        }
+        else {
+            return parse(dt_str, fields);
+        }
+    }
+
+    // Same as iso8601_parse_datetime_format.
+    static constexpr bool parse(std::string_view dt_str, iso8601_datetime& result)
+    {
+        // Fixed width extended strings first, as in the C library.
+        bool decoded = false;
+        if constexpr (accepts(ISO8601_ACCEPT_EXTENDED)) {
+            const size_t length = dt_str.size();
+            if (length > 0 && ((dt_str[0] == '+') | (dt_str[0] == '-'))) {
+                if constexpr (accepts(ISO8601_ACCEPT_EXPANDED)) {
+                    decoded = ((length == 23) | (length == 28)) && decodeExpandedDateTime(dt_str, result);
+                }
+            }
+            else if ((length == 18) | (length == 23)) {
+                if constexpr (accepts(ISO8601_ACCEPT_ORDINAL)) {
+                    decoded = decodeExtendedOrdinalDateTime(dt_str, result);
+                }
+            }
+            else if (length > 5 && dt_str[5] == 'W') {
+                if constexpr (accepts(ISO8601_ACCEPT_WEEK)) {
+                    decoded = ((length == 20) | (length == 25)) && decodeExtendedWeekDateTime(dt_str, result);
+                }
+            }
+            else {
+                decoded = decodeExtendedDateTime(dt_str, result);
+            }
+        }
+        if (decoded) {
+            result.error = ISO8601_ERROR_NONE;
+            result.error_position = 0;
+            return true;
+        }
+        return parseFields(dt_str, result);
+    }
+
+    // Fields of a date-time literal, checked while compiling: an invalid literal does not
+    // compile.
+    static consteval iso8601_datetime literal(std::string_view dt_str)
+    {
+        iso8601_datetime fields{};
+        if (!parse(dt_str, fields)) {
+            throw std::invalid_argument("not a date-time in the accepted formats");
+        }
+        return fields;
+    }
+
+private:
+    static constexpr bool accepts(unsigned format)
+    {
+        return (AcceptedFormats & format) != 0;
+    }
+
+    // Above the range of every field, like FIELD_INVALID of the C library.
+    static constexpr unsigned FIELD_INVALID = 0xFF;
+
+    // Lookup tables for two digit fields like digit_tens and digit_ones of the C library:
+    // one unsigned compare of the sum checks both the digits and the range of a field.
+    static constexpr std::array<uint8_t, 256> DIGIT_TENS = [] {
+        std::array<uint8_t, 256> table{};
+        for (unsigned c = 0; c < 256; c++) {
+            table[c] = static_cast<uint8_t>(c >= '0' && c <= '9' ? (c - '0') * 10 : FIELD_INVALID);
+        }
+        return table;
+    }();
+
+    static constexpr std::array<uint8_t, 256> DIGIT_ONES = [] {
+        std::array<uint8_t, 256> table{};
+        for (unsigned c = 0; c < 256; c++) {
+            table[c] = static_cast<uint8_t>(c >= '0' && c <= '9' ? c - '0' : FIELD_INVALID);
+        }
+        return table;
+    }();
+
+    static constexpr unsigned digitValue(char c)
+    {
+        return DIGIT_ONES[static_cast<unsigned char>(c)];
+    }
+
+    static constexpr bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Value of the two digit field at position; above 99 if it is not two digits.
+    static constexpr unsigned fieldValue(std::string_view dt_str, size_t position)
+    {
+        return unsigned(DIGIT_TENS[static_cast<unsigned char>(dt_str[position])]) +
+            DIGIT_ONES[static_cast<unsigned char>(dt_str[position + 1])];
+    }
+
+    // Non-zero if the field is outside [min, max].
+    static constexpr unsigned outOfRange(unsigned value, unsigned min, unsigned max)
+    {
+        return value - min > max - min;
+    }
+
+    static constexpr uint8_t DAYS_IN_MONTH[2][13] = {
+        { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 },
+        { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 }
+    };
+
+    static constexpr uint16_t DAYS_BEFORE_MONTH[2][14] = {
+        { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+        { 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+    };
+
+    static constexpr uint32_t FRACTION_SCALE[10] = {
+        1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+    };
+
+    static constexpr unsigned isLeapYear(unsigned century, unsigned year_of_century)
+    {
+        return ((year_of_century & 3) == 0) & ((year_of_century != 0) | ((century & 3) == 0));
+    }
+
+    static constexpr unsigned isLeapYearOf(int64_t year)
+    {
+        return (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+    }
+
+    // 0 for Sunday to 6 for Saturday, as weekday_of_december_31 of the C library.
+    static constexpr unsigned weekdayOfDecember31(unsigned century, unsigned year_of_century)
+    {
+        return (5 * century + century / 4 + year_of_century + year_of_century / 4) % 7;
+    }
+
+    static constexpr unsigned weekdayOfDecember31Of(int64_t year)
+    {
+        const int64_t remainder = year % 400;
+        const unsigned y = static_cast<unsigned>(remainder < 0 ? remainder + 400 : remainder);
+        return weekdayOfDecember31(y / 100, y % 100);
+    }
+
+    static constexpr unsigned weekdayOfPreviousDecember31(unsigned weekday_of_december_31, unsigned leap)
+    {
+        return (weekday_of_december_31 + 6 - leap) % 7;
+    }
+
+    static constexpr unsigned weeksInYear(unsigned weekday_of_december_31, unsigned weekday_of_previous_december_31)
+    {
+        return 52 + ((weekday_of_december_31 == 4) | (weekday_of_previous_december_31 == 3));
+    }
+
+    static constexpr void monthDayFromOrdinal(unsigned ordinal, unsigned leap, unsigned& month, unsigned& day)
+    {
+        unsigned m = (ordinal - 1) / 31 + 1;
+        m += ordinal > DAYS_BEFORE_MONTH[leap][m + 1];
+        month = m;
+        day = ordinal - DAYS_BEFORE_MONTH[leap][m];
+    }
+
+    static constexpr void weekDateToCalendar(int64_t& year, unsigned leap, unsigned weekday_of_previous_december_31,
+        unsigned week, unsigned weekday, unsigned& month, unsigned& day)
+    {
+        const unsigned weekday_of_january_4 = (weekday_of_previous_december_31 + 3) % 7 + 1;
+        int ordinal = static_cast<int>(7 * week + weekday) - static_cast<int>(weekday_of_january_4 + 3);
+        if (ordinal < 1) {
+            year--;
+            leap = isLeapYearOf(year);
+            ordinal += 365 + static_cast<int>(leap);
+        }
+        else if (ordinal > 365 + static_cast<int>(leap)) {
+            ordinal -= 365 + static_cast<int>(leap);
+            year++;
+            leap = isLeapYearOf(year);
+        }
+        monthDayFromOrdinal(static_cast<unsigned>(ordinal), leap, month, day);
+    }
+
+    // Fixed width paths, branch free up to the conversion of the date. The string has
+    // one of the lengths of the path, so no character is read past its end.
+
+    // MM-DD at position. Returns non-zero if either field is invalid.
+    static constexpr unsigned decodeMonthDay(std::string_view dt_str, size_t position, unsigned leap,
+        unsigned& month, unsigned& day)
+    {
+        month = fieldValue(dt_str, position);
+        const unsigned month_invalid = outOfRange(month, 1, 12);
+        const unsigned invalid = month_invalid | (dt_str[position + 2] != '-');
+        day = fieldValue(dt_str, position + 3);
+        return invalid | outOfRange(day, 1, DAYS_IN_MONTH[leap][month_invalid ? 0 : month]);
+    }
+
+    // Thh:mm:ssZ, or Thh:mm:ss±hh:mm with_offset, at position.
+    static constexpr unsigned decodeExtendedTime(std::string_view dt_str, size_t position, bool with_offset,
+        iso8601_datetime& result)
+    {
+        const unsigned hour = fieldValue(dt_str, position + 1);
+        const unsigned minute = fieldValue(dt_str, position + 4);
+        const unsigned second = fieldValue(dt_str, position + 7);
+        unsigned invalid = dt_str[position] != 'T';
+        invalid |= outOfRange(hour, 0, 23) | (dt_str[position + 3] != ':');
+        invalid |= outOfRange(minute, 0, 59) | (dt_str[position + 6] != ':');
+        invalid |= outOfRange(second, 0, 59);
+
+        result.hour = static_cast<uint8_t>(hour);
+        result.minute = static_cast<uint8_t>(minute);
+        result.second = static_cast<uint8_t>(second);
+        result.fraction_digits = 0;
+        result.fraction = 0;
+
+        const char designator = dt_str[position + 9];
+        if (!with_offset) {
+            result.offset_minutes = 0;
+            result.format = 0;
+            return invalid | (designator != 'Z');
+        }
+
+        const unsigned offset_hour = fieldValue(dt_str, position + 10);
+        const unsigned offset_minute = fieldValue(dt_str, position + 13);
+        invalid |= (designator != '+') & (designator != '-');
+        invalid |= outOfRange(offset_hour, 0, 23) | (dt_str[position + 12] != ':');
+        invalid |= outOfRange(offset_minute, 0, 59);
+
+        const int offset_minutes = static_cast<int>(offset_hour * 60 + offset_minute);
+        result.offset_minutes = static_cast<int16_t>(designator == '-' ? -offset_minutes : offset_minutes);
+        result.format = ISO8601_FORMAT_OFFSET;
+        return invalid;
+    }
+
+    // YYYY-MM-DDThh:mm:ssZ or YYYY-MM-DDThh:mm:ss±hh:mm.
+    static constexpr bool decodeExtendedDateTime(std::string_view dt_str, iso8601_datetime& result)
+    {
+        if (dt_str.size() != 20 && dt_str.size() != 25) {
+            return false;
+        }
+
+        const unsigned century = fieldValue(dt_str, 0);
+        const unsigned year_of_century = fieldValue(dt_str, 2);
+        unsigned invalid = outOfRange(century, 0, 99) | outOfRange(year_of_century, 0, 99);
+        invalid |= dt_str[4] != '-';
+
+        unsigned month = 0;
+        unsigned day = 0;
+        invalid |= decodeMonthDay(dt_str, 5, isLeapYear(century, year_of_century), month, day);
+        invalid |= decodeExtendedTime(dt_str, 10, dt_str.size() == 25, result);
+
+        result.year = static_cast<int32_t>(century * 100 + year_of_century);
+        result.month = static_cast<uint8_t>(month);
+        result.day = static_cast<uint8_t>(day);
+        return !invalid;
+    }
+
+    // YYYY-DDDThh:mm:ssZ or YYYY-DDDThh:mm:ss±hh:mm.
+    static constexpr bool decodeExtendedOrdinalDateTime(std::string_view dt_str, iso8601_datetime& result)
+    {
+        const unsigned century = fieldValue(dt_str, 0);
+        const unsigned year_of_century = fieldValue(dt_str, 2);
+        unsigned invalid = outOfRange(century, 0, 99) | outOfRange(year_of_century, 0, 99);
+        invalid |= dt_str[4] != '-';
+
+        const unsigned leap = isLeapYear(century, year_of_century);
+        const unsigned day_of_year_tail = fieldValue(dt_str, 6);
+        const unsigned ordinal = digitValue(dt_str[5]) * 100u + day_of_year_tail;
+        invalid |= outOfRange(day_of_year_tail, 0, 99) | outOfRange(ordinal, 1, 365 + leap);
+        invalid |= decodeExtendedTime(dt_str, 8, dt_str.size() == 23, result);
+        if (invalid) {
+            return false;
+        }
+
+        unsigned month = 0;
+        unsigned day = 0;
+        monthDayFromOrdinal(ordinal, leap, month, day);
+        result.year = static_cast<int32_t>(century * 100 + year_of_century);
+        result.month = static_cast<uint8_t>(month);
+        result.day = static_cast<uint8_t>(day);
+        result.format |= ISO8601_FORMAT_ORDINAL;
+        return true;
+    }
+
+    // YYYY-Www-DThh:mm:ssZ or YYYY-Www-DThh:mm:ss±hh:mm.
+    static constexpr bool decodeExtendedWeekDateTime(std::string_view dt_str, iso8601_datetime& result)
+    {
+        const unsigned century = fieldValue(dt_str, 0);
+        const unsigned year_of_century = fieldValue(dt_str, 2);
+        unsigned invalid = outOfRange(century, 0, 99) | outOfRange(year_of_century, 0, 99);
+        invalid |= (dt_str[4] != '-') | (dt_str[5] != 'W') | (dt_str[8] != '-');
+
+        int64_t year = century * 100 + year_of_century;
+        const unsigned leap = isLeapYear(century, year_of_century);
+        const unsigned last_day = weekdayOfDecember31(century, year_of_century);
+        const unsigned previous_last_day = weekdayOfPreviousDecember31(last_day, leap);
+        const unsigned week = fieldValue(dt_str, 6);
+        const unsigned weekday = digitValue(dt_str[9]);
+        invalid |= outOfRange(week, 1, weeksInYear(last_day, previous_last_day)) | outOfRange(weekday, 1, 7);
+        invalid |= decodeExtendedTime(dt_str, 10, dt_str.size() == 25, result);
+        if (invalid) {
+            return false;
+        }
+
+        unsigned month = 0;
+        unsigned day = 0;
+        weekDateToCalendar(year, leap, previous_last_day, week, weekday, month, day);
+        result.year = static_cast<int32_t>(year);
+        result.month = static_cast<uint8_t>(month);
+        result.day = static_cast<uint8_t>(day);
+        result.format |= ISO8601_FORMAT_WEEK;
+        return true;
+    }
+
+    // ±YYYYYY-MM-DDThh:mm:ssZ or ±YYYYYY-MM-DDThh:mm:ss±hh:mm.
+    static constexpr bool decodeExpandedDateTime(std::string_view dt_str, iso8601_datetime& result)
+    {
+        const unsigned millennia = fieldValue(dt_str, 1);
+        const unsigned centuries = fieldValue(dt_str, 3);
+        const unsigned year_of_century = fieldValue(dt_str, 5);
+        unsigned invalid = outOfRange(millennia, 0, 99) | outOfRange(centuries, 0, 99) | outOfRange(year_of_century, 0, 99);
+        invalid |= dt_str[7] != '-';
+        const unsigned high = millennia * 100 + centuries;
+
+        unsigned month = 0;
+        unsigned day = 0;
+        invalid |= decodeMonthDay(dt_str, 8, isLeapYear(high, year_of_century), month, day);
+        invalid |= decodeExtendedTime(dt_str, 13, dt_str.size() == 28, result);
+
+        const int32_t year = static_cast<int32_t>(high * 100 + year_of_century);
+        result.year = dt_str[0] == '-' ? -year : year;
+        result.month = static_cast<uint8_t>(month);
+        result.day = static_cast<uint8_t>(day);
+        result.format |= ISO8601_FORMAT_EXPANDED;
+        return !invalid;
+    }
+
+    // Sequential parser, finding the first problem in the order of the characters.
+
+    static constexpr bool parseError(iso8601_datetime& result, iso8601_error error, size_t position)
+    {
+        result.error = error;
+        result.error_position = static_cast<uint32_t>(position);
+        return false;
+    }
+
+    static constexpr bool expectDigits(std::string_view dt_str, size_t position, size_t count, iso8601_datetime& result)
+    {
+        for (size_t i = position; i < position + count; i++) {
+            if (i >= dt_str.size()) {
+                return parseError(result, ISO8601_ERROR_LENGTH, dt_str.size());
+            }
+            if (!isDigit(dt_str[i])) {
+                return parseError(result, ISO8601_ERROR_DIGIT, i);
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool expectSeparator(std::string_view dt_str, size_t position, char separator, iso8601_datetime& result)
+    {
+        if (position >= dt_str.size()) {
+            return parseError(result, ISO8601_ERROR_LENGTH, dt_str.size());
+        }
+        if (dt_str[position] != separator) {
+            return parseError(result, ISO8601_ERROR_SEPARATOR, position);
+        }
+        return true;
+    }
+
+    static constexpr bool expectField(std::string_view dt_str, size_t position, unsigned min, unsigned max,
+        iso8601_error error, iso8601_datetime& result)
+    {
+        if (!expectDigits(dt_str, position, 2, result)) {
+            return false;
+        }
+        if (outOfRange(fieldValue(dt_str, position), min, max)) {
+            return parseError(result, error, position);
+        }
+        return true;
+    }
+
+    // Same steps as parse_datetime_fields of the C library.
+    static constexpr bool parseFields(std::string_view dt_str, iso8601_datetime& result)
+    {
+        const size_t length = dt_str.size();
+
+        // Year: YYYY, or ±YYYYYY when expanded.
+        unsigned format = 0;
+        int64_t year = 0;
+        size_t position = 0;
+        if (length > 0 && (dt_str[0] == '+' || dt_str[0] == '-')) {
+            if constexpr (!accepts(ISO8601_ACCEPT_EXPANDED)) {
+                return parseError(result, ISO8601_ERROR_FORMAT, 0);
+            }
+            if (!expectDigits(dt_str, 1, ISO8601_EXPANDED_YEAR_DIGITS, result)) {
+                return false;
+            }
+            year = int64_t(fieldValue(dt_str, 1)) * 10000 + fieldValue(dt_str, 3) * 100 + fieldValue(dt_str, 5);
+            if (dt_str[0] == '-') {
+                year = -year;
+            }
+            position = 1 + ISO8601_EXPANDED_YEAR_DIGITS;
+            format |= ISO8601_FORMAT_EXPANDED;
+        }
+        else {
+            if (!expectDigits(dt_str, 0, 4, result)) {
+                return false;
+            }
+            year = fieldValue(dt_str, 0) * 100 + fieldValue(dt_str, 2);
+            position = 4;
+        }
+        const unsigned leap = isLeapYearOf(year);
+
+        // '-' for extended, a digit or the week designator for basic.
+        const bool basic = position < length && (isDigit(dt_str[position]) || dt_str[position] == 'W');
+        if (basic ? !accepts(ISO8601_ACCEPT_BASIC) :
+            !accepts(ISO8601_ACCEPT_EXTENDED) && position < length && dt_str[position] == '-') {
+            return parseError(result, ISO8601_ERROR_FORMAT, position);
+        }
+        if (basic) {
+            format |= ISO8601_FORMAT_BASIC;
+        }
+        else if (!expectSeparator(dt_str, position++, '-', result)) {
+            return false;
+        }
+
+        // Week date, ordinal date or calendar date.
+        unsigned month = 0;
+        unsigned day = 0;
+        if (position < length && dt_str[position] == 'W') {
+            if constexpr (!accepts(ISO8601_ACCEPT_WEEK)) {
+                return parseError(result, ISO8601_ERROR_FORMAT, position);
+            }
+            position++;
+            const unsigned last_day = weekdayOfDecember31Of(year);
+            const unsigned previous_last_day = weekdayOfPreviousDecember31(last_day, leap);
+            if (!expectField(dt_str, position, 1, weeksInYear(last_day, previous_last_day), ISO8601_ERROR_WEEK, result)) {
+                return false;
+            }
+            const unsigned week = fieldValue(dt_str, position);
+            position += 2;
+            if (!basic && !expectSeparator(dt_str, position++, '-', result)) {
+                return false;
+            }
+            if (!expectDigits(dt_str, position, 1, result)) {
+                return false;
+            }
+            const unsigned weekday = static_cast<unsigned>(dt_str[position] - '0');
+            if (outOfRange(weekday, 1, 7)) {
+                return parseError(result, ISO8601_ERROR_WEEKDAY, position);
+            }
+            position++;
+
+            weekDateToCalendar(year, leap, previous_last_day, week, weekday, month, day);
+            format |= ISO8601_FORMAT_WEEK;
+        }
+        else if (basic ? position + 3 < length && dt_str[position + 3] == 'T' :
+            position + 2 < length && isDigit(dt_str[position + 2])) {
+            if constexpr (!accepts(ISO8601_ACCEPT_ORDINAL)) {
+                return parseError(result, ISO8601_ERROR_FORMAT, position);
+            }
+            if (!expectDigits(dt_str, position, 3, result)) {
+                return false;
+            }
+            const unsigned ordinal = static_cast<unsigned>(dt_str[position] - '0') * 100 + fieldValue(dt_str, position + 1);
+            if (outOfRange(ordinal, 1, 365 + leap)) {
+                return parseError(result, ISO8601_ERROR_DAY, position);
+            }
+            position += 3;
+            monthDayFromOrdinal(ordinal, leap, month, day);
+            format |= ISO8601_FORMAT_ORDINAL;
+        }
+        else {
+            if (!expectField(dt_str, position, 1, 12, ISO8601_ERROR_MONTH, result)) {
+                return false;
+            }
+            month = fieldValue(dt_str, position);
+            position += 2;
+            if (!basic && !expectSeparator(dt_str, position++, '-', result)) {
+                return false;
+            }
+            if (!expectField(dt_str, position, 1, DAYS_IN_MONTH[leap][month], ISO8601_ERROR_DAY, result)) {
+                return false;
+            }
+            day = fieldValue(dt_str, position);
+            position += 2;
+        }
+
+        if (!expectSeparator(dt_str, position++, 'T', result) ||
+            !expectField(dt_str, position, 0, 23, ISO8601_ERROR_HOUR, result)) {
+            return false;
+        }
+        const unsigned hour = fieldValue(dt_str, position);
+        position += 2;
+        if (!basic && !expectSeparator(dt_str, position++, ':', result)) {
+            return false;
+        }
+        if (!expectField(dt_str, position, 0, 59, ISO8601_ERROR_MINUTE, result)) {
+            return false;
+        }
+        const unsigned minute = fieldValue(dt_str, position);
+        position += 2;
+
+        // Reduced precision: the seconds are left out and a fraction belongs to the minute.
+        unsigned second = 0;
+        const bool has_seconds = position < length && (basic ? isDigit(dt_str[position]) : dt_str[position] == ':');
+        if (has_seconds || !accepts(ISO8601_ACCEPT_REDUCED)) {
+            if (!basic && !expectSeparator(dt_str, position++, ':', result)) {
+                return false;
+            }
+            if (!expectField(dt_str, position, 0, 59, ISO8601_ERROR_SECOND, result)) {
+                return false;
+            }
+            second = fieldValue(dt_str, position);
+            position += 2;
+        }
+        else {
+            format |= ISO8601_FORMAT_REDUCED;
+        }
+
+        // Decimal fraction of the last time unit, with a comma or a full stop.
+        uint32_t fraction = 0;
+        unsigned fraction_digits = 0;
+        if (position < length && (dt_str[position] == '.' || dt_str[position] == ',')) {
+            if constexpr (!accepts(ISO8601_ACCEPT_FRACTION)) {
+                return parseError(result, ISO8601_ERROR_FORMAT, position);
+            }
+            if (dt_str[position] == ',') {
+                format |= ISO8601_FORMAT_COMMA;
+            }
+            position++;
+            while (position < length && isDigit(dt_str[position])) {
+                if (fraction_digits == ISO8601_MAX_FRACTION_DIGITS) {
+                    return parseError(result, ISO8601_ERROR_FRACTION, position);
+                }
+                fraction = fraction * 10 + static_cast<uint32_t>(dt_str[position] - '0');
+                fraction_digits++;
+                position++;
+            }
+            if (fraction_digits == 0 && !expectDigits(dt_str, position, 1, result)) {
+                return false;
+            }
+            fraction *= FRACTION_SCALE[fraction_digits];
+        }
+
+        // Timezone designator: Z, or ±hh:mm (±hhmm in basic format).
+        int offset_minutes = 0;
+        if (position >= length) {
+            return parseError(result, ISO8601_ERROR_LENGTH, length);
+        }
+        if (dt_str[position] == 'Z') {
+            position++;
+        }
+        else if (dt_str[position] == '+' || dt_str[position] == '-') {
+            const bool negative = dt_str[position++] == '-';
+            if (!expectField(dt_str, position, 0, 23, ISO8601_ERROR_OFFSET_HOUR, result)) {
+                return false;
+            }
+            offset_minutes = static_cast<int>(fieldValue(dt_str, position)) * 60;
+            position += 2;
+            if (!basic && !expectSeparator(dt_str, position++, ':', result)) {
+                return false;
+            }
+            if (!expectField(dt_str, position, 0, 59, ISO8601_ERROR_OFFSET_MINUTE, result)) {
+                return false;
+            }
+            offset_minutes += static_cast<int>(fieldValue(dt_str, position));
+            position += 2;
+            if (negative) {
+                offset_minutes = -offset_minutes;
+            }
+            format |= ISO8601_FORMAT_OFFSET;
+        }
+        else {
+            return parseError(result, ISO8601_ERROR_DESIGNATOR, position);
+        }
+        if (position != length) {
+            return parseError(result, ISO8601_ERROR_LENGTH, position);
+        }
+
+        if (format & ISO8601_FORMAT_REDUCED) {
+            const uint64_t nanoseconds = uint64_t(fraction) * 60;
+            second = static_cast<unsigned>(nanoseconds / 1000000000u);
+            fraction = static_cast<uint32_t>(nanoseconds % 1000000000u);
+        }
+
+        result.year = static_cast<int32_t>(year);
+        result.month = static_cast<uint8_t>(month);
+        result.day = static_cast<uint8_t>(day);
+        result.hour = static_cast<uint8_t>(hour);
+        result.minute = static_cast<uint8_t>(minute);
+        result.second = static_cast<uint8_t>(second);
+        result.fraction_digits = static_cast<uint8_t>(fraction_digits);
+        result.fraction = fraction;
+        result.offset_minutes = static_cast<int16_t>(offset_minutes);
+        result.format = static_cast<uint16_t>(format);
+        result.error = ISO8601_ERROR_NONE;
+        result.error_position = 0;
+        return true;
+    }
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Storage for the text of values that have no packed key, such as date-times in the
+// basic format or with a decimal fraction.
+
+// Bump allocator for strings. Strings are copied one after the other into slabs of
+// SLAB_SIZE bytes, a longer one into a slab of its own, so storing a string costs no
+// allocation of its own, and dropping all of them costs one free per slab rather than
+// one per string. A stored string never moves: its string_view stays valid until clear().
+class ISO8601TextArena
+{
+public:
+    static constexpr size_t SLAB_SIZE = 1 << 20;
+
+    ISO8601TextArena() = default;
+    ISO8601TextArena(ISO8601TextArena&&) = default;
+    ISO8601TextArena& operator=(ISO8601TextArena&&) = default;
+
+    // Copies text into the arena and returns its handle, which is never 0. The length is
+    // kept in front of the characters, so a handle is all it takes to find the text again.
+    uint64_t add(std::string_view text)
+    {
+        const uint32_t length = static_cast<uint32_t>(text.size());
+        const size_t size = sizeof(length) + text.size();
+        if (slabs_.empty() || slabs_.back().size - used_ < size) {
+            addSlab(size);
+        }
+        char* destination = slabs_.back().data.get() + used_;
+        std::memcpy(destination, &length, sizeof(length));
+        std::memcpy(destination + sizeof(length), text.data(), text.size());
+        const uint64_t handle = (static_cast<uint64_t>(slabs_.size()) << 32) | used_;
+        used_ += size;
+        return handle;
+    }
+
+    std::string_view view(uint64_t handle) const
+    {
+        const char* source = slabs_[static_cast<size_t>(handle >> 32) - 1].data.get() + (handle & 0xFFFFFFFFu);
+        uint32_t length;
+        std::memcpy(&length, source, sizeof(length));
+        return std::string_view(source + sizeof(length), length);
+    }
+
+    // Copies text into the arena.
+    std::string_view store(std::string_view text)
+    {
+        return view(add(text));
+    }
+
+    // Drops every string. The first slab is kept for the strings stored next and the
+    // others are freed, so this takes time in the number of slabs.
+    void clear()
+    {
+        if (slabs_.size() > 1) {
+            slabs_.erase(slabs_.begin() + 1, slabs_.end());
+        }
+        used_ = 0;
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t usage = 0;
+        for (const Slab& slab : slabs_) {
+            usage += slab.size;
+        }
+        return usage;
+    }
+
+private:
+    struct Slab
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    void addSlab(size_t size)
+    {
+        size = std::max(size, SLAB_SIZE);
+        slabs_.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+        used_ = 0;
+    }
+
+    std::vector<Slab> slabs_;
+    // Bytes used in the last slab.
+    size_t used_ = 0;
+};
+
+// Open addressing hash set of strings whose characters live in an ISO8601TextArena of
+// its own. A slot only holds the arena handle of a string and its hash, so the table has
+// no node per string, and growing it never touches the strings.
+class ISO8601TextSet
+{
+public:
+    ISO8601TextSet() : slots_(MIN_CAPACITY), shift_(64 - MIN_CAPACITY_BITS) {}
+
+    // Adds a copy of text unless an equal string is present. Returns the string as stored
+    // in the arena, which stays valid until clear(), and whether it was added.
+    std::pair<std::string_view, bool> insert(std::string_view text)
+    {
+        if ((size_ + 1) * 4 > slots_.size() * 3) {
+            grow();
+        }
+
+        const uint64_t hash = std::hash<std::string_view>()(text);
+        const size_t mask = slots_.size() - 1;
+        for (size_t slot = indexOf(hash);; slot = (slot + 1) & mask) {
+            Slot& entry = slots_[slot];
+            if (entry.handle == 0) {
+                entry = { arena_.add(text), hash };
+                size_++;
+                return { arena_.view(entry.handle), true };
+            }
+            if (entry.hash == hash) {
+                const std::string_view stored = arena_.view(entry.handle);
+                if (stored == text) {
+                    return { stored, false };
+                }
+            }
+        }
+    }
+
+    // Removes every string but keeps a slab of the arena, and the table unless it is more
+    // than SHRINK_FACTOR times the size the strings it held need, as in ISO8601KeySet.
+    void clear()
+    {
+        size_t capacity = MIN_CAPACITY;
+        unsigned shift = 64 - MIN_CAPACITY_BITS;
+        while (size_ * 4 > capacity * 3) {
+            capacity *= 2;
+            shift--;
+        }
+        if (slots_.size() > capacity * SHRINK_FACTOR) {
+            std::vector<Slot>(capacity).swap(slots_);
+            shift_ = shift;
+        }
+        else {
+            std::fill(slots_.begin(), slots_.end(), Slot());
+        }
+        arena_.clear();
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t memoryUsage() const { return slots_.size() * sizeof(Slot) + arena_.memoryUsage(); }
+
+private:
+    static constexpr unsigned MIN_CAPACITY_BITS = 6;
+    static constexpr size_t MIN_CAPACITY = size_t(1) << MIN_CAPACITY_BITS;
+    static constexpr size_t SHRINK_FACTOR = 4;
+
+    struct Slot
+    {
+        uint64_t handle = 0; // 0 for an empty slot.
+        uint64_t hash = 0;
+    };
+
+    // Fibonacci hashing, as in ISO8601KeySet.
+    size_t indexOf(uint64_t hash) const
+    {
+        return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old_slots(slots_.size() * 2);
+        old_slots.swap(slots_);
+        shift_--;
+
+        const size_t mask = slots_.size() - 1;
+        for (const Slot& entry : old_slots) {
+            if (entry.handle != 0) {
+                size_t slot = indexOf(entry.hash);
+                while (slots_[slot].handle != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                slots_[slot] = entry;
+            }
+        }
+    }
+
+    ISO8601TextArena arena_;
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    unsigned shift_;
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "../ISO8601DateTimeValidatorLib/isodatetime_validator.h"
+#include "ISO8601KeySet.h"
+#include "ISO8601TextArena.h"
+
+// Dedup set that only remembers the values of a sliding window of UTC time, for streams
+// that are nearly sorted by time.
+// Values fall into buckets of bucket_seconds by their instant, and the buckets form a
+// ring that covers at least window_seconds up to the latest instant seen (the high-water
+// mark). When the mark moves on, the buckets that drop out of the window are emptied
+// wholesale and reused for newer instants, so memory follows the number of values in the
+// window instead of the whole input, and each bucket stays small enough to be cache resident.
+// An emptied bucket keeps room for as many values as it held, so a burst only costs
+// memory until its bucket is emptied again after holding far fewer (see ISO8601KeySet::clear).
+// A value older than the window cannot be told apart from a new one: it is reported as
+// new and counted as late.
+class ISO8601WindowedKeySet
+{
+public:
+    // Number of buckets of the ring; eviction removes 1/(BUCKETS - 1) of the window at a time.
+    static constexpr int64_t BUCKETS = 16;
+
+    ISO8601WindowedKeySet(int64_t window_seconds, unsigned ignored_low_bits)
+        : bucket_seconds_(std::max<int64_t>(1, (std::max<int64_t>(window_seconds, 1) + BUCKETS - 2) / (BUCKETS - 1)))
+    {
+        buckets_.reserve(BUCKETS);
+        for (int64_t i = 0; i < BUCKETS; i++) {
+            buckets_.emplace_back(ignored_low_bits);
+        }
+    }
+
+    // Adds a packed date-time key. Returns false if an equal key is in the window.
+    bool insert(uint64_t key)
+    {
+        Bucket* bucket = bucketOf(ISO8601_KEY_UNIX_SECONDS(key));
+        return bucket == nullptr || bucket->keys.insert(key);
+    }
+
+    // Adds a value without a packed key, identified by text, at an instant in seconds
+    // since 1970-01-01T00:00:00Z. Returns false if an equal value is in the window.
+    bool insertText(int64_t seconds, std::string_view text)
+    {
+        Bucket* bucket = bucketOf(seconds);
+        return bucket == nullptr || bucket->texts.insert(text).second;
+    }
+
+    // Values that were older than the window when they arrived.
+    uint64_t lateValues() const { return late_values_; }
+
+    int64_t bucketSeconds() const { return bucket_seconds_; }
+
+private:
+    struct Bucket
+    {
+        explicit Bucket(unsigned ignored_low_bits) : keys(ignored_low_bits) {}
+
+        ISO8601KeySet keys;
+        ISO8601TextSet texts;
+    };
+
+    // Bucket of an instant, or nullptr if the instant is older than the window.
+    // Moving the high-water mark empties the buckets it passes over.
+    Bucket* bucketOf(int64_t seconds)
+    {
+        const int64_t number = floorDivide(seconds, bucket_seconds_);
+        if (number > latest_) {
+            const int64_t first = std::max(latest_ + 1, number - BUCKETS + 1);
+            for (int64_t passed = first; passed <= number; passed++) {
+                Bucket& bucket = buckets_[slotOf(passed)];
+                bucket.keys.clear();
+                bucket.texts.clear();
+            }
+            latest_ = number;
+        }
+        else if (number <= latest_ - BUCKETS) {
+            late_values_++;
+            return nullptr;
+        }
+        return &buckets_[slotOf(number)];
+    }
+
+    static int64_t floorDivide(int64_t value, int64_t divisor)
+    {
+        const int64_t quotient = value / divisor;
+        return quotient - (value % divisor < 0);
+    }
+
+    static size_t slotOf(int64_t number)
+    {
+        return static_cast<size_t>(((number % BUCKETS) + BUCKETS) % BUCKETS);
+    }
+
+    int64_t bucket_seconds_;
+    // Bucket number of the high-water mark.
+    int64_t latest_ = std::numeric_limits<int64_t>::min() / 2;
+    uint64_t late_values_ = 0;
+    std::vector<Bucket> buckets_;
+};
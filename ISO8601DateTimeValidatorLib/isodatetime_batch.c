@@ -0,0 +1,133 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "isodatetime_validator.h"
+
+// Splits a buffer of newline separated records and validates them in place.
+// Records are never copied: each one is described by its offset and length in the
+// buffer, and its result is a single bit in the caller's bitmap.
+size_t iso8601_validate_chunk(const char* buffer, size_t size, bool end_of_input,
+    iso8601_record_span* spans, uint64_t* valid_bitmap, size_t max_records, size_t* consumed)
+{
+    size_t count = 0;
+    size_t position = 0;
+
+    memset(valid_bitmap, 0, ISO8601_BITMAP_WORDS(max_records) * sizeof(uint64_t));
+
+    while (count < max_records && position < size) {
+        const char* newline = memchr(buffer + position, '\n', size - position);
+        size_t end;
+        size_t next;
+        if (newline != NULL) {
+            end = (size_t)(newline - buffer);
+            next = end + 1;
+        }
+        else if (end_of_input) {
+            // Last record of the input without a trailing newline.
+            end = size;
+            next = size;
+        }
+        else {
+            // Incomplete record; the caller has to supply the rest of it.
+            break;
+        }
+
+        // Files written on Windows end their lines with \r\n.
+        size_t length = end - position;
+        if (length > 0 && buffer[end - 1] == '\r') {
+            length--;
+        }
+
+        spans[count].offset = position;
+        spans[count].length = length;
+        if (is_valid_iso8601_datetime_n(buffer + position, length)) {
+            valid_bitmap[count >> 6] |= (uint64_t)1 << (count & 63);
+        }
+
+        count++;
+        position = next;
+    }
+
+    *consumed = position;
+    return count;
+}
+
+static size_t column_offset(const iso8601_string_column* column, size_t row)
+{
+    return column->large_offsets != NULL ? (size_t)column->large_offsets[row] : (size_t)column->offsets[row];
+}
+
+static bool column_is_null(const iso8601_string_column* column, size_t row)
+{
+    return column->null_bitmap != NULL && !((column->null_bitmap[row >> 3] >> (row & 7)) & 1u);
+}
+
+// Microseconds since 1970-01-01T00:00:00Z. Returns false if they do not fit in 64 bits,
+// which only expanded years far from 1970 reach.
+static bool parsed_to_epoch_microseconds(const iso8601_datetime* parsed, int64_t* microseconds)
+{
+    int64_t seconds = iso8601_parsed_to_unix_seconds(parsed);
+    if (seconds >= INT64_MAX / 1000000 || seconds <= INT64_MIN / 1000000) {
+        return false;
+    }
+    *microseconds = seconds * 1000000 + (int64_t)(parsed->fraction / 1000);
+    return true;
+}
+
+// Rows are handled ISO8601_COLUMN_BATCH_ROWS at a time: their results are collected,
+// then packed into validity a byte at a time, so validity is written with whole stores.
+size_t iso8601_validate_string_column(const iso8601_string_column* column, size_t begin_row, size_t end_row,
+    unsigned accepted_formats, uint8_t* validity, int64_t* epoch_microseconds)
+{
+    const char* pointers[ISO8601_COLUMN_BATCH_ROWS];
+    size_t lengths[ISO8601_COLUMN_BATCH_ROWS];
+    bool results[ISO8601_COLUMN_BATCH_ROWS];
+    const bool batch = accepted_formats == ISO8601_ACCEPT_EXTENDED;
+    size_t valid = 0;
+
+    for (size_t first = begin_row; first < end_row; first += ISO8601_COLUMN_BATCH_ROWS) {
+        size_t count = end_row - first < ISO8601_COLUMN_BATCH_ROWS ? end_row - first : ISO8601_COLUMN_BATCH_ROWS;
+        size_t begin = column_offset(column, first);
+        for (size_t i = 0; i < count; i++) {
+            size_t end = column_offset(column, first + i + 1);
+            pointers[i] = column->data + begin;
+            lengths[i] = end - begin;
+            begin = end;
+        }
+
+        if (batch) {
+            // Extended format values have no fraction, and the seconds of their key fit.
+            is_valid_iso8601_datetime_batch(pointers, lengths, count, results);
+            if (epoch_microseconds != NULL) {
+                for (size_t i = 0; i < count; i++) {
+                    epoch_microseconds[first + i] = results[i] && !column_is_null(column, first + i)
+                        ? ISO8601_KEY_UNIX_SECONDS(iso8601_datetime_key(pointers[i], lengths[i])) * 1000000 : 0;
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                iso8601_datetime parsed;
+                int64_t microseconds = 0;
+                results[i] = !column_is_null(column, first + i) &&
+                    iso8601_parse_datetime_format(pointers[i], lengths[i], accepted_formats, &parsed) &&
+                    (epoch_microseconds == NULL || parsed_to_epoch_microseconds(&parsed, &microseconds));
+                if (epoch_microseconds != NULL) {
+                    epoch_microseconds[first + i] = results[i] ? microseconds : 0;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i += 8) {
+            uint8_t bits = 0;
+            for (size_t b = 0; b < 8 && i + b < count; b++) {
+                bool row_valid = results[i + b] && !column_is_null(column, first + i + b);
+                bits |= (uint8_t)((unsigned)row_valid << b);
+                valid += row_valid;
+            }
+            validity[(first + i) >> 3] = bits;
+        }
+    }
+    return valid;
+}
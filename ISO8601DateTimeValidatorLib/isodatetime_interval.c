@@ -0,0 +1,263 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "isodatetime_validator.h"
+
+// Durations, intervals and recurring intervals. Every part is read from left to right
+// exactly once: the '/' between the parts is found first, then each part goes to the
+// duration or the date-time parser depending on whether it starts with 'P'.
+
+static bool fail(iso8601_error error, size_t position, iso8601_error* result_error, uint32_t* result_position)
+{
+    *result_error = error;
+    *result_position = (uint32_t)position;
+    return false;
+}
+
+static bool is_digit(char c)
+{
+    return (unsigned)(c - '0') <= 9;
+}
+
+// Unit of a designator, or ISO8601_DURATION_UNITS if it is not one of the date part
+// (before 'T') or of the time part (after 'T').
+static unsigned duration_unit(char designator, bool time)
+{
+    switch (designator)
+    {
+    case 'Y':
+        return time ? ISO8601_DURATION_UNITS : ISO8601_DURATION_YEARS;
+    case 'M':
+        return time ? ISO8601_DURATION_MINUTES : ISO8601_DURATION_MONTHS;
+    case 'W':
+        return time ? ISO8601_DURATION_UNITS : ISO8601_DURATION_WEEKS;
+    case 'D':
+        return time ? ISO8601_DURATION_UNITS : ISO8601_DURATION_DAYS;
+    case 'H':
+        return time ? ISO8601_DURATION_HOURS : ISO8601_DURATION_UNITS;
+    case 'S':
+        return time ? ISO8601_DURATION_SECONDS : ISO8601_DURATION_UNITS;
+    default:
+        return ISO8601_DURATION_UNITS;
+    }
+}
+
+bool iso8601_parse_duration(const char* duration, size_t length, iso8601_duration* result)
+{
+    static const uint32_t fraction_scale[ISO8601_MAX_FRACTION_DIGITS + 1] = {
+        1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+    };
+
+    memset(result, 0, sizeof(*result));
+    iso8601_error* error = &result->error;
+    uint32_t* error_position = &result->error_position;
+
+    if (length == 0) {
+        return fail(ISO8601_ERROR_LENGTH, 0, error, error_position);
+    }
+    if (duration[0] != 'P') {
+        return fail(ISO8601_ERROR_DURATION, 0, error, error_position);
+    }
+
+    size_t position = 1;
+    unsigned next_unit = ISO8601_DURATION_YEARS;
+    bool time = false;
+    while (position < length) {
+        if (duration[position] == 'T' && !time) {
+            time = true;
+            next_unit = ISO8601_DURATION_HOURS;
+            position++;
+            if (position == length) {
+                return fail(ISO8601_ERROR_LENGTH, position, error, error_position);
+            }
+        }
+
+        size_t start = position;
+        uint32_t value = 0;
+        while (position < length && is_digit(duration[position])) {
+            if (position - start == ISO8601_MAX_DURATION_DIGITS) {
+                return fail(ISO8601_ERROR_DURATION, position, error, error_position);
+            }
+            value = value * 10 + (uint32_t)(duration[position] - '0');
+            position++;
+        }
+        if (position == start) {
+            return fail(ISO8601_ERROR_DIGIT, position, error, error_position);
+        }
+
+        uint32_t fraction = 0;
+        size_t fraction_digits = 0;
+        if (position < length && (duration[position] == ',' || duration[position] == '.')) {
+            position++;
+            while (position < length && is_digit(duration[position])) {
+                if (fraction_digits == ISO8601_MAX_FRACTION_DIGITS) {
+                    return fail(ISO8601_ERROR_FRACTION, position, error, error_position);
+                }
+                fraction = fraction * 10 + (uint32_t)(duration[position] - '0');
+                fraction_digits++;
+                position++;
+            }
+            if (fraction_digits == 0) {
+                return fail(ISO8601_ERROR_DIGIT, position, error, error_position);
+            }
+        }
+
+        if (position == length) {
+            return fail(ISO8601_ERROR_LENGTH, position, error, error_position);
+        }
+        // Units must be given largest first and at most once, and weeks only on their own.
+        unsigned unit = duration_unit(duration[position], time);
+        if (unit == ISO8601_DURATION_UNITS || unit < next_unit ||
+            (result->units & (1u << ISO8601_DURATION_WEEKS)) ||
+            (unit == ISO8601_DURATION_WEEKS && result->units != 0)) {
+            return fail(ISO8601_ERROR_DURATION, position, error, error_position);
+        }
+        result->values[unit] = value;
+        result->units |= (uint8_t)(1u << unit);
+        result->fraction_unit = (uint8_t)unit;
+        next_unit = unit + 1;
+        position++;
+
+        if (fraction_digits != 0) {
+            result->fraction = fraction * fraction_scale[fraction_digits];
+            // A fraction ends the duration: no smaller unit can follow it.
+            if (position != length) {
+                return fail(ISO8601_ERROR_LENGTH, position, error, error_position);
+            }
+        }
+    }
+
+    if (result->units == 0) {
+        return fail(ISO8601_ERROR_LENGTH, length, error, error_position);
+    }
+    return true;
+}
+
+// Parses one side of an interval and moves its error into the interval, with the
+// position counted from the start of the whole string.
+static bool parse_duration_part(const char* part, size_t length, size_t offset, iso8601_interval* result)
+{
+    if (iso8601_parse_duration(part, length, &result->duration)) {
+        return true;
+    }
+    return fail(result->duration.error, offset + result->duration.error_position,
+        &result->error, &result->error_position);
+}
+
+static bool parse_datetime_part(const char* part, size_t length, size_t offset, unsigned accepted_formats,
+    iso8601_datetime* datetime, iso8601_interval* result)
+{
+    if (iso8601_parse_datetime_format(part, length, accepted_formats, datetime)) {
+        return true;
+    }
+    return fail(datetime->error, offset + datetime->error_position, &result->error, &result->error_position);
+}
+
+// Whether end is before start. Both have been parsed, so converting them to UTC seconds
+// cannot overflow; the fractions are already in nanoseconds.
+static bool ends_before_start(const iso8601_datetime* start, const iso8601_datetime* end)
+{
+    int64_t start_seconds = iso8601_parsed_to_unix_seconds(start);
+    int64_t end_seconds = iso8601_parsed_to_unix_seconds(end);
+    return end_seconds < start_seconds || (end_seconds == start_seconds && end->fraction < start->fraction);
+}
+
+static bool parse_interval(const char* interval, size_t length, size_t offset, unsigned accepted_formats,
+    iso8601_interval* result)
+{
+    const char* solidus = memchr(interval, '/', length);
+    if (solidus == NULL) {
+        if (length == 0 || interval[0] != 'P') {
+            return fail(ISO8601_ERROR_INTERVAL, offset + length, &result->error, &result->error_position);
+        }
+        result->form = ISO8601_INTERVAL_DURATION;
+        return parse_duration_part(interval, length, offset, result);
+    }
+
+    size_t first_length = (size_t)(solidus - interval);
+    const char* second = solidus + 1;
+    size_t second_length = length - first_length - 1;
+    size_t second_offset = offset + first_length + 1;
+
+    if (first_length != 0 && interval[0] == 'P') {
+        if (second_length != 0 && second[0] == 'P') {
+            return fail(ISO8601_ERROR_INTERVAL, second_offset, &result->error, &result->error_position);
+        }
+        result->form = ISO8601_INTERVAL_DURATION_END;
+        return parse_duration_part(interval, first_length, offset, result) &&
+            parse_datetime_part(second, second_length, second_offset, accepted_formats, &result->end, result);
+    }
+
+    if (!parse_datetime_part(interval, first_length, offset, accepted_formats, &result->start, result)) {
+        return false;
+    }
+    if (second_length != 0 && second[0] == 'P') {
+        result->form = ISO8601_INTERVAL_START_DURATION;
+        return parse_duration_part(second, second_length, second_offset, result);
+    }
+
+    result->form = ISO8601_INTERVAL_START_END;
+    if (!parse_datetime_part(second, second_length, second_offset, accepted_formats, &result->end, result)) {
+        return false;
+    }
+    if (ends_before_start(&result->start, &result->end)) {
+        return fail(ISO8601_ERROR_ORDER, second_offset, &result->error, &result->error_position);
+    }
+    return true;
+}
+
+bool iso8601_parse_interval(const char* interval, size_t length, unsigned accepted_formats,
+    iso8601_interval* result)
+{
+    result->recurrences = 0;
+    result->error = ISO8601_ERROR_NONE;
+    result->error_position = 0;
+    return parse_interval(interval, length, 0, accepted_formats, result);
+}
+
+bool iso8601_parse_recurring_interval(const char* interval, size_t length, unsigned accepted_formats,
+    iso8601_interval* result)
+{
+    result->recurrences = 0;
+    result->error = ISO8601_ERROR_NONE;
+    result->error_position = 0;
+
+    if (length == 0 || interval[0] != 'R') {
+        return fail(ISO8601_ERROR_RECURRENCE, 0, &result->error, &result->error_position);
+    }
+
+    size_t position = 1;
+    uint32_t recurrences = 0;
+    while (position < length && is_digit(interval[position])) {
+        if (position - 1 == ISO8601_MAX_DURATION_DIGITS) {
+            return fail(ISO8601_ERROR_RECURRENCE, position, &result->error, &result->error_position);
+        }
+        recurrences = recurrences * 10 + (uint32_t)(interval[position] - '0');
+        position++;
+    }
+    if (position == length || interval[position] != '/') {
+        return fail(ISO8601_ERROR_RECURRENCE, position, &result->error, &result->error_position);
+    }
+    result->recurrences = position == 1 ? ISO8601_UNBOUNDED_RECURRENCES : recurrences;
+    position++;
+
+    return parse_interval(interval + position, length - position, position, accepted_formats, result);
+}
+
+// start/end, start/duration or duration/end with any date-time format, or a duration
+// alone: 2024-04-21T12:00:00Z/2024-04-21T13:30:00Z, 2024-04-21T12:00:00Z/PT1H30M, P10D, ...
+bool is_valid_iso8601_datetime_interval(const char* dateTime)
+{
+    iso8601_interval interval;
+    return iso8601_parse_interval(dateTime, strlen(dateTime), ISO8601_ACCEPT_ALL_DATETIMES, &interval);
+}
+
+// Rn/interval or R/interval, with date-times or dates alone: R5/2024-01-01T00:00:00Z/P1DT2H,
+// R/P1W, R5/2024-W01/2024-W10, R3/2024-032/P10D, ...
+bool is_valid_iso8601_recurring_time_interval(const char* dateTime)
+{
+    iso8601_interval interval;
+    return iso8601_parse_recurring_interval(dateTime, strlen(dateTime),
+        ISO8601_ACCEPT_ALL_DATETIMES | ISO8601_ACCEPT_DATE, &interval);
+}
@@ -0,0 +1,172 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "isodatetime_validator.h"
+
+#define SECONDS_PER_DAY 86400
+
+// Layout of the packed key, from the least significant bit:
+// bits 0-10   offset from UTC in minutes (0-1439)
+// bit 11      set for a negative offset
+// bit 12      set when the offset is given as hh:mm, clear for Z
+// bits 13-51  UTC seconds since 1970-01-01T00:00:00Z plus ISO8601_KEY_EPOCH_BIAS
+//             (starting at bit ISO8601_KEY_INSTANT_SHIFT)
+#define KEY_OFFSET_MINUTES_MASK 0x7FFu
+#define KEY_NEGATIVE_OFFSET_BIT (1u << 11)
+#define KEY_NUMERIC_OFFSET_BIT (1u << 12)
+
+static int decode_digits(const char* datetime_str, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        value = value * 10 + (datetime_str[i] - '0');
+    }
+    return value;
+}
+
+static void encode_digits(char* buffer, int value, int count)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        buffer[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar.
+// Closed form without loops over years or calls into the C runtime.
+int64_t iso8601_days_from_civil(int64_t year, int month, int day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t year_of_era = year - era * 400;
+    const int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Inverse of iso8601_days_from_civil.
+static void civil_from_days(int64_t days, int64_t* year, int* month, int* day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t day_of_era = days - era * 146097;
+    const int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const int64_t month_index = (5 * day_of_year + 2) / 153;
+    *day = (int)(day_of_year - (153 * month_index + 2) / 5 + 1);
+    *month = (int)(month_index < 10 ? month_index + 3 : month_index - 9);
+    *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+// Writes YYYY-MM-DDThh:mm:ss for the given seconds since 1970-01-01T00:00:00.
+// Years outside 0000-9999 get a sign and as many digits as they need.
+// Returns the number of characters written.
+static size_t format_date_time(char* buffer, int64_t seconds)
+{
+    int64_t days = seconds >= 0 ? seconds / SECONDS_PER_DAY : (seconds - (SECONDS_PER_DAY - 1)) / SECONDS_PER_DAY;
+    int second_of_day = (int)(seconds - days * SECONDS_PER_DAY);
+    int64_t year;
+    int month, day;
+    civil_from_days(days, &year, &month, &day);
+
+    size_t length = 0;
+    if (year < 0 || year > 9999) {
+        buffer[length++] = year < 0 ? '-' : '+';
+        int64_t magnitude = year < 0 ? -year : year;
+        int digits = 4;
+        for (int64_t limit = 10000; magnitude >= limit; limit *= 10) {
+            digits++;
+        }
+        encode_digits(buffer + length, (int)magnitude, digits);
+        length += digits;
+    }
+    else {
+        encode_digits(buffer, (int)year, 4);
+        length = 4;
+    }
+
+    buffer += length;
+    buffer[0] = '-';
+    encode_digits(buffer + 1, month, 2);
+    buffer[3] = '-';
+    encode_digits(buffer + 4, day, 2);
+    buffer[6] = 'T';
+    encode_digits(buffer + 7, second_of_day / 3600, 2);
+    buffer[9] = ':';
+    encode_digits(buffer + 10, second_of_day / 60 % 60, 2);
+    buffer[12] = ':';
+    encode_digits(buffer + 13, second_of_day % 60, 2);
+    return length + 15;
+}
+
+uint64_t iso8601_datetime_key(const char* datetime_str, size_t length)
+{
+    int64_t days = iso8601_days_from_civil(decode_digits(datetime_str, 4),
+        decode_digits(datetime_str + 5, 2), decode_digits(datetime_str + 8, 2));
+    int64_t seconds = days * SECONDS_PER_DAY + decode_digits(datetime_str + 11, 2) * 3600 +
+        decode_digits(datetime_str + 14, 2) * 60 + decode_digits(datetime_str + 17, 2);
+
+    uint64_t offset_code = 0;
+    if (length == 25) {
+        int offset_minutes = decode_digits(datetime_str + 20, 2) * 60 + decode_digits(datetime_str + 23, 2);
+        offset_code = KEY_NUMERIC_OFFSET_BIT | (uint64_t)offset_minutes;
+        // Local time = UTC + offset
+        if (datetime_str[19] == '-') {
+            offset_code |= KEY_NEGATIVE_OFFSET_BIT;
+            seconds += (int64_t)offset_minutes * 60;
+        }
+        else {
+            seconds -= (int64_t)offset_minutes * 60;
+        }
+    }
+
+    return ((uint64_t)(seconds + ISO8601_KEY_EPOCH_BIAS) << ISO8601_KEY_INSTANT_SHIFT) | offset_code;
+}
+
+size_t iso8601_format_datetime_key(uint64_t key, char* buffer)
+{
+    int64_t seconds = ISO8601_KEY_UNIX_SECONDS(key);
+    int offset_minutes = (int)(key & KEY_OFFSET_MINUTES_MASK);
+    bool numeric_offset = (key & KEY_NUMERIC_OFFSET_BIT) != 0;
+    bool negative_offset = (key & KEY_NEGATIVE_OFFSET_BIT) != 0;
+
+    // Back to the local time of the original string.
+    seconds += (negative_offset ? -60 : 60) * (int64_t)offset_minutes;
+
+    // The local time of a valid key is always within 0000-9999.
+    format_date_time(buffer, seconds);
+
+    if (!numeric_offset) {
+        buffer[19] = 'Z';
+        return 20;
+    }
+    buffer[19] = negative_offset ? '-' : '+';
+    encode_digits(buffer + 20, offset_minutes / 60, 2);
+    buffer[22] = ':';
+    encode_digits(buffer + 23, offset_minutes % 60, 2);
+    return 25;
+}
+
+int64_t iso8601_parsed_to_unix_seconds(const iso8601_datetime* datetime)
+{
+    int64_t days = iso8601_days_from_civil(datetime->year, datetime->month, datetime->day);
+    return days * SECONDS_PER_DAY + datetime->hour * 3600 + datetime->minute * 60 + datetime->second -
+        (int64_t)datetime->offset_minutes * 60;
+}
+
+bool iso8601_datetime_to_unix_seconds(const char* datetime_str, size_t length, int64_t* seconds)
+{
+    iso8601_datetime datetime;
+    if (!iso8601_parse_datetime(datetime_str, length, &datetime)) {
+        return false;
+    }
+    *seconds = iso8601_parsed_to_unix_seconds(&datetime);
+    return true;
+}
+
+size_t iso8601_format_utc(int64_t seconds, char* buffer)
+{
+    size_t length = format_date_time(buffer, seconds);
+    buffer[length] = 'Z';
+    return length + 1;
+}
@@ -0,0 +1,139 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "isodatetime_validator.h"
+
+// Extraction of extended format date-times from free text.
+// Every candidate has a 'T' ten characters after its start and a '-' at the fourth and
+// seventh character, so the text is searched for that anchor pattern only. With SSE2
+// sixteen positions are tested at once by comparing the block against 'T' and the
+// blocks six and three characters before it against '-'; otherwise memchr finds the
+// next 'T'. Each candidate that survives the anchor test is validated by
+// is_valid_iso8601_datetime_n.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ISO8601_SCAN_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Offset of the time designator and of the date separators within a candidate.
+#define ANCHOR_OFFSET 10
+#define FIRST_DASH_DISTANCE 6
+#define SECOND_DASH_DISTANCE 3
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_anchor(const char* text, size_t t)
+{
+    return text[t] == 'T' && text[t - FIRST_DASH_DISTANCE] == '-' && text[t - SECOND_DASH_DISTANCE] == '-';
+}
+
+#ifdef ISO8601_SCAN_SSE2
+static unsigned lowest_bit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// First position t in [from, end) that looks like the 'T' of a candidate, or end.
+// from must be at least ANCHOR_OFFSET.
+static size_t next_anchor(const char* text, size_t from, size_t end)
+{
+    size_t t = from;
+#ifdef ISO8601_SCAN_SSE2
+    const __m128i designator = _mm_set1_epi8('T');
+    const __m128i dash = _mm_set1_epi8('-');
+    for (; t + 16 <= end; t += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + t));
+        __m128i first_dash = _mm_loadu_si128((const __m128i*)(text + t - FIRST_DASH_DISTANCE));
+        __m128i second_dash = _mm_loadu_si128((const __m128i*)(text + t - SECOND_DASH_DISTANCE));
+        __m128i hits = _mm_and_si128(_mm_cmpeq_epi8(block, designator),
+            _mm_and_si128(_mm_cmpeq_epi8(first_dash, dash), _mm_cmpeq_epi8(second_dash, dash)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return t + lowest_bit(mask);
+        }
+    }
+#endif
+    while (t < end) {
+        const char* designator_position = memchr(text + t, 'T', end - t);
+        if (designator_position == NULL) {
+            return end;
+        }
+        t = (size_t)(designator_position - text);
+        if (is_anchor(text, t)) {
+            return t;
+        }
+        t++;
+    }
+    return end;
+}
+
+// Length of the valid date-time starting at start, or 0 if there is none.
+// A candidate directly preceded by a digit is part of a longer number and is not
+// taken; neither is an offset that is directly followed by another digit.
+static size_t match_length(const char* text, size_t size, size_t start)
+{
+    if (start > 0 && is_digit(text[start - 1])) {
+        return 0;
+    }
+
+    const char designator = text[start + 19];
+    if (designator == 'Z') {
+        return is_valid_iso8601_datetime_n(text + start, 20) ? 20 : 0;
+    }
+    if ((designator == '+' || designator == '-') && size - start >= 25 &&
+        (size - start == 25 || !is_digit(text[start + 25])) &&
+        is_valid_iso8601_datetime_n(text + start, 25)) {
+        return 25;
+    }
+    return 0;
+}
+
+size_t iso8601_find_datetimes(const char* text, size_t size, iso8601_record_span* matches,
+    size_t max_matches, size_t* scanned)
+{
+    size_t count = 0;
+    size_t position = 0;
+
+    // The shortest candidate has 20 characters, so its 'T' is at most at size - 10.
+    if (size >= 20) {
+        const size_t end = size - 9;
+        size_t t = ANCHOR_OFFSET;
+        while (count < max_matches) {
+            t = next_anchor(text, t, end);
+            if (t == end) {
+                break;
+            }
+
+            size_t start = t - ANCHOR_OFFSET;
+            size_t length = match_length(text, size, start);
+            if (length == 0) {
+                t++;
+                continue;
+            }
+
+            matches[count].offset = start;
+            matches[count].length = length;
+            count++;
+            position = start + length;
+            t = position + ANCHOR_OFFSET;
+        }
+    }
+
+    *scanned = count == max_matches ? position : size;
+    return count;
+}
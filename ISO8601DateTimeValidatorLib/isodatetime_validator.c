@@ -2,239 +2,757 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <ctype.h>
+#include <stdint.h>
 #include "isodatetime_validator.h"
 
-static bool is_valid_separator(const char* datetime_str)
+// Lookup tables for two digit fields: the value of a field is
+// digit_tens[first character] + digit_ones[second character]. Any character that is
+// not a digit maps to FIELD_INVALID, which pushes the sum above every field's range,
+// so one unsigned compare checks both the digits and the range of a field.
+#define FIELD_INVALID 0xFF
+#define INVALID_16 FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, \
+    FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, \
+    FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, \
+    FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID
+#define INVALID_6 FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID, FIELD_INVALID
+
+static const uint8_t digit_tens[256] = {
+    INVALID_16, INVALID_16, INVALID_16,
+    0, 10, 20, 30, 40, 50, 60, 70, 80, 90, INVALID_6,
+    INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16,
+    INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16
+};
+
+static const uint8_t digit_ones[256] = {
+    INVALID_16, INVALID_16, INVALID_16,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, INVALID_6,
+    INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16,
+    INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16, INVALID_16
+};
+
+// Days per month, indexed by [leap year][month]. Entry 0 only keeps the lookup of an
+// out of range month, clamped to 0, inside the table; it does not reject anything
+// (field_out_of_range(day, 1, 0) is never true), so the month check has to be OR'd in
+// separately.
+static const uint8_t days_in_month[2][13] = {
+    { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 },
+    { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 }
+};
+
+// Value of the two digit field at datetime_str; above 99 if it is not two digits.
+static unsigned field_value(const char* datetime_str)
 {
-    // Extended Format
-    // Date and Time in UTC YYYY-MM-DDTHH:MM:DDZ
-    // Date and Time in with the offset YYYY-MM-DDThh:mm:sshh:mm
-
-    // Separators
-    // character [T] - used as time designator.
-    // hyphen [-] - used as separators within date.
-    // colon [:] - used as separators within time.
+    return (unsigned)digit_tens[(unsigned char)datetime_str[0]] + digit_ones[(unsigned char)datetime_str[1]];
+}
 
-    // Check the position of separators.
-    if (datetime_str[4] != '-' || datetime_str[7] != '-' ||
-        datetime_str[10] != 'T' ||
-        datetime_str[13] != ':' || datetime_str[16] != ':') {
-        return false;
-    }
-    return true;
+// Non-zero if the field is outside [min, max].
+static unsigned field_out_of_range(unsigned value, unsigned min, unsigned max)
+{
+    return value - min > max - min;
+}
 
-    // TO-DO: ISO 8601 uses comma [,] to represent the deciaml fractions. Consider adding them.
+// Gregorian leap year from the two halves of the year. Since 100 is a multiple of
+// 4, the year is divisible by 4 exactly when its last two digits are.
+static unsigned is_leap_year(unsigned century, unsigned year_of_century)
+{
+    return ((year_of_century & 3) == 0) & ((year_of_century != 0) | ((century & 3) == 0));
 }
 
-static bool is_valid_digit(const char* datetime_str, int start, int end) {
-    // Check if each component is a digit
-    for (int i = start; i <= end; i++) {
-        if (!isdigit(datetime_str[i])) {
-            return false;
-        }
-    }
-    return true;
+// Month and day of a fixed width MM-DD at date, checked against the month lengths of
+// a leap or common year. Returns non-zero if either is invalid.
+static inline unsigned decode_month_day(const char* date, unsigned leap, unsigned* month, unsigned* day)
+{
+    // Month: 1-12
+    *month = field_value(date);
+    unsigned month_invalid = field_out_of_range(*month, 1, 12);
+    unsigned invalid = month_invalid | (date[2] != '-');
+
+    // Day: depends on the month and the year.
+    *day = field_value(date + 3);
+    // Clamped only to stay inside days_in_month; month_invalid does the rejecting.
+    unsigned month_index = month_invalid ? 0 : *month;
+    return invalid | field_out_of_range(*day, 1, days_in_month[leap][month_index]);
 }
 
-static bool is_valid_time_zone_designator(const char* datetime_str) {
+// Time of day and zone of a fixed width extended string, starting at its 'T':
+// Thh:mm:ssZ, or Thh:mm:sshh:mm with_offset. Fills the time fields, offset and
+// format of result. Returns non-zero if a field or separator is invalid.
+static inline unsigned decode_extended_time(const char* time, bool with_offset, iso8601_datetime* result)
+{
+    // Time: hh:mm:ss in the range 00:00:00 - 23:59:59
+    unsigned hour = field_value(time + 1);
+    unsigned minute = field_value(time + 4);
+    unsigned second = field_value(time + 7);
+    unsigned invalid = time[0] != 'T';
+    invalid |= field_out_of_range(hour, 0, 23) | (time[3] != ':');
+    invalid |= field_out_of_range(minute, 0, 59) | (time[6] != ':');
+    invalid |= field_out_of_range(second, 0, 59);
+
+    result->hour = (uint8_t)hour;
+    result->minute = (uint8_t)minute;
+    result->second = (uint8_t)second;
+    result->fraction_digits = 0;
+    result->fraction = 0;
+
     // Check timezone designator
     // In UTC Z
     // With offset hh:mm
+    if (!with_offset) {
+        result->offset_minutes = 0;
+        result->format = 0;
+        return invalid | (time[9] != 'Z');
+    }
+
+    unsigned offset_hour = field_value(time + 10);
+    unsigned offset_minute = field_value(time + 13);
+    invalid |= (time[9] != '+') & (time[9] != '-');
+    invalid |= field_out_of_range(offset_hour, 0, 23) | (time[12] != ':');
+    invalid |= field_out_of_range(offset_minute, 0, 59);
 
-    char tzd = (strlen(datetime_str) == 20) ? datetime_str[strlen(datetime_str) - 1] :
-        datetime_str[strlen(datetime_str) - 6];
-    if (tzd != 'Z' && tzd != '+' && tzd != '-') {
+    int offset_minutes = (int)(offset_hour * 60 + offset_minute);
+    result->offset_minutes = (int16_t)(time[9] == '-' ? -offset_minutes : offset_minutes);
+    result->format = ISO8601_FORMAT_OFFSET;
+    return invalid;
+}
+
+// Decodes every field into result while checking it. The checks of all fields are
+// combined into one flag without branching on any of them, so random dates do not
+// cost branch mispredictions. Returns true if the string is valid; the fields of
+// result are only meaningful then. Inlined into both is_valid_iso8601_datetime_n,
+// where the unused stores are dropped, and iso8601_parse_datetime.
+static inline bool decode_extended_datetime(const char* datetime_str, size_t length, iso8601_datetime* result)
+{
+    if (length != 20 && length != 25) {
         return false;
     }
 
-    // Check timezone offset format.
-    if (tzd != 'Z') {
-        if (!isdigit(datetime_str[strlen(datetime_str) - 5]) || !isdigit(datetime_str[strlen(datetime_str) - 4]) ||
-            datetime_str[strlen(datetime_str) - 3] != ':' || !isdigit(datetime_str[strlen(datetime_str) - 2]) ||
-            !isdigit(datetime_str[strlen(datetime_str) - 1])) {
-            return false;
+    // Year: 0000-9999
+    unsigned century = field_value(datetime_str);
+    unsigned year_of_century = field_value(datetime_str + 2);
+    unsigned invalid = field_out_of_range(century, 0, 99) | field_out_of_range(year_of_century, 0, 99);
+    invalid |= datetime_str[4] != '-';
+
+    unsigned month, day;
+    invalid |= decode_month_day(datetime_str + 5, is_leap_year(century, year_of_century), &month, &day);
+    invalid |= decode_extended_time(datetime_str + 10, length == 25, result);
+
+    result->year = (int32_t)(century * 100 + year_of_century);
+    result->month = (uint8_t)month;
+    result->day = (uint8_t)day;
+    return !invalid;
+}
+
+// Function to validate the extended format of date-time string in ISO 8601.
+// Extended Format
+// Date and Time in UTC YYYY-MM-DDThh:mm:ssZ              (20 characters)
+// Date and Time in with the offset YYYY-MM-DDThh:mm:sshh:mm  (25 characters)
+//
+// The string is validated in a single forward pass: every separator is checked
+// at its fixed position and every field is decoded exactly once, with its digit
+// and range checks done together.
+//
+// The basic format, decimal fractions and reduced precision times (hhmmss, hhmm,mZ,
+// hh:mm,mZ, hhmmhhmm, hh:mmhh:mm), ordinal dates (YYYY-DDD, YYYYYY-DDD), week
+// dates (YYYY-Www-D) and expanded years are handled by iso8601_parse_datetime_format.
+// Week dates reduced to the week are parsed by iso8601_parse_datetime_format with ISO8601_ACCEPT_DATE.
+bool is_valid_iso8601_datetime_n(const char* datetime_str, size_t length)
+{
+    iso8601_datetime fields;
+    return decode_extended_datetime(datetime_str, length, &fields);
+}
+
+static bool parse_error(iso8601_datetime* result, iso8601_error error, size_t position)
+{
+    result->error = error;
+    result->error_position = (uint32_t)position;
+    return false;
+}
+
+// Reports a missing character as a length error at the end of the string.
+static bool expect_digits(const char* datetime_str, size_t length, size_t position, size_t count, iso8601_datetime* result)
+{
+    for (size_t i = position; i < position + count; i++) {
+        if (i >= length) {
+            return parse_error(result, ISO8601_ERROR_LENGTH, length);
+        }
+        if (datetime_str[i] < '0' || datetime_str[i] > '9') {
+            return parse_error(result, ISO8601_ERROR_DIGIT, i);
         }
     }
-   
-    // Check if the timezone offset is not present when 'Z' is used
-    // YYYY-MM-DDTHH:MM:SSZHH:MM - Invalid
-    if (tzd == 'Z' && strlen(datetime_str) > 20) {
-        return false;
-    }
+    return true;
+}
 
+static bool expect_separator(const char* datetime_str, size_t length, size_t position, char separator, iso8601_datetime* result)
+{
+    if (position >= length) {
+        return parse_error(result, ISO8601_ERROR_LENGTH, length);
+    }
+    if (datetime_str[position] != separator) {
+        return parse_error(result, ISO8601_ERROR_SEPARATOR, position);
+    }
     return true;
 }
 
-static bool is_leap_year(const int year)
+// Checks the two digit field at position, reporting error there if it is out of range.
+static bool expect_field(const char* datetime_str, size_t length, size_t position, unsigned min, unsigned max,
+    iso8601_error error, iso8601_datetime* result)
 {
-    return (year % 4 == 0 && year % 100 != 0) && (year % 400 == 0);
+    if (!expect_digits(datetime_str, length, position, 2, result)) {
+        return false;
+    }
+    if (field_out_of_range(field_value(datetime_str + position), min, max)) {
+        return parse_error(result, error, position);
+    }
+    return true;
 }
 
-static bool is_valid_date(const char* datetime_str)
+static bool is_digit(char c)
 {
-    // Year: 0000-9999
-    // Month: 1-12
-    // Day: 1-31 (varies with month).
-    int year = atoi(datetime_str);
-    int month = atoi(datetime_str + 5);
-    int day = atoi(datetime_str + 8);
+    return c >= '0' && c <= '9';
+}
 
-    // check If month is between 1 to 12.
-    if (month < 1 || month > 12) return false;
+// Powers of ten scaling a fraction of n digits to nanoseconds.
+static const uint32_t fraction_scale[10] = {
+    1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+};
+
+// Days before the first of each month, indexed by [leap year][month]; entry 13 is the
+// length of the year.
+static const uint16_t days_before_month[2][14] = {
+    { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+    { 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+// Gregorian leap year of any year, including the negative years of the expanded
+// representation.
+static unsigned is_leap_year_of(int64_t year)
+{
+    return (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+}
 
-    // check valid day.
-    if (day < 1) return false;
+// Day of the week of the 31st of December of the year 100 * century + year_of_century:
+// 0 for Sunday to 6 for Saturday. (y + y/4 - y/100 + y/400) mod 7, where y/4 is
+// 25 * century + year_of_century/4 and 100 + 25 - 1 = 124 is 5 modulo 7.
+static unsigned weekday_of_december_31(unsigned century, unsigned year_of_century)
+{
+    return (5 * century + century / 4 + year_of_century + year_of_century / 4) % 7;
+}
 
-    switch (month)
-    {
-    case 2:
-        if (is_leap_year(year))
-        {
-            if (day > 29) return false;
-        }
-        else
-        {
-            if (day > 28) return false;
-        }
-        break;
-    case 4:
-    case 6:
-    case 9:
-    case 11:
-        if (day > 30) return false;
-        break;
-    default:
-        if (day > 31) return false;
-        break;
-    }
-    return true;
+// The same for any year. The calendar repeats every 400 years, which are exactly
+// 20871 weeks, so the year is taken modulo 400.
+static unsigned weekday_of_december_31_of(int64_t year)
+{
+    int64_t remainder = year % 400;
+    unsigned y = (unsigned)(remainder < 0 ? remainder + 400 : remainder);
+    return weekday_of_december_31(y / 100, y % 100);
 }
 
+// Day of the week of the 31st of December of the year before. A year moves the
+// weekday on by one day, or by two in leap years.
+static unsigned weekday_of_previous_december_31(unsigned weekday_of_december_31, unsigned leap)
+{
+    return (weekday_of_december_31 + 6 - leap) % 7;
+}
 
-// function to check the valid time range [0-23]
-static bool is_valid_time(const char* datetime_str)
+// A year has 53 weeks when it starts or ends on a Thursday, that is when it ends on
+// a Thursday or the year before ends on a Wednesday.
+static unsigned weeks_in_year(unsigned weekday_of_december_31, unsigned weekday_of_previous_december_31)
 {
-    int hour = atoi(datetime_str + 11);
-    int minute = atoi(datetime_str + 14);
-    int second = atoi(datetime_str + 17);
+    return 52 + ((weekday_of_december_31 == 4) | (weekday_of_previous_december_31 == 3));
+}
 
-    if (hour < 0 || hour > 23
-        || minute < 0 || minute > 59
-        || second < 0 || second > 59)
-    {
-        return false;
-    }
-    return true;
+unsigned iso8601_weeks_in_year(int64_t year)
+{
+    unsigned last_day = weekday_of_december_31_of(year);
+    return weeks_in_year(last_day, weekday_of_previous_december_31(last_day, is_leap_year_of(year)));
 }
 
-static bool is_valid_time_offset(const char* datetime_str)
+// Month and day of the day of the year ordinal (1-366). Months have at most 31
+// days, so (ordinal - 1) / 31 + 1 is the month or the one before it.
+static void month_day_from_ordinal(unsigned ordinal, unsigned leap, unsigned* month, unsigned* day)
 {
-    //YYYY - MM - DDThh:mm:sshh:mm
-    if (strlen(datetime_str) > 20)
-    {
-        int hour = atoi(datetime_str + 20);
-        int minute = atoi(datetime_str + 23);
+    unsigned m = (ordinal - 1) / 31 + 1;
+    m += ordinal > days_before_month[leap][m + 1];
+    *month = m;
+    *day = ordinal - days_before_month[leap][m];
+}
 
-        if (hour < 0 || hour > 23
-            || minute < 0 || minute > 59)
-        {
-            return false;
-        }
+// Calendar date of the valid week date week-weekday of *year, whose leap flag and
+// weekday of the 31st of December of the year before are given. Week 1 is the week
+// with the 4th of January, so the date can fall into the year before or after;
+// *year is updated then.
+static void week_date_to_calendar(int64_t* year, unsigned leap, unsigned weekday_of_previous_december_31,
+    unsigned week, unsigned weekday, unsigned* month, unsigned* day)
+{
+    // Weekday of the 4th of January, 1 for Monday to 7 for Sunday.
+    unsigned weekday_of_january_4 = (weekday_of_previous_december_31 + 3) % 7 + 1;
+    int ordinal = (int)(7 * week + weekday) - (int)(weekday_of_january_4 + 3);
+    if (ordinal < 1) {
+        (*year)--;
+        leap = is_leap_year_of(*year);
+        ordinal += 365 + (int)leap;
     }
-    return true;
+    else if (ordinal > 365 + (int)leap) {
+        ordinal -= 365 + (int)leap;
+        (*year)++;
+        leap = is_leap_year_of(*year);
+    }
+    month_day_from_ordinal((unsigned)ordinal, leap, month, day);
 }
 
-// This function only check format- YYYY-MM-DD
-// TODO: extend to include other supported date format as per ISO8601
-// YYYYMMDD
-// YYYYYYDDD
-// YYYYYY-DDD
-// YYYYWww
-// YYYY-Www 
-static bool is_valid_date_format(const char* datetime_str)
+// Fixed width fast paths of the other extended notations, branch free up to the
+// conversion of the date like decode_extended_datetime.
+
+// YYYY-DDDThh:mm:ssZ (18 characters) or YYYY-DDDThh:mm:sshh:mm (23 characters).
+static bool decode_extended_ordinal_datetime(const char* datetime_str, size_t length, iso8601_datetime* result)
 {
-    if (!is_valid_digit(datetime_str, 0, 3) || // Year
-        !is_valid_digit(datetime_str, 5, 6) || // Month
-        !is_valid_digit(datetime_str, 8, 9)) { // Day
+    unsigned century = field_value(datetime_str);
+    unsigned year_of_century = field_value(datetime_str + 2);
+    unsigned invalid = field_out_of_range(century, 0, 99) | field_out_of_range(year_of_century, 0, 99);
+    invalid |= datetime_str[4] != '-';
+
+    // Day of the year: 1-365, or 1-366 in leap years. Its last two digits are checked
+    // on their own, since an invalid field does not push the sum above 366.
+    const unsigned leap = is_leap_year(century, year_of_century);
+    unsigned day_of_year_tail = field_value(datetime_str + 6);
+    unsigned ordinal = digit_ones[(unsigned char)datetime_str[5]] * 100u + day_of_year_tail;
+    invalid |= field_out_of_range(day_of_year_tail, 0, 99) | field_out_of_range(ordinal, 1, 365 + leap);
+    invalid |= decode_extended_time(datetime_str + 8, length == 23, result);
+    if (invalid) {
         return false;
     }
+
+    unsigned month, day;
+    month_day_from_ordinal(ordinal, leap, &month, &day);
+    result->year = (int32_t)(century * 100 + year_of_century);
+    result->month = (uint8_t)month;
+    result->day = (uint8_t)day;
+    result->format |= ISO8601_FORMAT_ORDINAL;
     return true;
 }
 
-// This function only checks format- hh:mm:ss
-// TODO: below are the list of other time format supported in ISO8601
-// hhmmss
-// hhmm,mZ
-// hh:mm,mZ
-// hhmmhhmm
-// hh:mmhh:mm
-// consider adding logic for other time formats as well.
-static bool is_valid_time_format(const char* datetime_str)
+// YYYY-Www-DThh:mm:ssZ (20 characters) or YYYY-Www-DThh:mm:sshh:mm (25 characters).
+static bool decode_extended_week_datetime(const char* datetime_str, size_t length, iso8601_datetime* result)
 {
-    if (!is_valid_digit(datetime_str, 11, 12) || // Hour
-        !is_valid_digit(datetime_str, 14, 15) || // Minute
-        !is_valid_digit(datetime_str, 17, 18)) { // Second
+    unsigned century = field_value(datetime_str);
+    unsigned year_of_century = field_value(datetime_str + 2);
+    unsigned invalid = field_out_of_range(century, 0, 99) | field_out_of_range(year_of_century, 0, 99);
+    invalid |= (datetime_str[4] != '-') | (datetime_str[5] != 'W') | (datetime_str[8] != '-');
+
+    // Week: 1-52, or 1-53 in long years. Day of the week: 1-7.
+    int64_t year = century * 100 + year_of_century;
+    const unsigned leap = is_leap_year(century, year_of_century);
+    const unsigned last_day = weekday_of_december_31(century, year_of_century);
+    const unsigned previous_last_day = weekday_of_previous_december_31(last_day, leap);
+    unsigned week = field_value(datetime_str + 6);
+    unsigned weekday = digit_ones[(unsigned char)datetime_str[9]];
+    invalid |= field_out_of_range(week, 1, weeks_in_year(last_day, previous_last_day)) | field_out_of_range(weekday, 1, 7);
+    invalid |= decode_extended_time(datetime_str + 10, length == 25, result);
+    if (invalid) {
         return false;
     }
+
+    unsigned month, day;
+    week_date_to_calendar(&year, leap, previous_last_day, week, weekday, &month, &day);
+    result->year = (int32_t)year;
+    result->month = (uint8_t)month;
+    result->day = (uint8_t)day;
+    result->format |= ISO8601_FORMAT_WEEK;
     return true;
 }
 
-// Function to validate the extended format of date-time string in ISO 8601.
-bool is_valid_iso8601_datetime(const char* datetime_str) {
-    if (strlen(datetime_str) < 20 || strlen(datetime_str) > 25) {
+// YYYYYY-MM-DDThh:mm:ssZ (23 characters) or YYYYYY-MM-DDThh:mm:sshh:mm (28 characters).
+static bool decode_expanded_datetime(const char* datetime_str, size_t length, iso8601_datetime* result)
+{
+    // The year is split at its last two digits like a four digit year; the leap year
+    // rule is the same for negative years.
+    unsigned millennia = field_value(datetime_str + 1);
+    unsigned centuries = field_value(datetime_str + 3);
+    unsigned year_of_century = field_value(datetime_str + 5);
+    unsigned invalid = field_out_of_range(millennia, 0, 99) | field_out_of_range(centuries, 0, 99) |
+        field_out_of_range(year_of_century, 0, 99);
+    invalid |= datetime_str[7] != '-';
+    unsigned high = millennia * 100 + centuries;
+
+    unsigned month, day;
+    invalid |= decode_month_day(datetime_str + 8, is_leap_year(high, year_of_century), &month, &day);
+    invalid |= decode_extended_time(datetime_str + 13, length == 28, result);
+
+    int32_t year = (int32_t)(high * 100 + year_of_century);
+    result->year = datetime_str[0] == '-' ? -year : year;
+    result->month = (uint8_t)month;
+    result->day = (uint8_t)day;
+    result->format |= ISO8601_FORMAT_EXPANDED;
+    return !invalid;
+}
+
+// Sequential parser for every format selected by accepted_formats.
+// Parses the formats that the fixed width fast path does not cover, and finds the
+// first problem of a string that the fast path rejected, in the order of the
+// characters. With ISO8601_ACCEPT_EXTENDED alone it accepts exactly the strings
+// decode_extended_datetime accepts.
+static bool parse_datetime_fields(const char* datetime_str, size_t length, unsigned accepted_formats,
+    iso8601_datetime* result)
+{
+    // Year: YYYY, or YYYYYY when expanded.
+    unsigned format = 0;
+    int64_t year;
+    size_t position;
+    if (length > 0 && (datetime_str[0] == '+' || datetime_str[0] == '-')) {
+        if (!(accepted_formats & ISO8601_ACCEPT_EXPANDED)) {
+            return parse_error(result, ISO8601_ERROR_FORMAT, 0);
+        }
+        if (!expect_digits(datetime_str, length, 1, ISO8601_EXPANDED_YEAR_DIGITS, result)) {
+            return false;
+        }
+        year = (int64_t)field_value(datetime_str + 1) * 10000 + field_value(datetime_str + 3) * 100 + field_value(datetime_str + 5);
+        if (datetime_str[0] == '-') {
+            year = -year;
+        }
+        position = 1 + ISO8601_EXPANDED_YEAR_DIGITS;
+        format |= ISO8601_FORMAT_EXPANDED;
+    }
+    else {
+        if (!expect_digits(datetime_str, length, 0, 4, result)) {
+            return false;
+        }
+        year = field_value(datetime_str) * 100 + field_value(datetime_str + 2);
+        position = 4;
+    }
+    const unsigned leap = is_leap_year_of(year);
+
+    // The character after the year tells the notation: '-' for extended, a digit or
+    // the week designator for basic.
+    const bool basic = position < length && (is_digit(datetime_str[position]) || datetime_str[position] == 'W');
+    if (basic ? !(accepted_formats & ISO8601_ACCEPT_BASIC) :
+        !(accepted_formats & ISO8601_ACCEPT_EXTENDED) && position < length && datetime_str[position] == '-') {
+        return parse_error(result, ISO8601_ERROR_FORMAT, position);
+    }
+    if (basic) {
+        format |= ISO8601_FORMAT_BASIC;
+    }
+    else if (!expect_separator(datetime_str, length, position++, '-', result)) {
         return false;
     }
 
-    if (!is_valid_separator(datetime_str)) {
-        return false;
+    // Then a week date (Www-D), an ordinal date (DDD) or a calendar date (MM-DD),
+    // told apart by the week designator and by where the digits stop.
+    unsigned month;
+    unsigned day;
+    if (position < length && datetime_str[position] == 'W') {
+        if (!(accepted_formats & ISO8601_ACCEPT_WEEK)) {
+            return parse_error(result, ISO8601_ERROR_FORMAT, position);
+        }
+        position++;
+        const unsigned last_day = weekday_of_december_31_of(year);
+        const unsigned previous_last_day = weekday_of_previous_december_31(last_day, leap);
+        if (!expect_field(datetime_str, length, position, 1, weeks_in_year(last_day, previous_last_day), ISO8601_ERROR_WEEK, result)) {
+            return false;
+        }
+        unsigned week = field_value(datetime_str + position);
+        position += 2;
+
+        // A date alone may stop at the week, which then stands for its Monday.
+        unsigned weekday = 1;
+        if (!(accepted_formats & ISO8601_ACCEPT_DATE) || position != length) {
+            if (!basic && !expect_separator(datetime_str, length, position++, '-', result)) {
+                return false;
+            }
+            if (!expect_digits(datetime_str, length, position, 1, result)) {
+                return false;
+            }
+            weekday = (unsigned)(datetime_str[position] - '0');
+            if (field_out_of_range(weekday, 1, 7)) {
+                return parse_error(result, ISO8601_ERROR_WEEKDAY, position);
+            }
+            position++;
+        }
+
+        week_date_to_calendar(&year, leap, previous_last_day, week, weekday, &month, &day);
+        format |= ISO8601_FORMAT_WEEK;
+    }
+    else if (basic ? (position + 3 < length && datetime_str[position + 3] == 'T') ||
+            ((accepted_formats & ISO8601_ACCEPT_DATE) && position + 3 == length) :
+        position + 2 < length && is_digit(datetime_str[position + 2])) {
+        if (!(accepted_formats & ISO8601_ACCEPT_ORDINAL)) {
+            return parse_error(result, ISO8601_ERROR_FORMAT, position);
+        }
+        if (!expect_digits(datetime_str, length, position, 3, result)) {
+            return false;
+        }
+        unsigned ordinal = (unsigned)(datetime_str[position] - '0') * 100 + field_value(datetime_str + position + 1);
+        if (field_out_of_range(ordinal, 1, 365 + leap)) {
+            return parse_error(result, ISO8601_ERROR_DAY, position);
+        }
+        position += 3;
+        month_day_from_ordinal(ordinal, leap, &month, &day);
+        format |= ISO8601_FORMAT_ORDINAL;
+    }
+    else {
+        if (!expect_field(datetime_str, length, position, 1, 12, ISO8601_ERROR_MONTH, result)) {
+            return false;
+        }
+        month = field_value(datetime_str + position);
+        position += 2;
+        if (!basic && !expect_separator(datetime_str, length, position++, '-', result)) {
+            return false;
+        }
+        if (!expect_field(datetime_str, length, position, 1, days_in_month[leap][month], ISO8601_ERROR_DAY, result)) {
+            return false;
+        }
+        day = field_value(datetime_str + position);
+        position += 2;
     }
 
-    
-    if (!is_valid_date_format(datetime_str)
-        || !is_valid_time_format(datetime_str)) {
-        return false;
+    // A date alone stands for the start of the day in UTC.
+    if ((accepted_formats & ISO8601_ACCEPT_DATE) && position == length) {
+        result->year = (int32_t)year;
+        result->month = (uint8_t)month;
+        result->day = (uint8_t)day;
+        result->hour = 0;
+        result->minute = 0;
+        result->second = 0;
+        result->fraction_digits = 0;
+        result->fraction = 0;
+        result->offset_minutes = 0;
+        result->format = (uint16_t)(format | ISO8601_FORMAT_DATE);
+        result->error = ISO8601_ERROR_NONE;
+        result->error_position = 0;
+        return true;
     }
 
-    if (!is_valid_time_zone_designator(datetime_str)) {
+    if (!expect_separator(datetime_str, length, position++, 'T', result) ||
+        !expect_field(datetime_str, length, position, 0, 23, ISO8601_ERROR_HOUR, result)) {
         return false;
     }
-
-    if (!is_valid_date(datetime_str)) {
+    unsigned hour = field_value(datetime_str + position);
+    position += 2;
+    if (!basic && !expect_separator(datetime_str, length, position++, ':', result)) {
         return false;
     }
-
-    if (!is_valid_time(datetime_str)) {
+    if (!expect_field(datetime_str, length, position, 0, 59, ISO8601_ERROR_MINUTE, result)) {
         return false;
     }
+    unsigned minute = field_value(datetime_str + position);
+    position += 2;
+
+    // Reduced precision: the seconds are left out and a fraction belongs to the minute.
+    unsigned second = 0;
+    const bool has_seconds = position < length && (basic ? is_digit(datetime_str[position]) : datetime_str[position] == ':');
+    if (has_seconds || !(accepted_formats & ISO8601_ACCEPT_REDUCED)) {
+        if (!basic && !expect_separator(datetime_str, length, position++, ':', result)) {
+            return false;
+        }
+        if (!expect_field(datetime_str, length, position, 0, 59, ISO8601_ERROR_SECOND, result)) {
+            return false;
+        }
+        second = field_value(datetime_str + position);
+        position += 2;
+    }
+    else {
+        format |= ISO8601_FORMAT_REDUCED;
+    }
 
-    if (!is_valid_time_offset(datetime_str)) {
-        return false;
+    // Decimal fraction of the last time unit, with a comma or a full stop.
+    uint32_t fraction = 0;
+    unsigned fraction_digits = 0;
+    if (position < length && (datetime_str[position] == '.' || datetime_str[position] == ',')) {
+        if (!(accepted_formats & ISO8601_ACCEPT_FRACTION)) {
+            return parse_error(result, ISO8601_ERROR_FORMAT, position);
+        }
+        if (datetime_str[position] == ',') {
+            format |= ISO8601_FORMAT_COMMA;
+        }
+        position++;
+        while (position < length && is_digit(datetime_str[position])) {
+            if (fraction_digits == ISO8601_MAX_FRACTION_DIGITS) {
+                return parse_error(result, ISO8601_ERROR_FRACTION, position);
+            }
+            fraction = fraction * 10 + (uint32_t)(datetime_str[position] - '0');
+            fraction_digits++;
+            position++;
+        }
+        if (fraction_digits == 0 && !expect_digits(datetime_str, length, position, 1, result)) {
+            return false;
+        }
+        fraction *= fraction_scale[fraction_digits];
     }
+
+    // Timezone designator: Z, or hh:mm (hhmm in basic format).
+    int offset_minutes = 0;
+    if (position >= length) {
+        return parse_error(result, ISO8601_ERROR_LENGTH, length);
+    }
+    if (datetime_str[position] == 'Z') {
+        position++;
+    }
+    else if (datetime_str[position] == '+' || datetime_str[position] == '-') {
+        const bool negative = datetime_str[position++] == '-';
+        if (!expect_field(datetime_str, length, position, 0, 23, ISO8601_ERROR_OFFSET_HOUR, result)) {
+            return false;
+        }
+        offset_minutes = (int)field_value(datetime_str + position) * 60;
+        position += 2;
+        if (!basic && !expect_separator(datetime_str, length, position++, ':', result)) {
+            return false;
+        }
+        if (!expect_field(datetime_str, length, position, 0, 59, ISO8601_ERROR_OFFSET_MINUTE, result)) {
+            return false;
+        }
+        offset_minutes += (int)field_value(datetime_str + position);
+        position += 2;
+        if (negative) {
+            offset_minutes = -offset_minutes;
+        }
+        format |= ISO8601_FORMAT_OFFSET;
+    }
+    else {
+        return parse_error(result, ISO8601_ERROR_DESIGNATOR, position);
+    }
+    if (position != length) {
+        return parse_error(result, ISO8601_ERROR_LENGTH, position);
+    }
+
+    if (format & ISO8601_FORMAT_REDUCED) {
+        // The fraction is a fraction of the minute.
+        uint64_t nanoseconds = (uint64_t)fraction * 60;
+        second = (unsigned)(nanoseconds / 1000000000u);
+        fraction = (uint32_t)(nanoseconds % 1000000000u);
+    }
+
+    result->year = (int32_t)year;
+    result->month = (uint8_t)month;
+    result->day = (uint8_t)day;
+    result->hour = (uint8_t)hour;
+    result->minute = (uint8_t)minute;
+    result->second = (uint8_t)second;
+    result->fraction_digits = (uint8_t)fraction_digits;
+    result->fraction = fraction;
+    result->offset_minutes = (int16_t)offset_minutes;
+    result->format = (uint16_t)format;
+    result->error = ISO8601_ERROR_NONE;
+    result->error_position = 0;
     return true;
 }
 
+bool iso8601_parse_datetime_format(const char* datetime_str, size_t length, unsigned accepted_formats,
+    iso8601_datetime* result)
+{
+    // Fixed width extended strings, the bulk of the input, take the branch free paths,
+    // told apart by a sign, their length and the week designator.
+    bool decoded = false;
+    if (accepted_formats & ISO8601_ACCEPT_EXTENDED) {
+        // Signs and the lengths with and without offset are compared with | rather than
+        // ||, so a mix of both does not cost a branch misprediction each.
+        if (length > 0 && ((datetime_str[0] == '+') | (datetime_str[0] == '-'))) {
+            decoded = (accepted_formats & ISO8601_ACCEPT_EXPANDED) && ((length == 23) | (length == 28)) &&
+                decode_expanded_datetime(datetime_str, length, result);
+        }
+        else if ((length == 18) | (length == 23)) {
+            decoded = (accepted_formats & ISO8601_ACCEPT_ORDINAL) && decode_extended_ordinal_datetime(datetime_str, length, result);
+        }
+        else if (length > 5 && datetime_str[5] == 'W') {
+            decoded = (accepted_formats & ISO8601_ACCEPT_WEEK) && ((length == 20) | (length == 25)) &&
+                decode_extended_week_datetime(datetime_str, length, result);
+        }
+        else {
+            decoded = decode_extended_datetime(datetime_str, length, result);
+        }
+    }
+    if (decoded) {
+        result->error = ISO8601_ERROR_NONE;
+        result->error_position = 0;
+        return true;
+    }
+    return parse_datetime_fields(datetime_str, length, accepted_formats, result);
+}
 
-// TO-DO: Implement this API to support the validation of basic ISO8601 date time format.
-bool is_valid_basic_iso8601_datetime_format(const char* dateTime)
+bool iso8601_parse_datetime(const char* datetime_str, size_t length, iso8601_datetime* result)
 {
-    return false;
+    return iso8601_parse_datetime_format(datetime_str, length, ISO8601_ACCEPT_EXTENDED, result);
 }
 
-// TO-DO: Implement this API to support the validation of ISO8601 date time interval.
-bool is_valid_iso8601_datetime_interval(const char* dateTime)
+bool is_valid_iso8601_datetime_format(const char* datetime_str, size_t length, unsigned accepted_formats)
 {
-    return false;
+    if (accepted_formats == ISO8601_ACCEPT_EXTENDED) {
+        return is_valid_iso8601_datetime_n(datetime_str, length);
+    }
+    iso8601_datetime fields;
+    return iso8601_parse_datetime_format(datetime_str, length, accepted_formats, &fields);
 }
 
-// TO-DO: Implement this API to support the validation of ISO8601 recurring date time interval.
-bool is_valid_iso8601_recurring_time_interval(const char* dateTime)
+const char* iso8601_error_message(iso8601_error error)
 {
-    return false;
+    switch (error)
+    {
+    case ISO8601_ERROR_NONE:
+        return "valid";
+    case ISO8601_ERROR_LENGTH:
+        return "unexpected length";
+    case ISO8601_ERROR_DIGIT:
+        return "digit expected";
+    case ISO8601_ERROR_SEPARATOR:
+        return "separator expected";
+    case ISO8601_ERROR_DESIGNATOR:
+        return "'Z', '+' or '-' expected";
+    case ISO8601_ERROR_MONTH:
+        return "month out of range";
+    case ISO8601_ERROR_DAY:
+        return "day out of range";
+    case ISO8601_ERROR_HOUR:
+        return "hour out of range";
+    case ISO8601_ERROR_MINUTE:
+        return "minute out of range";
+    case ISO8601_ERROR_SECOND:
+        return "second out of range";
+    case ISO8601_ERROR_OFFSET_HOUR:
+        return "offset hour out of range";
+    case ISO8601_ERROR_OFFSET_MINUTE:
+        return "offset minute out of range";
+    case ISO8601_ERROR_FRACTION:
+        return "fraction longer than 9 digits";
+    case ISO8601_ERROR_WEEK:
+        return "week out of range";
+    case ISO8601_ERROR_WEEKDAY:
+        return "day of the week out of range";
+    case ISO8601_ERROR_FORMAT:
+        return "format not accepted";
+    case ISO8601_ERROR_DURATION:
+        return "duration designator expected";
+    case ISO8601_ERROR_INTERVAL:
+        return "'/' expected";
+    case ISO8601_ERROR_ORDER:
+        return "interval ends before it starts";
+    case ISO8601_ERROR_RECURRENCE:
+        return "'R' and number of recurrences expected";
+    default:
+        return "unknown error";
+    }
 }
 
-// TO-DO: Implement this API to support the validation of expanded ISO8601 date time format.
+bool is_valid_iso8601_datetime(const char* datetime_str)
+{
+    // Only the lengths 20 and 25 can be valid, so there is no need to scan
+    // past MAX_DATETIME_LENGTH characters to find the terminator.
+    size_t length = 0;
+    while (length <= MAX_DATETIME_LENGTH && datetime_str[length] != '\0') {
+        length++;
+    }
+    return is_valid_iso8601_datetime_n(datetime_str, length);
+}
+
+
+// Basic format, optionally with a decimal fraction or without seconds:
+// YYYYMMDDThhmmss[,f]Z, YYYYMMDDThhmmss[,f]hhmm, YYYYMMDDThhmm[,f]Z, ...
+bool is_valid_basic_iso8601_datetime_format(const char* dateTime)
+{
+    return is_valid_iso8601_datetime_format(dateTime, strlen(dateTime),
+        ISO8601_ACCEPT_BASIC | ISO8601_ACCEPT_FRACTION | ISO8601_ACCEPT_REDUCED);
+}
+
+// Every date-time format, including ordinal dates, week dates and years expanded to
+// YYYYYY: +012024-04-21T12:34:56Z, 2024-112T12:34:56Z, 2024-W16-7T12:34:56Z, ...
 bool is_valid_expanded_iso8601_datetime(const char* dateTime)
 {
-    return false;
+    return is_valid_iso8601_datetime_format(dateTime, strlen(dateTime), ISO8601_ACCEPT_ALL_DATETIMES);
 }
\ No newline at end of file
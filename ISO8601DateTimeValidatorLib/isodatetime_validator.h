@@ -2,8 +2,19 @@
 #ifndef ISODATETIME_VALIDATOR
 #define ISODATETIME_VALIDATOR
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define MAX_DATETIME_LENGTH 25 
 
+// Number of records validated per call of iso8601_validate_chunk by the processor.
+#define ISO8601_CHUNK_RECORDS 1024
+
+// Number of 64 bit words needed for a bitmap of n records, and the bit of record i.
+#define ISO8601_BITMAP_WORDS(n) (((n) + 63) / 64)
+#define ISO8601_BITMAP_TEST(bitmap, i) ((((bitmap)[(i) >> 6]) >> ((i) & 63)) & 1u)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,60 +24,366 @@ extern "C" {
 	// Date and Time in with the offset YYYY-MM-DDThh:mm:sshh:mm
 	bool is_valid_iso8601_datetime(const char* dateTime);
 
+	// Same as is_valid_iso8601_datetime for a string of known length.
+	// The string does not have to be NUL terminated, so records can be validated
+	// in place inside a larger buffer. Validation is done in a single pass.
+	bool is_valid_iso8601_datetime_n(const char* dateTime, size_t length);
+
+	// Reason iso8601_parse_datetime rejected a string.
+	typedef enum iso8601_error
+	{
+		ISO8601_ERROR_NONE = 0,
+		ISO8601_ERROR_LENGTH,        // The string ends early or has extra characters.
+		ISO8601_ERROR_DIGIT,         // A digit was expected.
+		ISO8601_ERROR_SEPARATOR,     // '-', 'T' or ':' was expected.
+		ISO8601_ERROR_DESIGNATOR,    // 'Z', '+' or '-' was expected after the time.
+		ISO8601_ERROR_MONTH,         // Month outside 01-12.
+		ISO8601_ERROR_DAY,           // Day outside the month or the year, including the 29th of February of common years.
+		ISO8601_ERROR_HOUR,          // Hour outside 00-23.
+		ISO8601_ERROR_MINUTE,        // Minute outside 00-59.
+		ISO8601_ERROR_SECOND,        // Second outside 00-59.
+		ISO8601_ERROR_OFFSET_HOUR,   // Offset hour outside 00-23.
+		ISO8601_ERROR_OFFSET_MINUTE, // Offset minute outside 00-59.
+		ISO8601_ERROR_FRACTION,      // Decimal fraction with more than ISO8601_MAX_FRACTION_DIGITS digits.
+		ISO8601_ERROR_FORMAT,        // A valid notation that is not among the accepted formats.
+		ISO8601_ERROR_WEEK,          // Week outside 01-52, or 01-53 in years with 53 weeks.
+		ISO8601_ERROR_WEEKDAY,       // Day of the week outside 1-7.
+		ISO8601_ERROR_DURATION,      // A duration designator was expected, or one is repeated or out of order.
+		ISO8601_ERROR_INTERVAL,      // '/' was expected, or both parts of an interval are durations.
+		ISO8601_ERROR_ORDER,         // The end of an interval is before its start.
+		ISO8601_ERROR_RECURRENCE     // 'R' and an optional number of recurrences were expected.
+	} iso8601_error;
+
+	// Flags of iso8601_datetime::format, describing how a string differs from the
+	// extended calendar date and time in UTC (YYYY-MM-DDThh:mm:ssZ), whose format is 0.
+#define ISO8601_FORMAT_OFFSET 0x01u  // The offset is given as hh:mm instead of Z.
+#define ISO8601_FORMAT_BASIC 0x02u   // Basic format: no '-' and ':' separators.
+#define ISO8601_FORMAT_REDUCED 0x04u // The seconds are left out; a fraction belongs to the minute.
+#define ISO8601_FORMAT_COMMA 0x08u   // The fraction is separated by a comma instead of a full stop.
+#define ISO8601_FORMAT_ORDINAL 0x10u // Ordinal date: day of the year instead of month and day.
+#define ISO8601_FORMAT_WEEK 0x20u    // Week date: week of the year and day of the week.
+#define ISO8601_FORMAT_EXPANDED 0x40u // The year has a sign and ISO8601_EXPANDED_YEAR_DIGITS digits.
+#define ISO8601_FORMAT_DATE 0x80u    // A date without a time of day, read as 00:00:00Z.
+
+	// Formats accepted by iso8601_parse_datetime_format, combined with |.
+#define ISO8601_ACCEPT_EXTENDED 0x01u // YYYY-MM-DDThh:mm:ss with Z or hh:mm.
+#define ISO8601_ACCEPT_BASIC 0x02u    // YYYYMMDDThhmmss with Z or hhmm.
+#define ISO8601_ACCEPT_FRACTION 0x04u // A decimal fraction of the last time unit: hh:mm:ss.sss or hh:mm:ss,sss.
+#define ISO8601_ACCEPT_REDUCED 0x08u  // Seconds left out: hh:mm or hhmm.
+#define ISO8601_ACCEPT_ORDINAL 0x10u  // Ordinal dates: YYYY-DDD or YYYYDDD.
+#define ISO8601_ACCEPT_WEEK 0x20u     // Week dates: YYYY-Www-D or YYYYWwwD.
+#define ISO8601_ACCEPT_EXPANDED 0x40u // Expanded years: YYYYYY-MM-DD, YYYYYY-DDD, ...
+#define ISO8601_ACCEPT_DATE 0x80u     // Dates without a time of day in the accepted notations, and week dates
+                                      // reduced to the week (YYYY-Www, the Monday). Not in ISO8601_ACCEPT_ALL_DATETIMES.
+#define ISO8601_ACCEPT_ALL_DATETIMES (ISO8601_ACCEPT_EXTENDED | ISO8601_ACCEPT_BASIC | ISO8601_ACCEPT_FRACTION | \
+	ISO8601_ACCEPT_REDUCED | ISO8601_ACCEPT_ORDINAL | ISO8601_ACCEPT_WEEK | ISO8601_ACCEPT_EXPANDED)
+
+	// Digits of an expanded year, after its sign.
+#define ISO8601_EXPANDED_YEAR_DIGITS 6
+
+	// Most digits of a decimal fraction; a fraction is kept in nanoseconds.
+#define ISO8601_MAX_FRACTION_DIGITS 9
+
+	// Length of the longest date-time accepted with ISO8601_ACCEPT_ALL_DATETIMES:
+	// YYYYYY-MM-DDThh:mm:ss.fffffffffhh:mm
+#define MAX_FORMATTED_DATETIME_LENGTH 38
+
+	// Fields of a parsed date-time. Plain data; filled by iso8601_parse_datetime.
+	// Ordinal and week dates are converted to the calendar date.
+	typedef struct iso8601_datetime
+	{
+		int32_t year;             // Negative for expanded years before year 0.
+		uint8_t month;
+		uint8_t day;
+		uint8_t hour;
+		uint8_t minute;
+		uint8_t second;
+		uint8_t fraction_digits;  // Number of digits of the decimal fraction as written; 0 without one.
+		uint32_t fraction;        // Fraction of the second in nanoseconds (a fraction of the minute is converted).
+		int16_t offset_minutes;   // Offset from UTC: local time = UTC + offset. 0 for Z.
+		uint16_t format;          // ISO8601_FORMAT_* flags.
+		iso8601_error error;      // ISO8601_ERROR_NONE if the string is valid.
+		uint32_t error_position;  // Offset of the character the error was found at.
+	} iso8601_datetime;
+
+	// API used to validate and decode a date-time in the same single pass.
+	// Accepts exactly the strings is_valid_iso8601_datetime_n accepts. On success every
+	// field of result is filled and true is returned. Otherwise result->error and
+	// result->error_position describe the first problem in the string, and the other
+	// fields are unspecified. Nothing is allocated.
+	bool iso8601_parse_datetime(const char* dateTime, size_t length, iso8601_datetime* result);
+
+	// Same as iso8601_parse_datetime for any combination of ISO8601_ACCEPT_* formats.
+	// Fixed width extended strings are decoded by the same branch free path as
+	// is_valid_iso8601_datetime_n, and extended ordinal, week and expanded dates by
+	// similar ones; the other formats are told apart by the character after the year
+	// and by what follows the minutes.
+	bool iso8601_parse_datetime_format(const char* dateTime, size_t length, unsigned accepted_formats,
+		iso8601_datetime* result);
+
+	// Validates a date-time in any combination of ISO8601_ACCEPT_* formats.
+	bool is_valid_iso8601_datetime_format(const char* dateTime, size_t length, unsigned accepted_formats);
+
+	// Short English description of an error, e.g. "month out of range".
+	const char* iso8601_error_message(iso8601_error error);
+
+	// Instruction sets used by is_valid_iso8601_datetime_batch. The best one
+	// supported by the CPU is picked at runtime on the first call.
+	typedef enum iso8601_simd_level
+	{
+		ISO8601_SIMD_SCALAR = 0,
+		ISO8601_SIMD_SSE42 = 1,
+		ISO8601_SIMD_AVX2 = 2
+	} iso8601_simd_level;
+
+	// Validates count records of the extended format in bulk.
+	// dateTimes[i] points to a record of lengths[i] characters (no terminator needed);
+	// results[i] receives the same value is_valid_iso8601_datetime_n would return.
+	// Returns the number of valid records.
+	size_t is_valid_iso8601_datetime_batch(const char* const* dateTimes, const size_t* lengths, size_t count, bool* results);
+
+	// Limits the batch validator to max_level or the best level the CPU supports,
+	// whichever is lower. Returns the level that will be used.
+	// A test hook: the level applies to every thread at once, so it must not be
+	// changed while other threads are validating.
+	iso8601_simd_level iso8601_simd_select_level(iso8601_simd_level max_level);
+
+	// Location of one record inside the buffer passed to iso8601_validate_chunk
+	// or of one match of iso8601_find_datetimes.
+	typedef struct iso8601_record_span
+	{
+		size_t offset; // Offset of the first character from the start of the buffer.
+		size_t length; // Length of the record without its line terminator.
+	} iso8601_record_span;
+
+	// API used to validate a chunk of newline separated records in place.
+	// Splits buffer into at most max_records records, validates each of them and stores
+	// its location in spans[i] and its result in bit i of valid_bitmap, which must hold
+	// ISO8601_BITMAP_WORDS(max_records) words. A trailing \r is not part of the record.
+	// A record without a terminating newline is only taken when end_of_input is set;
+	// otherwise it is left for the next call. *consumed receives the number of bytes
+	// covered by the returned records, including their newlines.
+	// Returns the number of records found.
+	size_t iso8601_validate_chunk(const char* buffer, size_t size, bool end_of_input,
+		iso8601_record_span* spans, uint64_t* valid_bitmap, size_t max_records, size_t* consumed);
+
+	// API used to extract extended format date-times from free text such as log lines.
+	// Finds every valid date-time in text, in order, and stores the location of at most
+	// max_matches of them in matches. A candidate directly preceded by a digit, or an
+	// offset directly followed by one, is part of a longer token and is not reported.
+	// *scanned receives the number of bytes that have been searched: size, or the end of
+	// the last match when max_matches was reached, where the next call can continue.
+	// Returns the number of matches found.
+	size_t iso8601_find_datetimes(const char* text, size_t size, iso8601_record_span* matches,
+		size_t max_matches, size_t* scanned);
+
+	// An Arrow string column, used in place: row i is the offsets[i + 1] - offsets[i]
+	// characters at data + offsets[i]. Large string columns have 64 bit offsets instead.
+	typedef struct iso8601_string_column
+	{
+		const char* data;
+		const int32_t* offsets;       // rows + 1 offsets of a string column, or NULL.
+		const int64_t* large_offsets; // rows + 1 offsets of a large string column, or NULL.
+		const uint8_t* null_bitmap;   // Bit i, least significant first, set if row i is not null; NULL without nulls.
+		size_t rows;
+	} iso8601_string_column;
+
+	// Rows of a column validated by one call of the batch validator.
+#define ISO8601_COLUMN_BATCH_ROWS 64
+
+	// API used to validate an Arrow string column in a vectorized scan.
+	// Validates rows begin_row to end_row - 1 in the accepted formats, in one pass and
+	// without copying or terminating any row. Bit i of validity, least significant first
+	// as in an Arrow validity bitmap, is set for valid rows and cleared for null and
+	// invalid ones. If epoch_microseconds is not NULL, epoch_microseconds[i] receives the
+	// microseconds since 1970-01-01T00:00:00Z of valid row i, and 0 for the others; a
+	// valid row whose instant does not fit is then null too.
+	// begin_row must be a multiple of 8, so that calls on disjoint row ranges never write
+	// the same byte of validity and can run on separate threads. The last byte of the
+	// range is written whole, with the bits past end_row cleared.
+	// Extended format values are validated by is_valid_iso8601_datetime_batch and
+	// converted through their packed key.
+	// Returns the number of valid rows.
+	size_t iso8601_validate_string_column(const iso8601_string_column* column, size_t begin_row, size_t end_row,
+		unsigned accepted_formats, uint8_t* validity, int64_t* epoch_microseconds);
+
+	// Bias added to the UTC seconds of a packed key so that dates back to
+	// 0000-01-01T00:00:00+23:59 stay positive.
+#define ISO8601_KEY_EPOCH_BIAS ((int64_t)1 << 36)
+
+	// The UTC instant of a packed key is stored above this bit; keys that are equal
+	// after shifting them right by ISO8601_KEY_INSTANT_SHIFT denote the same instant.
+#define ISO8601_KEY_INSTANT_SHIFT 13
+
+	// Seconds since 1970-01-01T00:00:00Z of the instant of a packed key.
+#define ISO8601_KEY_UNIX_SECONDS(key) ((int64_t)((key) >> ISO8601_KEY_INSTANT_SHIFT) - ISO8601_KEY_EPOCH_BIAS)
+
+	// Length of the longest string written by iso8601_format_utc.
+#define MAX_UTC_DATETIME_LENGTH 24
+
+	// Packs a valid extended format date-time into a 64 bit key:
+	// the UTC instant in seconds, the offset in minutes and whether the offset was
+	// given as Z or as hh:mm. Every valid string has its own non-zero key, keys of
+	// different instants order chronologically, and the string can be rebuilt from
+	// its key with iso8601_format_datetime_key.
+	// The string must have passed is_valid_iso8601_datetime_n; it is not validated again.
+	uint64_t iso8601_datetime_key(const char* dateTime, size_t length);
+
+	// Writes the date-time string of a key created by iso8601_datetime_key to buffer,
+	// which must hold MAX_DATETIME_LENGTH characters. No terminator is written.
+	// Returns the length of the string.
+	size_t iso8601_format_datetime_key(uint64_t key, char* buffer);
+
+	// Days since 1970-01-01 of a date of the proleptic Gregorian calendar.
+	// Closed form: no loops over years and no calls into the C runtime time functions.
+	int64_t iso8601_days_from_civil(int64_t year, int month, int day);
+
+	// Number of ISO weeks of year: 52 or 53. Closed form as well.
+	unsigned iso8601_weeks_in_year(int64_t year);
+
+	// Seconds since 1970-01-01T00:00:00Z of a date-time parsed by iso8601_parse_datetime,
+	// applying its offset.
+	int64_t iso8601_parsed_to_unix_seconds(const iso8601_datetime* datetime);
+
+	// Validates an extended format date-time and converts it to seconds since
+	// 1970-01-01T00:00:00Z, applying its offset. Returns false if it is not valid.
+	bool iso8601_datetime_to_unix_seconds(const char* dateTime, size_t length, int64_t* seconds);
+
+	// Writes the canonical UTC representation YYYY-MM-DDThh:mm:ssZ of seconds since
+	// 1970-01-01T00:00:00Z to buffer, which must hold MAX_UTC_DATETIME_LENGTH characters.
+	// Instants outside the years 0000-9999 (expanded years, or reached by applying an
+	// offset) are written with a signed year such as +10000. No terminator is written.
+	// Returns the length of the string.
+	size_t iso8601_format_utc(int64_t seconds, char* buffer);
+
 	/* TODO: Add functionality to include
 	 ****************************************************************************************************************
 	 * Date formats:
 	 * Basic format     Extended format     Explanation
-	 * YYYYMMDD         YYYY-MM-DD          Complete calendar date
-	 * YYYYYYDDD       YYYYYY-DDD         Expanded ordinal date with two digits added
-	 * YYYYWww          YYYY-Www            Week date with precision reduced to week
+	 * YYYYMMDD         YYYY-MM-DD          Complete calendar date - DONE
+	 * YYYYYYDDD       YYYYYY-DDD         Expanded ordinal date with two digits added - DONE
+	 * YYYYWwwD         YYYY-Www-D          Complete week date - DONE
+	 * YYYYWww          YYYY-Www            Week date with precision reduced to week - DONE (ISO8601_ACCEPT_DATE)
 	 ****************************************************************************************************************
 	 * Time of day formats:
 	 * Basic format     Extended format     Explanation
 	 * hhmmss           hh:mm:ss            Complete local time - DONE
-	 * hhmm,mZ          hh:mm,mZ            Reduced precision UTC of day with one digit decimal fraction for minutes
-	 * hhmmhhmm        hh:mmhh:mm         Local time and the difference from UTC  reduced accuracy
+	 * hhmm,mZ          hh:mm,mZ            Reduced precision UTC of day with one digit decimal fraction for minutes - DONE
+	 * hhmmhhmm        hh:mmhh:mm         Local time and the difference from UTC  reduced accuracy - DONE
 	 ****************************************************************************************************************
 	 * Date and time of day formats:
 	 * Basic format       Extended format       Explanation
-	 * YYYYDDDThhmm       YYYY-DDDThh-mm        Complete ordinal date  reduced precision time of day
+	 * YYYYDDDThhmm       YYYY-DDDThh-mm        Complete ordinal date  reduced precision time of day - DONE
 	 * YYYYMMDDhhmm,m     YYYY-MM-DDhh:mm,m     Complete calendar date  reduced precision time of day with one digit decimal fraction for minute  no time designator
 	 * YYYYWwwDThh,hhZ    YYYY-Www-DThh,hhZ     Complete week date  reduced precision UTC of day with two digit decimal fraction for the hour
 	 ****************************************************************************************************************
 	 */
+	// Validates a date-time in any of the ISO8601_ACCEPT_ALL_DATETIMES formats, which
+	// include ordinal dates, week dates and expanded years.
 	bool is_valid_expanded_iso8601_datetime(const char* dateTime);
 
-	// TODO: API used to validate basic format of ISO8601 date time. 
-	// Extended Format
+	// API used to validate basic format of ISO8601 date time. 
+	// Basic Format
 	// Date and Time in UTC YYYYMMDDTHHMMDDZ
 	// Date and Time in with the offset YYYYMMDDThhmmsshhmm
+	// A decimal fraction (hhmmss,ss) and reduced precision (hhmm, hhmm,m) are accepted too.
 	bool is_valid_basic_iso8601_datetime_format(const char* dateTime);
 
-	// TODO: API to implement time interval representation.
+	// Units of a duration, largest first: PnYnMnDTnHnMnS, or PnW on its own.
+	typedef enum iso8601_duration_unit
+	{
+		ISO8601_DURATION_YEARS = 0,
+		ISO8601_DURATION_MONTHS,
+		ISO8601_DURATION_WEEKS,
+		ISO8601_DURATION_DAYS,
+		ISO8601_DURATION_HOURS,
+		ISO8601_DURATION_MINUTES,
+		ISO8601_DURATION_SECONDS,
+		ISO8601_DURATION_UNITS
+	} iso8601_duration_unit;
+
+	// Most digits of the number of a duration unit or of recurrences.
+#define ISO8601_MAX_DURATION_DIGITS 9
+
+	// Fields of a parsed duration. Plain data; filled by iso8601_parse_duration.
+	typedef struct iso8601_duration
+	{
+		uint32_t values[ISO8601_DURATION_UNITS]; // Indexed by iso8601_duration_unit; 0 for units left out.
+		uint32_t fraction;        // Decimal fraction of fraction_unit in billionths: PT1,5H has 500000000.
+		uint8_t fraction_unit;    // The smallest unit given, the only one that may have a fraction.
+		uint8_t units;            // Bit (1 << unit) set for every unit given.
+		iso8601_error error;      // ISO8601_ERROR_NONE if the string is valid.
+		uint32_t error_position;  // Offset of the character the error was found at.
+	} iso8601_duration;
+
+	// Parses a duration such as P3Y6M4DT12H30M5S, PT36H, P2W or PTnn,nnH in a single pass.
+	// Numbers have 1 to ISO8601_MAX_DURATION_DIGITS digits, and only the last unit may
+	// have a decimal fraction. Returns false and sets result->error otherwise.
+	bool iso8601_parse_duration(const char* duration, size_t length, iso8601_duration* result);
+
+	// How an interval is written.
+	typedef enum iso8601_interval_form
+	{
+		ISO8601_INTERVAL_START_END = 0,  // start/end
+		ISO8601_INTERVAL_START_DURATION, // start/duration
+		ISO8601_INTERVAL_DURATION_END,   // duration/end
+		ISO8601_INTERVAL_DURATION        // A duration on its own.
+	} iso8601_interval_form;
+
+	// Recurrences of R/... : the interval repeats without end.
+#define ISO8601_UNBOUNDED_RECURRENCES UINT32_MAX
+
+	// Fields of a parsed interval or recurring interval. Only the parts of form are set.
+	typedef struct iso8601_interval
+	{
+		iso8601_datetime start;
+		iso8601_datetime end;
+		iso8601_duration duration;
+		uint32_t recurrences;     // n of Rn/..., ISO8601_UNBOUNDED_RECURRENCES for R/..., 0 for an interval that does not recur.
+		iso8601_interval_form form;
+		iso8601_error error;      // ISO8601_ERROR_NONE if the string is valid.
+		uint32_t error_position;  // Offset of the character the error was found at, from the start of the whole string.
+	} iso8601_interval;
+
+	// Parses an interval: start/end, start/duration, duration/end or a duration alone.
+	// Each date-time is parsed by iso8601_parse_datetime_format with accepted_formats and
+	// each duration by iso8601_parse_duration; the string is split once at the '/', so
+	// nothing is read twice and nothing is allocated. The end of a start/end interval
+	// must not be before its start, compared as UTC instants.
+	bool iso8601_parse_interval(const char* interval, size_t length, unsigned accepted_formats,
+		iso8601_interval* result);
+
+	// Parses a recurring interval Rn/interval or R/interval, e.g. R5/2024-01-01T00:00:00Z/P1DT2H.
+	bool iso8601_parse_recurring_interval(const char* interval, size_t length, unsigned accepted_formats,
+		iso8601_interval* result);
+
+	// API used to validate time interval representation, with date-times in any of the
+	// ISO8601_ACCEPT_ALL_DATETIMES formats.
 	/*
 	 ****************************************************************************************************************
 	 * Basic format          Extended format
-	 * YYYYMMDDThhmm,mZ      YYYY-MM-DDThh:mm,mZ
+	 * YYYYMMDDThhmm,mZ      YYYY-MM-DDThh:mm,mZ      - DONE
 	 *                       YYYYMMDDThhmm,m
 	 *                       YYYY-MM-DDThh:mm,m
 	 ****************************************************************************************************************
 	 * Basic format			 Extended format
-	 * PnnnD				 N/A
+	 * PnnnD				 N/A                      - DONE
 	 ****************************************************************************************************************
 	 * Basic format			 Extended format
-	 * PTnn,nnH				 N/A
+	 * PTnn,nnH				 N/A                      - DONE
 	 ****************************************************************************************************************	 
 	 */
 	bool is_valid_iso8601_datetime_interval(const char* dateTime);
 
-	// TODO: API to implement Recurring time interval representation.
+	// API used to validate recurring time interval representation, with date-times in any
+	// of the ISO8601_ACCEPT_ALL_DATETIMES formats or dates alone (ISO8601_ACCEPT_DATE).
 	/*
 	 ****************************************************************************************************************
 	 * Basic format					Extended format
-	 * Rn/YYYYWww/YYYYWww			Rn/YYYY-Www/YYYY-Www
+	 * Rn/YYYYWww/YYYYWww			Rn/YYYY-Www/YYYY-Www      - DONE
 	 ****************************************************************************************************************
-	 * Basic format							Extended format
-	 * Rn/YYYYDDD/PnnDRn/YYYY-DDD/PnnD		Rn/YYYY-DDD/PnnD
+	 * Basic format					Extended format
+	 * Rn/YYYYDDD/PnnD				Rn/YYYY-DDD/PnnD          - DONE
 	 ****************************************************************************************************************
 	*/
 	bool is_valid_iso8601_recurring_time_interval(const char* dateTime);
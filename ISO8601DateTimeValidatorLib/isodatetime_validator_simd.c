@@ -0,0 +1,325 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "isodatetime_validator.h"
+
+// Batch validation of the fixed width extended formats.
+// YYYY-MM-DDThh:mm:ssZ        (20 characters)
+// YYYY-MM-DDThh:mm:ss+hh:mm   (25 characters)
+//
+// Each record is loaded into a 32 byte lane. The separators and digit classes are
+// checked with a handful of compares against per-shape templates, and the two digit
+// fields are gathered with a shuffle so the month/day/hour/minute/second/offset range
+// checks are a single vector compare. Anything the kernels cannot decide on their own
+// (the 29th of February) is handed to the scalar validator, so the results are always
+// identical to is_valid_iso8601_datetime_n.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ISO8601_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ISO8601_TARGET(isa)
+#else
+#define ISO8601_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+#define SIMD_LANE_WIDTH 32
+
+// The levels are read by every thread that validates a batch, and the first calls may
+// detect the CPU features at the same time. They all store the same value, but the
+// accesses have to be atomic.
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC only has <stdatomic.h> from Visual Studio 2022 17.5 on. Aligned long loads and
+// stores are atomic on its targets, and volatile keeps them from being cached or torn.
+typedef volatile long simd_level_slot;
+#define LOAD_LEVEL(slot) ((int)(slot))
+#define STORE_LEVEL(slot, level) ((slot) = (level))
+#else
+#include <stdatomic.h>
+typedef _Atomic int simd_level_slot;
+#define LOAD_LEVEL(slot) atomic_load_explicit(&(slot), memory_order_relaxed)
+#define STORE_LEVEL(slot, level) atomic_store_explicit(&(slot), (level), memory_order_relaxed)
+#endif
+
+// -1 until the first batch call detects the CPU features.
+static simd_level_slot detected_level = -1;
+// -1 unless iso8601_simd_select_level has limited the level.
+static simd_level_slot selected_level = -1;
+
+#ifdef ISO8601_SIMD_X86
+
+static int detect_simd_level(void)
+{
+    int level = ISO8601_SIMD_SCALAR;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool has_sse42 = (info[2] & (1 << 20)) != 0;
+    bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    bool has_avx = (info[2] & (1 << 28)) != 0;
+    if (has_sse42) {
+        level = ISO8601_SIMD_SSE42;
+    }
+    if (has_sse42 && has_osxsave && has_avx && max_leaf >= 7 &&
+        (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0) {
+            level = ISO8601_SIMD_AVX2;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        level = ISO8601_SIMD_SSE42;
+    }
+    if (level == ISO8601_SIMD_SSE42 && __builtin_cpu_supports("avx2")) {
+        level = ISO8601_SIMD_AVX2;
+    }
+#endif
+    return level;
+}
+
+// Per-shape templates, indexed by shape: 0 for the 20 character UTC form,
+// 1 for the 25 character offset form.
+// Expected literal characters; the alternative template only differs in the
+// sign of the offset.
+static const uint8_t literal_template[2][SIMD_LANE_WIDTH] = {
+    { 0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0, ':', 0, 0, 'Z' },
+    { 0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0, ':', 0, 0, '+', 0, 0, ':' },
+};
+static const uint8_t literal_template_alt[2][SIMD_LANE_WIDTH] = {
+    { 0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0, ':', 0, 0, 'Z' },
+    { 0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0, ':', 0, 0, '-', 0, 0, ':' },
+};
+static const uint8_t literal_mask[2][SIMD_LANE_WIDTH] = {
+    { 0, 0, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF },
+    { 0, 0, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF, 0, 0, 0xFF },
+};
+static const uint8_t digit_mask[2][SIMD_LANE_WIDTH] = {
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0 },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0,
+      0xFF, 0xFF, 0, 0xFF, 0xFF },
+};
+
+// Lanes of the gathered 16 bit fields:
+// month, day, hour, minute, second, offset hour, offset minute, unused.
+static const int16_t field_min[2][8] = {
+    { 1, 1, 0, 0, 0, INT16_MIN, INT16_MIN, INT16_MIN },
+    { 1, 1, 0, 0, 0, 0, 0, INT16_MIN },
+};
+static const int16_t field_max[2][8] = {
+    { 12, 31, 23, 59, 59, INT16_MAX, INT16_MAX, INT16_MAX },
+    { 12, 31, 23, 59, 59, 23, 59, INT16_MAX },
+};
+
+// Shortest month length for each month, ignoring leap years.
+static const uint8_t days_in_month_common[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// Loads a record of 20 or 25 characters as the two 16 byte halves of a lane, with zeros
+// past its end. Only the characters of the record are read, so it may end anywhere,
+// even right before unmapped memory: the second half is loaded from the last 16
+// characters and shifted into place.
+ISO8601_TARGET("sse4.2")
+static inline void load_lane(const char* dateTime, size_t length, __m128i* low, __m128i* high)
+{
+    *low = _mm_loadu_si128((const __m128i*)dateTime);
+    __m128i tail = _mm_loadu_si128((const __m128i*)(dateTime + length - 16));
+    *high = length == 20 ? _mm_srli_si128(tail, 12) : _mm_srli_si128(tail, 7);
+}
+
+// Gathers the two digit fields from the digit values of bytes 0-15 and 16-31 and
+// checks them against the ranges of the shape.
+ISO8601_TARGET("sse4.2")
+static inline bool fields_in_range(__m128i low_digits, __m128i high_digits, int shape, int* month, int* day)
+{
+    const __m128i gather_low = _mm_setr_epi8(5, 6, 8, 9, 11, 12, 14, 15,
+        -128, -128, -128, -128, -128, -128, -128, -128);
+    const __m128i gather_high = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128,
+        1, 2, 4, 5, 7, 8, -128, -128);
+    const __m128i weights = _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1);
+
+    __m128i pairs = _mm_or_si128(_mm_shuffle_epi8(low_digits, gather_low),
+        _mm_shuffle_epi8(high_digits, gather_high));
+    __m128i fields = _mm_maddubs_epi16(pairs, weights);
+
+    __m128i too_small = _mm_cmplt_epi16(fields, _mm_loadu_si128((const __m128i*)field_min[shape]));
+    __m128i too_large = _mm_cmpgt_epi16(fields, _mm_loadu_si128((const __m128i*)field_max[shape]));
+    if (!_mm_testz_si128(_mm_or_si128(too_small, too_large), _mm_set1_epi8(-1))) {
+        return false;
+    }
+
+    *month = _mm_extract_epi16(fields, 0);
+    *day = _mm_extract_epi16(fields, 1);
+    return true;
+}
+
+static bool day_in_month(const char* dateTime, size_t length, int month, int day)
+{
+    if (day <= days_in_month_common[month]) {
+        return true;
+    }
+    // Only the 29th of February depends on the year.
+    if (month == 2 && day == 29) {
+        return is_valid_iso8601_datetime_n(dateTime, length);
+    }
+    return false;
+}
+
+ISO8601_TARGET("sse4.2")
+static bool validate_sse42(const char* dateTime, size_t length)
+{
+    if (length != 20 && length != 25) {
+        return false;
+    }
+    int shape = length == 25;
+
+    __m128i halves[2];
+    load_lane(dateTime, length, &halves[0], &halves[1]);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+
+    __m128i digits[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i bytes = halves[half];
+        __m128i values = _mm_sub_epi8(bytes, zero_char);
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(values, nine), values);
+        __m128i is_literal = _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_loadu_si128((const __m128i*)(literal_template[shape] + half * 16))),
+            _mm_cmpeq_epi8(bytes, _mm_loadu_si128((const __m128i*)(literal_template_alt[shape] + half * 16))));
+
+        __m128i expected_digits = _mm_loadu_si128((const __m128i*)(digit_mask[shape] + half * 16));
+        __m128i expected_literals = _mm_loadu_si128((const __m128i*)(literal_mask[shape] + half * 16));
+        __m128i matched = _mm_or_si128(_mm_and_si128(is_digit, expected_digits),
+            _mm_and_si128(is_literal, expected_literals));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(matched, _mm_or_si128(expected_digits, expected_literals))) != 0xFFFF) {
+            return false;
+        }
+        digits[half] = values;
+    }
+
+    int month, day;
+    if (!fields_in_range(digits[0], digits[1], shape, &month, &day)) {
+        return false;
+    }
+    return day_in_month(dateTime, length, month, day);
+}
+
+ISO8601_TARGET("avx2")
+static bool validate_avx2(const char* dateTime, size_t length)
+{
+    if (length != 20 && length != 25) {
+        return false;
+    }
+    int shape = length == 25;
+
+    __m128i low, high;
+    load_lane(dateTime, length, &low, &high);
+
+    __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    __m256i values = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+    __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(values, _mm256_set1_epi8(9)), values);
+    __m256i is_literal = _mm256_or_si256(
+        _mm256_cmpeq_epi8(bytes, _mm256_loadu_si256((const __m256i*)literal_template[shape])),
+        _mm256_cmpeq_epi8(bytes, _mm256_loadu_si256((const __m256i*)literal_template_alt[shape])));
+
+    __m256i expected_digits = _mm256_loadu_si256((const __m256i*)digit_mask[shape]);
+    __m256i expected_literals = _mm256_loadu_si256((const __m256i*)literal_mask[shape]);
+    __m256i matched = _mm256_or_si256(_mm256_and_si256(is_digit, expected_digits),
+        _mm256_and_si256(is_literal, expected_literals));
+    if ((uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(matched, _mm256_or_si256(expected_digits, expected_literals))) != 0xFFFFFFFFu) {
+        return false;
+    }
+
+    int month, day;
+    if (!fields_in_range(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1), shape, &month, &day)) {
+        return false;
+    }
+    return day_in_month(dateTime, length, month, day);
+}
+
+ISO8601_TARGET("sse4.2")
+static size_t validate_batch_sse42(const char* const* dateTimes, const size_t* lengths, size_t count, bool* results)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        results[i] = validate_sse42(dateTimes[i], lengths[i]);
+        valid += results[i];
+    }
+    return valid;
+}
+
+ISO8601_TARGET("avx2")
+static size_t validate_batch_avx2(const char* const* dateTimes, const size_t* lengths, size_t count, bool* results)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        results[i] = validate_avx2(dateTimes[i], lengths[i]);
+        valid += results[i];
+    }
+    return valid;
+}
+
+#else
+
+static int detect_simd_level(void)
+{
+    return ISO8601_SIMD_SCALAR;
+}
+
+#endif
+
+static size_t validate_batch_scalar(const char* const* dateTimes, const size_t* lengths, size_t count, bool* results)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        results[i] = is_valid_iso8601_datetime_n(dateTimes[i], lengths[i]);
+        valid += results[i];
+    }
+    return valid;
+}
+
+static int supported_level(void)
+{
+    int level = LOAD_LEVEL(detected_level);
+    if (level < 0) {
+        level = detect_simd_level();
+        STORE_LEVEL(detected_level, level);
+    }
+    return level;
+}
+
+static int active_level(void)
+{
+    int level = LOAD_LEVEL(selected_level);
+    return level >= 0 ? level : supported_level();
+}
+
+iso8601_simd_level iso8601_simd_select_level(iso8601_simd_level max_level)
+{
+    int supported = supported_level();
+    int level = (int)max_level < supported ? (int)max_level : supported;
+    STORE_LEVEL(selected_level, level);
+    return (iso8601_simd_level)level;
+}
+
+size_t is_valid_iso8601_datetime_batch(const char* const* dateTimes, const size_t* lengths, size_t count, bool* results)
+{
+    switch (active_level())
+    {
+#ifdef ISO8601_SIMD_X86
+    case ISO8601_SIMD_AVX2:
+        return validate_batch_avx2(dateTimes, lengths, count, results);
+    case ISO8601_SIMD_SSE42:
+        return validate_batch_sse42(dateTimes, lengths, count, results);
+#endif
+    default:
+        return validate_batch_scalar(dateTimes, lengths, count, results);
+    }
+}